@@ -48,6 +48,7 @@ public class LPrefab : ModuleRules
                 "TargetPlatform",
                 "Slate",
                 "SlateCore",
+                "AssetRegistry",
             }
             );
         }
@@ -3,6 +3,7 @@
 #include "LPrefabBPLibrary.h"
 #include "LPrefabUtils.h"
 #include "PrefabSystem/LPrefab.h"
+#include "PrefabSystem/LPrefabHierarchyIndex.h"
 #include "LPrefabModule.h"
 #include LPREFAB_SERIALIZER_NEWEST_INCLUDE
 
@@ -10,6 +11,51 @@ void ULPrefabBPLibrary::DestroyActorWithHierarchy(AActor* Target, bool WithHiera
 {
 	LPrefabUtils::DestroyActorWithHierarchy(Target, WithHierarchy);
 }
+void ULPrefabBPLibrary::DestroyActorWithHierarchyDeferred(AActor* Target, bool WithHierarchy)
+{
+	LPrefabUtils::DestroyActorWithHierarchyDeferred(Target, WithHierarchy);
+}
+AActor* ULPrefabBPLibrary::LoadPrefabWithHandle(UObject* WorldContextObject, ULPrefab* InPrefab, USceneComponent* InParent, FVector Location, FRotator Rotation, FVector Scale, FLPrefabInstanceHandle& OutHandle)
+{
+	if (!IsValid(InPrefab))
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d InPrefab not valid"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+		OutHandle.Reset();
+		return nullptr;
+	}
+	return InPrefab->LoadPrefabWithHandle(WorldContextObject, InParent, Location, Rotation, Scale, OutHandle);
+}
+UObject* ULPrefabBPLibrary::FindObjectInInstanceHandleByGuid(const FLPrefabInstanceHandle& InHandle, const FGuid& InGuid, TSubclassOf<UObject> ObjectClass)
+{
+	auto Result = InHandle.FindObjectByGuid(InGuid);
+	if (Result != nullptr && ObjectClass != nullptr && !Result->IsA(ObjectClass))return nullptr;
+	return Result;
+}
+UObject* ULPrefabBPLibrary::FindObjectInInstanceHandleByName(const FLPrefabInstanceHandle& InHandle, FName InName, TSubclassOf<UObject> ObjectClass)
+{
+	auto Result = InHandle.FindObjectByName(InName);
+	if (Result != nullptr && ObjectClass != nullptr && !Result->IsA(ObjectClass))return nullptr;
+	return Result;
+}
+UObject* ULPrefabBPLibrary::FindObjectInInstanceHandleByActorAndName(const FLPrefabInstanceHandle& InHandle, AActor* InActor, FName InName, TSubclassOf<UObject> ObjectClass)
+{
+	auto Result = InHandle.FindObjectByName(InActor, InName);
+	if (Result != nullptr && ObjectClass != nullptr && !Result->IsA(ObjectClass))return nullptr;
+	return Result;
+}
+TArray<AActor*> ULPrefabBPLibrary::GetActorsInInstanceHandle(const FLPrefabInstanceHandle& InHandle)
+{
+	TArray<AActor*> Result;
+	Result.Reserve(InHandle.GetActors().Num());
+	for (auto& Actor : InHandle.GetActors())
+	{
+		if (Actor.IsValid())
+		{
+			Result.Add(Actor.Get());
+		}
+	}
+	return Result;
+}
 AActor* ULPrefabBPLibrary::LoadPrefab(UObject* WorldContextObject, ULPrefab* InPrefab, USceneComponent* InParent, const FLPrefab_LoadPrefabCallback& InCallbackBeforeAwake, bool SetRelativeTransformToIdentity)
 {
 	if (!IsValid(InPrefab))
@@ -51,6 +97,10 @@ AActor* ULPrefabBPLibrary::DuplicateActor(AActor* Target, USceneComponent* Paren
 {
 	return LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::DuplicateActor(Target, Parent);
 }
+AActor* ULPrefabBPLibrary::DuplicateActorDirect(AActor* Target, USceneComponent* Parent)
+{
+	return LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::DuplicateActorDirect(Target, Parent);
+}
 void ULPrefabBPLibrary::PrepareDuplicateData(AActor* Target, FLPrefabDuplicateDataContainer& DataContainer)
 {
 	DataContainer.bIsValid = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::PrepareDataForDuplicate(Target, DataContainer.DuplicateData);
@@ -66,6 +116,15 @@ AActor* ULPrefabBPLibrary::DuplicateActorWithPreparedData(FLPrefabDuplicateDataC
 		return nullptr;
 	}
 }
+TArray<AActor*> ULPrefabBPLibrary::DuplicateActorWithPreparedDataBatch(FLPrefabDuplicateDataContainer& Data, USceneComponent* Parent, int32 Count, const TArray<FTransform>& Transforms)
+{
+	TArray<AActor*> Result;
+	if (Data.bIsValid)
+	{
+		LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::DuplicateActorWithPreparedDataBatch(Data.DuplicateData, Parent, Count, Transforms, Result);
+	}
+	return Result;
+}
 
 UActorComponent* ULPrefabBPLibrary::GetComponentInParent(AActor* InActor, TSubclassOf<UActorComponent> ComponentClass, bool IncludeSelf, AActor* InStopNode)
 {
@@ -74,6 +133,19 @@ UActorComponent* ULPrefabBPLibrary::GetComponentInParent(AActor* InActor, TSubcl
 		UE_LOG(LPrefab, Error, TEXT("[ULPrefabBPLibrary::GetComponentInParent]InActor is not valid!"));
 		return nullptr;
 	}
+	if (auto HierarchyIndex = FLPrefabHierarchyIndex::Find(InActor))
+	{
+		UActorComponent* resultComp = nullptr;
+		bool bReachRoot = false;
+		HierarchyIndex->GetComponentInParent(InActor, ComponentClass, IncludeSelf, InStopNode, resultComp, bReachRoot);
+		if (!bReachRoot)
+		{
+			return resultComp;
+		}
+		//continue search above the indexed hierarchy
+		InActor = HierarchyIndex->GetRootActor();
+		IncludeSelf = false;
+	}
 	AActor* parentActor = IncludeSelf ? InActor : InActor->GetAttachParentActor();
 	while (parentActor != nullptr)
 	{
@@ -101,6 +173,11 @@ TArray<UActorComponent*> ULPrefabBPLibrary::GetComponentsInChildren(AActor* InAc
 		UE_LOG(LPrefab, Error, TEXT("[ULPrefabBPLibrary::GetComponentInParent]InActor is not valid!"));
 		return result;
 	}
+	if (auto HierarchyIndex = FLPrefabHierarchyIndex::Find(InActor))
+	{
+		HierarchyIndex->GetComponentsInChildren(InActor, ComponentClass, IncludeSelf, InExcludeNode, result);
+		return result;
+	}
 
 	struct LOCAL
 	{
@@ -153,6 +230,12 @@ UActorComponent* ULPrefabBPLibrary::GetComponentInChildren(AActor* InActor, TSub
 		UE_LOG(LPrefab, Error, TEXT("[ULPrefabBPLibrary::GetComponentInChildren]InActor is not valid!"));
 		return nullptr;
 	}
+	if (auto HierarchyIndex = FLPrefabHierarchyIndex::Find(InActor))
+	{
+		UActorComponent* resultComp = nullptr;
+		HierarchyIndex->GetComponentInChildren(InActor, ComponentClass, IncludeSelf, InExcludeNode, resultComp);
+		return resultComp;
+	}
 
 	struct LOCAL
 	{
@@ -203,3 +286,16 @@ UActorComponent* ULPrefabBPLibrary::GetComponentInChildren(AActor* InActor, TSub
 	}
 	return result;
 }
+
+void ULPrefabBPLibrary::EnableHierarchyIndex(AActor* InRootActor)
+{
+	FLPrefabHierarchyIndex::Enable(InRootActor);
+}
+void ULPrefabBPLibrary::DisableHierarchyIndex(AActor* InRootActor)
+{
+	FLPrefabHierarchyIndex::Disable(InRootActor);
+}
+void ULPrefabBPLibrary::MarkHierarchyIndexDirty(AActor* InActor)
+{
+	FLPrefabHierarchyIndex::MarkDirty(InActor);
+}
@@ -2,6 +2,8 @@
 
 #include "LPrefabUtils.h"
 #include "LPrefabModule.h"
+#include "PrefabSystem/LPrefabManager.h"
+#include "Engine/World.h"
 #include "Sound/SoundBase.h"
 #include "Engine/Texture2D.h"
 #include "TextureResource.h"
@@ -65,6 +67,31 @@ void LPrefabUtils::DestroyActorWithHierarchy(AActor* Target, bool WithHierarchy)
 #endif
 	}
 }
+void LPrefabUtils::DestroyActorWithHierarchyDeferred(AActor* Target, bool WithHierarchy)
+{
+	if (!Target->IsValidLowLevelFast())
+	{
+		UE_LOG(LPrefab, Error, TEXT("[LPrefabUtils::DestroyActorWithHierarchyDeferred]Try to delete not valid actor"));
+		return;
+	}
+	auto World = Target->GetWorld();
+	auto PrefabManager = (World != nullptr && World->IsGameWorld()) ? ULPrefabWorldSubsystem::GetInstance(World) : nullptr;
+	if (PrefabManager == nullptr)
+	{
+		DestroyActorWithHierarchy(Target, WithHierarchy);
+		return;
+	}
+	TArray<AActor*> AllChildrenActors;
+	if (WithHierarchy)
+	{
+		CollectChildrenActors(Target, AllChildrenActors);
+	}
+	else
+	{
+		AllChildrenActors.Add(Target);
+	}
+	PrefabManager->DestroyActorsDeferred(AllChildrenActors);
+}
 void LPrefabUtils::CollectChildrenActors(AActor* Target, TArray<AActor*>& AllChildrenActors, bool IncludeTarget)
 {
 	if (IncludeTarget)
@@ -0,0 +1,503 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabAnimation/LPrefabBakedSequence.h"
+#include "PrefabAnimation/LPrefabSequence.h"
+#include "MovieScene.h"
+#include "Components/SceneComponent.h"
+#include "GameFramework/Actor.h"
+#include "LPrefabModule.h"
+#if WITH_EDITOR
+#include "Tracks/MovieScenePropertyTrack.h"
+#include "Tracks/MovieScene3DTransformTrack.h"
+#include "Tracks/MovieSceneFloatTrack.h"
+#include "Tracks/MovieSceneDoubleTrack.h"
+#include "Tracks/MovieSceneColorTrack.h"
+#include "Sections/MovieScene3DTransformSection.h"
+#include "Sections/MovieSceneFloatSection.h"
+#include "Sections/MovieSceneDoubleSection.h"
+#include "Sections/MovieSceneColorSection.h"
+#include "Channels/MovieSceneFloatChannel.h"
+#include "Channels/MovieSceneDoubleChannel.h"
+#endif
+
+DECLARE_CYCLE_STAT(TEXT("LPrefab BakedSequenceEvaluate"), STAT_BakedSequenceEvaluate, STATGROUP_LexPrefab);
+
+void FLPrefabBakedSequence::Sample(float InTime, float* OutValues)const
+{
+	const float SampleTime = FMath::Clamp(InTime, 0.0f, Duration) * SampleRate;
+	const int32 Index0 = FMath::Min((int32)SampleTime, SampleCount - 1);
+	const int32 Index1 = FMath::Min(Index0 + 1, SampleCount - 1);
+	const float* Row0 = Samples.GetData() + Index0 * ChannelStride;
+	const float* Row1 = Samples.GetData() + Index1 * ChannelStride;
+	const VectorRegister4Float Alpha = VectorSetFloat1(SampleTime - Index0);
+	for (int32 i = 0; i < ChannelStride; i += 4)
+	{
+		const VectorRegister4Float A = VectorLoad(Row0 + i);
+		const VectorRegister4Float B = VectorLoad(Row1 + i);
+		VectorStore(VectorMultiplyAdd(VectorSubtract(B, A), Alpha, A), OutValues + i);
+	}
+}
+
+bool FLPrefabBakedSequence::ResolveProperty(UStruct* InClass, const FString& InPropertyPath, ELPrefabBakedTrackType InTrackType, TArray<FProperty*>& OutPropertyChain, UFunction*& OutSetterFunction)
+{
+	OutPropertyChain.Reset();
+	OutSetterFunction = nullptr;
+	if (InClass == nullptr)return false;
+	UStruct* Struct = InClass;
+	TArray<FString> PathSegments;
+	InPropertyPath.ParseIntoArray(PathSegments, TEXT("."));
+	for (int i = 0; i < PathSegments.Num(); i++)
+	{
+		auto Property = FindFProperty<FProperty>(Struct, *PathSegments[i]);
+		if (Property == nullptr)return false;//array element is not supported
+		OutPropertyChain.Add(Property);
+		if (i + 1 < PathSegments.Num())
+		{
+			auto StructProperty = CastField<FStructProperty>(Property);
+			if (StructProperty == nullptr)return false;
+			Struct = StructProperty->Struct;
+		}
+	}
+	if (OutPropertyChain.Num() == 0)return false;
+
+	auto ValueProperty = OutPropertyChain.Last();
+	bool bTypeMatch = false;
+	switch (InTrackType)
+	{
+	case ELPrefabBakedTrackType::Float:
+		bTypeMatch = ValueProperty->IsA<FFloatProperty>();
+		break;
+	case ELPrefabBakedTrackType::Double:
+		bTypeMatch = ValueProperty->IsA<FDoubleProperty>();
+		break;
+	case ELPrefabBakedTrackType::Color:
+	{
+		auto StructProperty = CastField<FStructProperty>(ValueProperty);
+		bTypeMatch = StructProperty != nullptr
+			&& (StructProperty->Struct == TBaseStructure<FLinearColor>::Get() || StructProperty->Struct == TBaseStructure<FColor>::Get());
+	}
+	break;
+	default:
+		break;
+	}
+	if (!bTypeMatch)return false;
+
+	if (OutPropertyChain.Num() == 1)
+	{
+		auto Function = InClass->IsA<UClass>() ? ((UClass*)InClass)->FindFunctionByName(*(TEXT("Set") + PathSegments[0])) : nullptr;
+		if (Function != nullptr && Function->NumParms == 1)
+		{
+			auto Param = CastField<FProperty>(Function->ChildProperties);
+			if (Param != nullptr && Param->SameType(ValueProperty))
+			{
+				OutSetterFunction = Function;
+			}
+		}
+	}
+	return true;
+}
+
+#if WITH_EDITOR
+bool FLPrefabBakedSequence::Bake(UMovieScene* InMovieScene, FLPrefabBakedSequence& OutBakedData)
+{
+	OutBakedData = FLPrefabBakedSequence();
+	if (InMovieScene == nullptr)return false;
+	//spawnable, root tracks (audio, event...) and camera cut need full player
+	if (InMovieScene->GetSpawnableCount() > 0 || InMovieScene->GetTracks().Num() > 0 || InMovieScene->GetCameraCutTrack() != nullptr)return false;
+	const auto PlaybackRange = InMovieScene->GetPlaybackRange();
+	if (!PlaybackRange.HasLowerBound() || !PlaybackRange.HasUpperBound())return false;
+
+	struct FChannelSource
+	{
+		const FMovieSceneFloatChannel* FloatChannel = nullptr;
+		const FMovieSceneDoubleChannel* DoubleChannel = nullptr;
+	};
+	TArray<FChannelSource> Channels;
+	TArray<FLPrefabBakedSequenceTrack> Tracks;
+	//constant (stepped) key can not be represented by interpolating samples
+	auto HasConstantKey = [](const FChannelSource& InSource) {
+		if (InSource.FloatChannel != nullptr)
+		{
+			for (auto& Value : InSource.FloatChannel->GetValues())
+			{
+				if (Value.InterpMode == RCIM_Constant)return true;
+			}
+		}
+		else
+		{
+			for (auto& Value : InSource.DoubleChannel->GetValues())
+			{
+				if (Value.InterpMode == RCIM_Constant)return true;
+			}
+		}
+		return false;
+	};
+	for (auto& Binding : InMovieScene->GetBindings())
+	{
+		auto Possessable = InMovieScene->FindPossessable(Binding.GetObjectGuid());
+		if (Possessable == nullptr)return false;
+		for (auto& Track : Binding.GetTracks())
+		{
+			if (Track == nullptr || Track->IsEvalDisabled())continue;//muted track is not evaluated by sequencer either
+			const auto& Sections = Track->GetAllSections();
+			if (Sections.Num() != 1)return false;
+			auto Section = Sections[0];
+			if (!Section->IsActive())continue;
+			const auto BlendType = Section->GetBlendType();
+			if ((BlendType.IsValid() && BlendType.Get() != EMovieSceneBlendType::Absolute)
+				|| Section->Easing.GetEaseInDuration() > 0 || Section->Easing.GetEaseOutDuration() > 0
+				|| !Section->GetRange().Contains(PlaybackRange)
+				)
+			{
+				return false;
+			}
+
+			FLPrefabBakedSequenceTrack BakedTrack;
+			BakedTrack.BindingId = Binding.GetObjectGuid();
+			BakedTrack.ChannelOffset = Channels.Num();
+			auto TrackClass = Track->GetClass();
+			if (TrackClass == UMovieScene3DTransformTrack::StaticClass())
+			{
+				auto TransformSection = Cast<UMovieScene3DTransformSection>(Section);
+				if (TransformSection == nullptr || !EnumHasAllFlags(TransformSection->GetMask().GetChannels(), EMovieSceneTransformChannel::AllTransform))return false;
+				auto DoubleChannels = TransformSection->GetChannelProxy().GetChannels<FMovieSceneDoubleChannel>();
+				if (DoubleChannels.Num() != 9)return false;
+				BakedTrack.TrackType = ELPrefabBakedTrackType::Transform;
+				for (auto Channel : DoubleChannels)
+				{
+					Channels.Add({ nullptr, Channel });
+				}
+			}
+			else
+			{
+				if (TrackClass == UMovieSceneFloatTrack::StaticClass())
+				{
+					auto FloatSection = Cast<UMovieSceneFloatSection>(Section);
+					if (FloatSection == nullptr)return false;
+					BakedTrack.TrackType = ELPrefabBakedTrackType::Float;
+					Channels.Add({ &FloatSection->GetChannel(), nullptr });
+				}
+				else if (TrackClass == UMovieSceneDoubleTrack::StaticClass())
+				{
+					auto DoubleSection = Cast<UMovieSceneDoubleSection>(Section);
+					if (DoubleSection == nullptr)return false;
+					BakedTrack.TrackType = ELPrefabBakedTrackType::Double;
+					Channels.Add({ nullptr, &DoubleSection->GetChannel() });
+				}
+				else if (TrackClass == UMovieSceneColorTrack::StaticClass())
+				{
+					auto FloatChannels = Section->GetChannelProxy().GetChannels<FMovieSceneFloatChannel>();
+					if (FloatChannels.Num() != 4)return false;
+					BakedTrack.TrackType = ELPrefabBakedTrackType::Color;
+					for (auto Channel : FloatChannels)
+					{
+						Channels.Add({ Channel, nullptr });
+					}
+				}
+				else
+				{
+					return false;
+				}
+				BakedTrack.PropertyPath = ((UMovieScenePropertyTrack*)Track)->GetPropertyPath().ToString();
+				TArray<FProperty*> PropertyChain;
+				UFunction* SetterFunction = nullptr;
+				if (!ResolveProperty(const_cast<UClass*>(Possessable->GetPossessedObjectClass()), BakedTrack.PropertyPath, BakedTrack.TrackType, PropertyChain, SetterFunction))return false;
+			}
+			for (int32 ChannelIndex = BakedTrack.ChannelOffset; ChannelIndex < Channels.Num(); ChannelIndex++)
+			{
+				if (HasConstantKey(Channels[ChannelIndex]))return false;
+			}
+			Tracks.Add(BakedTrack);
+		}
+	}
+	if (Tracks.Num() == 0)return false;
+
+	const auto TickResolution = InMovieScene->GetTickResolution();
+	const auto StartFrame = UE::MovieScene::DiscreteInclusiveLower(PlaybackRange);
+	const auto EndFrame = UE::MovieScene::DiscreteExclusiveUpper(PlaybackRange);
+	const double Duration = FMath::Max(TickResolution.AsSeconds(FFrameTime(EndFrame - StartFrame)), 0.0);
+	const double DisplayRate = FMath::Max(InMovieScene->GetDisplayRate().AsDecimal(), 1.0);
+	const int32 ChannelStride = Align(Channels.Num(), 4);
+	auto EvaluateChannel = [&](const FChannelSource& InSource, double InTime, float& OutValue) {
+		const FFrameTime FrameTime = FFrameTime(StartFrame) + TickResolution.AsFrameTime(InTime);
+		if (InSource.FloatChannel != nullptr)
+		{
+			return InSource.FloatChannel->Evaluate(FrameTime, OutValue);
+		}
+		double Value = 0;
+		const bool bEvaluated = InSource.DoubleChannel->Evaluate(FrameTime, Value);
+		OutValue = (float)Value;
+		return bEvaluated;
+	};
+
+	//linear interpolation between samples must match the curve, cubic curve or key that is not at sample time may need higher sample rate
+	const int32 MaxSampleRateMultiplier = 8;
+	const float Tolerance = 0.001f;
+	for (int32 SampleRateMultiplier = 1; SampleRateMultiplier <= MaxSampleRateMultiplier; SampleRateMultiplier *= 2)
+	{
+		const int32 SampleCount = FMath::CeilToInt32(Duration * DisplayRate * SampleRateMultiplier) + 1;
+		//adjust rate so the last sample is exactly at end, then all samples have same spacing as Sample() assume
+		const double SampleRate = Duration > 0 ? (SampleCount - 1) / Duration : DisplayRate;
+
+		OutBakedData.Tracks = Tracks;
+		OutBakedData.ChannelStride = ChannelStride;
+		OutBakedData.SampleCount = SampleCount;
+		OutBakedData.SampleRate = (float)SampleRate;
+		OutBakedData.Duration = (float)Duration;
+		OutBakedData.Samples.Reset();
+		OutBakedData.Samples.SetNumZeroed(SampleCount * ChannelStride);
+		for (int32 SampleIndex = 0; SampleIndex < SampleCount; SampleIndex++)
+		{
+			float* Row = OutBakedData.Samples.GetData() + SampleIndex * ChannelStride;
+			for (int32 ChannelIndex = 0; ChannelIndex < Channels.Num(); ChannelIndex++)
+			{
+				if (!EvaluateChannel(Channels[ChannelIndex], SampleIndex / SampleRate, Row[ChannelIndex]))//no key and no default, sequencer leave the value unchanged
+				{
+					OutBakedData = FLPrefabBakedSequence();
+					return false;
+				}
+			}
+		}
+
+		//check middle of every two samples
+		bool bAccurate = true;
+		for (int32 SampleIndex = 0; SampleIndex + 1 < SampleCount && bAccurate; SampleIndex++)
+		{
+			const float* Row0 = OutBakedData.Samples.GetData() + SampleIndex * ChannelStride;
+			const float* Row1 = Row0 + ChannelStride;
+			for (int32 ChannelIndex = 0; ChannelIndex < Channels.Num(); ChannelIndex++)
+			{
+				float Expected = 0;
+				EvaluateChannel(Channels[ChannelIndex], (SampleIndex + 0.5) / SampleRate, Expected);
+				const float Interpolated = (Row0[ChannelIndex] + Row1[ChannelIndex]) * 0.5f;
+				if (FMath::Abs(Expected - Interpolated) > Tolerance * FMath::Max(1.0f, FMath::Abs(Expected)))
+				{
+					bAccurate = false;
+					break;
+				}
+			}
+		}
+		if (bAccurate)
+		{
+			return true;
+		}
+	}
+	OutBakedData = FLPrefabBakedSequence();
+	return false;
+}
+#endif
+
+bool FLPrefabBakedSequencePlayer::Initialize(ULPrefabSequence* InSequence, const FMovieSceneSequencePlaybackSettings& InSettings)
+{
+	Sequence = InSequence;
+	BakedData.Reset();
+	Targets.Reset();
+	Values.Reset();
+	bPlaying = false;
+	if (InSequence == nullptr)return false;
+	BakedData = InSequence->GetBakedData();
+	if (!BakedData.IsValid() || !BakedData->IsValid())
+	{
+		BakedData.Reset();
+		return false;
+	}
+
+	TArray<UObject*, TInlineAllocator<1>> BoundObjects;
+	for (int32 TrackIndex = 0; TrackIndex < BakedData->Tracks.Num(); TrackIndex++)
+	{
+		const auto& Track = BakedData->Tracks[TrackIndex];
+		BoundObjects.Reset();
+		InSequence->LocateBoundObjects(Track.BindingId, nullptr, BoundObjects);
+		for (auto BoundObject : BoundObjects)
+		{
+			if (BoundObject == nullptr)continue;
+			FTarget Target;
+			Target.TrackIndex = TrackIndex;
+			if (Track.TrackType == ELPrefabBakedTrackType::Transform)
+			{
+				auto SceneComponent = Cast<USceneComponent>(BoundObject);
+				if (auto Actor = Cast<AActor>(BoundObject))
+				{
+					SceneComponent = Actor->GetRootComponent();
+				}
+				if (SceneComponent == nullptr)continue;
+				Target.Object = SceneComponent;
+			}
+			else
+			{
+				if (!FLPrefabBakedSequence::ResolveProperty(BoundObject->GetClass(), Track.PropertyPath, Track.TrackType, Target.PropertyChain, Target.SetterFunction))
+				{
+					UE_LOG(LPrefab, Warning, TEXT("[%s].%d Property '%s' not found on '%s', sequence: '%s'."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__
+						, *Track.PropertyPath, *BoundObject->GetPathName(), *InSequence->GetDisplayNameString());
+					continue;
+				}
+				Target.Object = BoundObject;
+			}
+			Targets.Add(Target);
+		}
+	}
+	Values.SetNumZeroed(BakedData->ChannelStride);
+
+	PlayRate = InSettings.PlayRate;
+	StartTime = FMath::Clamp(InSettings.StartTime, 0.0f, BakedData->Duration);
+	LoopCount = InSettings.LoopCount.Value;
+	bPauseAtEnd = InSettings.bPauseAtEnd;
+	Time = StartTime;
+	CurrentLoop = 0;
+	return true;
+}
+
+void FLPrefabBakedSequencePlayer::Play()
+{
+	if (Sequence.Get() == nullptr || !BakedData.IsValid())return;
+	if (Time >= BakedData->Duration)//paused at end, play from start
+	{
+		Time = 0;
+		CurrentLoop = 0;
+	}
+	bPlaying = true;
+}
+void FLPrefabBakedSequencePlayer::Pause()
+{
+	bPlaying = false;
+}
+void FLPrefabBakedSequencePlayer::Stop()
+{
+	bPlaying = false;
+	Time = StartTime;
+	CurrentLoop = 0;
+}
+
+bool FLPrefabBakedSequencePlayer::Tick(float DeltaSeconds)
+{
+	if (!bPlaying)return false;
+	if (Sequence.Get() == nullptr || !BakedData.IsValid())
+	{
+		bPlaying = false;
+		return true;
+	}
+	const float Duration = BakedData->Duration;
+	Time += DeltaSeconds * PlayRate;
+	bool bFinished = false;
+	if (Time >= Duration)
+	{
+		if (Duration > 0 && LoopCount < 0)
+		{
+			Time = FMath::Fmod(Time, Duration);
+		}
+		else
+		{
+			while (Duration > 0 && Time >= Duration && CurrentLoop < LoopCount)
+			{
+				Time -= Duration;
+				CurrentLoop++;
+			}
+			if (Time >= Duration)
+			{
+				Time = Duration;
+				bFinished = true;
+			}
+		}
+	}
+	Evaluate();
+	if (bFinished)
+	{
+		bPlaying = false;
+		if (!bPauseAtEnd)//same as full player: stop and go to start, but keep the last evaluated values
+		{
+			Time = StartTime;
+			CurrentLoop = 0;
+		}
+	}
+	return bFinished;
+}
+
+void FLPrefabBakedSequencePlayer::Evaluate()
+{
+	SCOPE_CYCLE_COUNTER(STAT_BakedSequenceEvaluate);
+	if (Sequence.Get() == nullptr || !BakedData.IsValid())return;
+	if (Values.Num() != BakedData->ChannelStride)return;
+	BakedData->Sample(Time, Values.GetData());
+
+	for (auto& Target : Targets)
+	{
+		auto Object = Target.Object.Get();
+		if (Object == nullptr)continue;
+		const auto& Track = BakedData->Tracks[Target.TrackIndex];
+		const float* Value = Values.GetData() + Track.ChannelOffset;
+		switch (Track.TrackType)
+		{
+		case ELPrefabBakedTrackType::Transform:
+		{
+			if (auto SceneComponent = Cast<USceneComponent>(Object))
+			{
+				//set rotator directly same as sequencer, FTransform store rotation as quaternion and lose winding
+				const FVector Location(Value[0], Value[1], Value[2]);
+				const FRotator Rotation(Value[4], Value[5], Value[3]);
+				const FVector Scale(Value[6], Value[7], Value[8]);
+				if (SceneComponent->GetRelativeLocation() != Location || SceneComponent->GetRelativeRotation() != Rotation)
+				{
+					SceneComponent->SetRelativeLocationAndRotation(Location, Rotation);
+				}
+				if (SceneComponent->GetRelativeScale3D() != Scale)
+				{
+					SceneComponent->SetRelativeScale3D(Scale);
+				}
+			}
+		}
+		break;
+		case ELPrefabBakedTrackType::Float:
+		{
+			const float FloatValue = Value[0];
+			ApplyPropertyValue(Object, Target, &FloatValue);
+		}
+		break;
+		case ELPrefabBakedTrackType::Double:
+		{
+			const double DoubleValue = Value[0];
+			ApplyPropertyValue(Object, Target, &DoubleValue);
+		}
+		break;
+		case ELPrefabBakedTrackType::Color:
+		{
+			const FLinearColor LinearColor(Value[0], Value[1], Value[2], Value[3]);
+			if (CastFieldChecked<FStructProperty>(Target.PropertyChain.Last())->Struct == TBaseStructure<FColor>::Get())
+			{
+				const FColor Color = LinearColor.ToFColor(true);
+				ApplyPropertyValue(Object, Target, &Color);
+			}
+			else
+			{
+				ApplyPropertyValue(Object, Target, &LinearColor);
+			}
+		}
+		break;
+		}
+	}
+}
+
+void FLPrefabBakedSequencePlayer::ApplyPropertyValue(UObject* InObject, const FTarget& InTarget, const void* InValue)const
+{
+	void* ValuePtr = InObject;
+	for (auto& Property : InTarget.PropertyChain)
+	{
+		ValuePtr = Property->ContainerPtrToValuePtr<void>(ValuePtr);
+	}
+	auto ValueProperty = InTarget.PropertyChain.Last();
+	if (ValueProperty->Identical(ValuePtr, InValue))return;
+	if (InTarget.SetterFunction != nullptr)
+	{
+		auto Function = InTarget.SetterFunction;
+		auto Param = CastField<FProperty>(Function->ChildProperties);
+		uint8* Params = (uint8*)FMemory_Alloca(Function->ParmsSize);
+		FMemory::Memzero(Params, Function->ParmsSize);
+		Param->InitializeValue_InContainer(Params);
+		Param->CopyCompleteValue(Param->ContainerPtrToValuePtr<void>(Params), InValue);
+		InObject->ProcessEvent(Function, Params);
+		Param->DestroyValue_InContainer(Params);
+	}
+	else
+	{
+		ValueProperty->CopyCompleteValue(ValuePtr, InValue);
+	}
+}
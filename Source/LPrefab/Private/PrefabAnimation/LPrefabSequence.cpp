@@ -38,6 +38,7 @@ static TAutoConsoleVariable<FString> CVarDefaultDisplayRate(
 ULPrefabSequence::ULPrefabSequence(const FObjectInitializer& ObjectInitializer)
 	: Super(ObjectInitializer)
 	, MovieScene(nullptr)
+	, SharedMovieScene(nullptr)
 #if WITH_EDITORONLY_DATA
 	, bHasBeenInitialized(false)
 #endif
@@ -150,7 +151,23 @@ void ULPrefabSequence::LocateBoundObjects(const FGuid& ObjectId, UObject* Contex
 
 UMovieScene* ULPrefabSequence::GetMovieScene() const
 {
-	return MovieScene;
+	return SharedMovieScene != nullptr ? SharedMovieScene : MovieScene;
+}
+
+void ULPrefabSequence::UnshareMovieScene()
+{
+	if (SharedMovieScene == nullptr)return;
+	//copy use the same name as own movie scene, so it is still found as default sub object
+	const FName OwnMovieSceneName = MovieScene != nullptr ? MovieScene->GetFName() : FName(TEXT("MovieScene"));
+	if (MovieScene != nullptr)
+	{
+		MovieScene->Rename(nullptr, GetTransientPackage(), REN_DontCreateRedirectors | REN_NonTransactional | REN_DoNotDirty);
+		MovieScene->MarkAsGarbage();
+	}
+	MovieScene = DuplicateObject(SharedMovieScene.Get(), this, OwnMovieSceneName);
+	MovieScene->ClearFlags(RF_Transient);
+	MovieScene->SetFlags(RF_Transactional);
+	SharedMovieScene = nullptr;
 }
 
 UObject* ULPrefabSequence::GetParentObject(UObject* Object) const
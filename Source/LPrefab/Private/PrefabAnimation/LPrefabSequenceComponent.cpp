@@ -3,12 +3,16 @@
 #include "PrefabAnimation/LPrefabSequenceComponent.h"
 #include "PrefabAnimation/LPrefabSequence.h"
 #include "PrefabAnimation/LPrefabSequencePlayer.h"
+#include "PrefabAnimation/LPrefabBakedSequence.h"
 #include "LPrefabModule.h"
 #include "PrefabSystem/LPrefabManager.h"
+#include "TimerManager.h"
+#include "Engine/World.h"
 
 ULPrefabSequenceComponent::ULPrefabSequenceComponent()
 {
-	PrimaryComponentTick.bCanEverTick = false;
+	//only tick when baked sequence is playing
+	PrimaryComponentTick.bCanEverTick = true;
 	PrimaryComponentTick.bStartWithTickEnabled = false;
 	//SequenceEventHandler = FLGUIComponentReference(UActorComponent::StaticClass());
 }
@@ -26,11 +30,10 @@ void ULPrefabSequenceComponent::BeginPlay()
 }
 void ULPrefabSequenceComponent::Awake_Implementation()
 {
-	InitSequencePlayer();
-
+	//player is created when needed, most instances never play
 	if (PlaybackSettings.bAutoPlay)
 	{
-		SequencePlayer->Play();
+		Play();
 	}
 }
 
@@ -43,6 +46,85 @@ void ULPrefabSequenceComponent::EndPlay(const EEndPlayReason::Type EndPlayReason
 		SequencePlayer->Stop();
 		SequencePlayer->TearDown();
 	}
+	BakedPlayer.Reset();
+}
+
+void ULPrefabSequenceComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	if (!BakedPlayer.IsValid() || !BakedPlayer->IsPlaying())
+	{
+		SetComponentTickEnabled(false);
+		return;
+	}
+	if (BakedPlayer->Tick(DeltaTime))
+	{
+		SetComponentTickEnabled(false);
+	}
+}
+
+void ULPrefabSequenceComponent::Play()
+{
+	if (TryPlayBaked())return;
+	GetSequencePlayer()->Play();
+}
+void ULPrefabSequenceComponent::Pause()
+{
+	if (BakedPlayer.IsValid())
+	{
+		BakedPlayer->Pause();
+		SetComponentTickEnabled(false);
+	}
+	if (SequencePlayer)
+	{
+		SequencePlayer->Pause();
+	}
+}
+void ULPrefabSequenceComponent::Stop()
+{
+	StopBakedPlayer();
+	if (SequencePlayer)
+	{
+		SequencePlayer->Stop();
+	}
+}
+bool ULPrefabSequenceComponent::IsPlaying() const
+{
+	return (BakedPlayer.IsValid() && BakedPlayer->IsPlaying())
+		|| (SequencePlayer && SequencePlayer->IsPlaying());
+}
+bool ULPrefabSequenceComponent::TryPlayBaked()
+{
+	//full player is already in use, eg. someone bind its event
+	if (SequencePlayer)return false;
+	auto CurrentSequence = GetCurrentSequence();
+	if (CurrentSequence == nullptr || !CurrentSequence->GetBakedData().IsValid())return false;
+	//restore state and reverse play need full player
+	if (PlaybackSettings.bRestoreState || PlaybackSettings.PlayRate <= 0)return false;
+
+	if (!BakedPlayer.IsValid())
+	{
+		BakedPlayer = MakeShared<FLPrefabBakedSequencePlayer>();
+	}
+	if (!BakedPlayer->IsInitializedWith(CurrentSequence))
+	{
+		if (!BakedPlayer->Initialize(CurrentSequence, PlaybackSettings))
+		{
+			BakedPlayer.Reset();
+			return false;
+		}
+	}
+	BakedPlayer->Play();
+	SetComponentTickEnabled(true);
+	return true;
+}
+void ULPrefabSequenceComponent::StopBakedPlayer()
+{
+	if (BakedPlayer.IsValid())
+	{
+		BakedPlayer->Stop();
+		SetComponentTickEnabled(false);
+	}
 }
 
 #if WITH_EDITOR
@@ -130,12 +212,38 @@ ULPrefabSequence* ULPrefabSequenceComponent::GetSequenceByIndex(int32 InIndex) c
 	return SequenceArray[InIndex];
 }
 
+ULPrefabSequencePlayer* ULPrefabSequenceComponent::GetSequencePlayer()
+{
+	if (!SequencePlayer)
+	{
+		//full player take over, baked player should not animate same objects. carry over time and playing state, so animation continue with full player
+		const bool bBakedPlaying = BakedPlayer.IsValid() && BakedPlayer->IsPlaying();
+		const bool bCarryOverTime = BakedPlayer.IsValid() && BakedPlayer->IsInitializedWith(GetCurrentSequence()) && !BakedPlayer->IsStopped();
+		const float BakedTime = bCarryOverTime ? BakedPlayer->GetTime() : 0.0f;
+		StopBakedPlayer();
+		BakedPlayer.Reset();
+		InitSequencePlayer();
+		if (bCarryOverTime && SequencePlayer->GetSequence() != nullptr)
+		{
+			//baked time is from playback start
+			const FFrameTime PlaybackPosition = SequencePlayer->GetStartTime().Time + SequencePlayer->GetFrameRate().AsFrameTime(BakedTime);
+			SequencePlayer->SetPlaybackPosition(FMovieSceneSequencePlaybackParams(PlaybackPosition, EUpdatePositionMethod::Jump));
+			if (bBakedPlaying)
+			{
+				SequencePlayer->Play();
+			}
+		}
+	}
+	return SequencePlayer;
+}
 void ULPrefabSequenceComponent::InitSequencePlayer()
 {
 	if (!SequencePlayer)
 	{
-		SequencePlayer = NewObject<ULPrefabSequencePlayer>(this, "SequencePlayer");
+		//player could be teared down and created again, old one may not be garbage collected yet
+		SequencePlayer = NewObject<ULPrefabSequencePlayer>(this, MakeUniqueObjectName(this, ULPrefabSequencePlayer::StaticClass(), TEXT("SequencePlayer")));
 		SequencePlayer->SetPlaybackClient(this);
+		SequencePlayer->OnFinished.AddDynamic(this, &ULPrefabSequenceComponent::OnSequencePlayerFinished);
 
 		// Initialize this player for tick as soon as possible to ensure that a persistent
 		// reference to the tick manager is maintained
@@ -144,12 +252,35 @@ void ULPrefabSequenceComponent::InitSequencePlayer()
 	if (auto CurrentSequence = GetCurrentSequence())
 	{
 		SequencePlayer->Initialize(CurrentSequence, PlaybackSettings);
+		//follower player is not evaluated, so there is no state to restore
+		SequencePlayer->SetSharedEvaluationGroup(PlaybackSettings.bRestoreState ? NAME_None : SharedEvaluationGroup);
+	}
+}
+void ULPrefabSequenceComponent::OnSequencePlayerFinished()
+{
+	if (!bTearDownPlayerWhenFinished)return;
+	//player is still updating when broadcast finish, so tear down in next tick
+	if (auto World = this->GetWorld())
+	{
+		World->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateUObject(this, &ULPrefabSequenceComponent::TearDownIdleSequencePlayer));
+	}
+}
+void ULPrefabSequenceComponent::TearDownIdleSequencePlayer()
+{
+	if (SequencePlayer && !SequencePlayer->IsPlaying())//could be played again in finish callback
+	{
+		SequencePlayer->TearDown();
+		SequencePlayer = nullptr;
 	}
 }
 void ULPrefabSequenceComponent::SetSequenceByIndex(int32 InIndex)
 {
 	CurrentSequenceIndex = InIndex;
-	InitSequencePlayer();
+	StopBakedPlayer();
+	if (SequencePlayer)//not created yet, will use current sequence when created
+	{
+		InitSequencePlayer();
+	}
 }
 void ULPrefabSequenceComponent::SetSequenceByName(FName InName)
 {
@@ -160,7 +291,11 @@ void ULPrefabSequenceComponent::SetSequenceByName(FName InName)
 	if (FoundIndex != INDEX_NONE)
 	{
 		CurrentSequenceIndex = FoundIndex;
-		InitSequencePlayer();
+		StopBakedPlayer();
+		if (SequencePlayer)
+		{
+			InitSequencePlayer();
+		}
 	}
 }
 void ULPrefabSequenceComponent::SetSequenceByDisplayName(const FString& InName)
@@ -172,7 +307,11 @@ void ULPrefabSequenceComponent::SetSequenceByDisplayName(const FString& InName)
 	if (FoundIndex != INDEX_NONE)
 	{
 		CurrentSequenceIndex = FoundIndex;
-		InitSequencePlayer();
+		StopBakedPlayer();
+		if (SequencePlayer)
+		{
+			InitSequencePlayer();
+		}
 	}
 }
 
@@ -208,6 +347,10 @@ ULPrefabSequence* ULPrefabSequenceComponent::DuplicateAnimationByIndex(int32 InI
 	auto SourceSequence = SequenceArray[InIndex];
 	auto NewSequence = DuplicateObject(SourceSequence, this);
 	NewSequence->SetDisplayNameString(NewSequence->GetName());
+	if (SourceSequence->IsMovieSceneShared())//own movie scene of source is empty
+	{
+		NewSequence->SetSharedMovieScene(SourceSequence->GetMovieScene());
+	}
 	{
 		NewSequence->GetMovieScene()->SetTickResolutionDirectly(SourceSequence->GetMovieScene()->GetTickResolution());
 		NewSequence->GetMovieScene()->SetPlaybackRange(SourceSequence->GetMovieScene()->GetPlaybackRange());
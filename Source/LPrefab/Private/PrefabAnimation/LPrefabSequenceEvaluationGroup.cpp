@@ -0,0 +1,336 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabAnimation/LPrefabSequenceEvaluationGroup.h"
+#include "PrefabAnimation/LPrefabSequence.h"
+#include "PrefabAnimation/LPrefabSequencePlayer.h"
+#include "MovieScene.h"
+#include "Tracks/MovieScenePropertyTrack.h"
+#include "Tracks/MovieScene3DTransformTrack.h"
+#include "Tracks/MovieSceneFloatTrack.h"
+#include "Tracks/MovieSceneDoubleTrack.h"
+#include "Tracks/MovieSceneBoolTrack.h"
+#include "Tracks/MovieSceneIntegerTrack.h"
+#include "Tracks/MovieSceneByteTrack.h"
+#include "Tracks/MovieSceneEnumTrack.h"
+#include "Tracks/MovieSceneColorTrack.h"
+#include "Tracks/MovieSceneVectorTrack.h"
+#include "Sections/MovieScene3DTransformSection.h"
+#include "Channels/MovieSceneDoubleChannel.h"
+#include "Components/SceneComponent.h"
+#include "GameFramework/Actor.h"
+#include "UObject/ObjectKey.h"
+#include "LPrefabModule.h"
+
+DECLARE_CYCLE_STAT(TEXT("LPrefab CopySequenceEvaluation"), STAT_CopySequenceEvaluation, STATGROUP_LexPrefab);
+
+namespace LPrefabSequenceEvaluationGroup
+{
+	struct FGroupKey
+	{
+		FObjectKey World;
+		FName GroupName;
+		FGuid MovieSceneSignature;
+
+		bool operator==(const FGroupKey& Other)const
+		{
+			return World == Other.World && GroupName == Other.GroupName && MovieSceneSignature == Other.MovieSceneSignature;
+		}
+		friend uint32 GetTypeHash(const FGroupKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Key.World), GetTypeHash(Key.GroupName)), GetTypeHash(Key.MovieSceneSignature));
+		}
+	};
+	static TMap<FGroupKey, TWeakPtr<FLPrefabSequenceEvaluationGroup>> Groups;
+
+	/** Additive and relative section blend with other value of bound object, so result of one player can not be copied to another. */
+	static bool AreAllSectionsAbsolute(UMovieSceneTrack* InTrack)
+	{
+		for (auto Section : InTrack->GetAllSections())
+		{
+			if (Section == nullptr)continue;
+			auto BlendType = Section->GetBlendType();
+			if (BlendType.IsValid() && BlendType.Get() != EMovieSceneBlendType::Absolute)return false;
+		}
+		return true;
+	}
+}
+
+TSharedPtr<FLPrefabSequenceEvaluationGroup> FLPrefabSequenceEvaluationGroup::FindOrCreate(UWorld* InWorld, FName InGroupName, ULPrefabSequence* InSequence)
+{
+	if (InGroupName.IsNone() || InSequence == nullptr)return nullptr;
+	auto MovieScene = InSequence->GetMovieScene();
+	if (MovieScene == nullptr)return nullptr;
+
+	using namespace LPrefabSequenceEvaluationGroup;
+	//copied movie scene keep signature, so instances of same prefab will get same group even if movie scene is not shared
+	FGroupKey Key{ FObjectKey(InWorld), InGroupName, MovieScene->GetSignature() };
+	if (auto GroupPtr = Groups.Find(Key))
+	{
+		if (auto Group = GroupPtr->Pin())
+		{
+			return Group;
+		}
+	}
+	//clear dead groups
+	for (auto It = Groups.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	//spawnable and root tracks (audio, event...) must execute for every player
+	if (MovieScene->GetSpawnableCount() > 0 || MovieScene->GetTracks().Num() > 0)
+	{
+		return nullptr;
+	}
+	auto Group = MakeShared<FLPrefabSequenceEvaluationGroup>();
+	for (auto& Binding : MovieScene->GetBindings())
+	{
+		for (auto& Track : Binding.GetTracks())
+		{
+			if (!CollectTrackToCopy(MovieScene, Binding.GetObjectGuid(), Track, Group->TracksToCopy))
+			{
+				UE_LOG(LPrefab, Log, TEXT("[%s].%d Track '%s' of sequence '%s' can not be copied, sequence will not evaluate in group '%s'.")
+					, ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *Track->GetName(), *InSequence->GetDisplayNameString(), *InGroupName.ToString());
+				return nullptr;
+			}
+		}
+	}
+	Groups.Add(Key, Group);
+	return Group;
+}
+
+bool FLPrefabSequenceEvaluationGroup::CollectTrackToCopy(UMovieScene* InMovieScene, const FGuid& InBindingId, UMovieSceneTrack* InTrack, TArray<FTrackToCopy>& OutTracks)
+{
+	if (InTrack == nullptr)return true;
+	if (!LPrefabSequenceEvaluationGroup::AreAllSectionsAbsolute(InTrack))return false;
+	if (InTrack->GetClass() == UMovieScene3DTransformTrack::StaticClass())
+	{
+		FTrackToCopy Item;
+		Item.BindingId = InBindingId;
+		Item.bIsTransform = true;
+		for (auto Section : InTrack->GetAllSections())
+		{
+			auto TransformSection = Cast<UMovieScene3DTransformSection>(Section);
+			if (TransformSection == nullptr)continue;
+			//channels in proxy have same order as EMovieSceneTransformChannel bits: translation, rotation, scale. Channel without keys still set its default value if it has one
+			const uint32 MaskChannels = (uint32)TransformSection->GetMask().GetChannels();
+			auto Channels = TransformSection->GetChannelProxy().GetChannels<FMovieSceneDoubleChannel>();
+			for (int32 ChannelIndex = 0; ChannelIndex < Channels.Num() && ChannelIndex < 9; ChannelIndex++)
+			{
+				auto Channel = Channels[ChannelIndex];
+				if ((MaskChannels & (1u << ChannelIndex)) != 0 && Channel != nullptr && (Channel->GetNumKeys() > 0 || Channel->GetDefault().IsSet()))
+				{
+					Item.TransformChannels |= 1u << ChannelIndex;
+				}
+			}
+		}
+		if (Item.TransformChannels != 0)
+		{
+			OutTracks.Add(Item);
+		}
+		return true;
+	}
+	//only tracks that just set property value, eg. visibility track is a bool track but do more than set property
+	auto TrackClass = InTrack->GetClass();
+	if (TrackClass != UMovieSceneFloatTrack::StaticClass()
+		&& TrackClass != UMovieSceneDoubleTrack::StaticClass()
+		&& TrackClass != UMovieSceneBoolTrack::StaticClass()
+		&& TrackClass != UMovieSceneIntegerTrack::StaticClass()
+		&& TrackClass != UMovieSceneByteTrack::StaticClass()
+		&& TrackClass != UMovieSceneEnumTrack::StaticClass()
+		&& TrackClass != UMovieSceneColorTrack::StaticClass()
+		&& TrackClass != UMovieSceneFloatVectorTrack::StaticClass()
+		&& TrackClass != UMovieSceneDoubleVectorTrack::StaticClass()
+		)
+	{
+		return false;
+	}
+	auto Possessable = InMovieScene->FindPossessable(InBindingId);
+	if (Possessable == nullptr)return false;
+	UStruct* Struct = const_cast<UClass*>(Possessable->GetPossessedObjectClass());
+	if (Struct == nullptr)return false;
+
+	FTrackToCopy Item;
+	Item.BindingId = InBindingId;
+	TArray<FString> PathSegments;
+	((UMovieScenePropertyTrack*)InTrack)->GetPropertyPath().ToString().ParseIntoArray(PathSegments, TEXT("."));
+	for (int i = 0; i < PathSegments.Num(); i++)
+	{
+		auto Property = FindFProperty<FProperty>(Struct, *PathSegments[i]);
+		if (Property == nullptr)return false;//array element is not supported
+		Item.PropertyChain.Add(Property);
+		if (i + 1 < PathSegments.Num())
+		{
+			auto StructProperty = CastField<FStructProperty>(Property);
+			if (StructProperty == nullptr)return false;
+			Struct = StructProperty->Struct;
+		}
+	}
+	if (Item.PropertyChain.Num() == 0)return false;
+	if (Item.PropertyChain.Num() == 1)
+	{
+		//same as sequencer: use setter function if exist
+		auto Function = ((UClass*)Struct)->FindFunctionByName(*(TEXT("Set") + PathSegments[0]));
+		if (Function != nullptr && Function->NumParms == 1)
+		{
+			auto Param = CastField<FProperty>(Function->ChildProperties);
+			if (Param != nullptr && Param->SameType(Item.PropertyChain[0]))
+			{
+				Item.SetterFunction = Function;
+			}
+		}
+	}
+	OutTracks.Add(Item);
+	return true;
+}
+
+bool FLPrefabSequenceEvaluationGroup::TryFollowEvaluation(ULPrefabSequencePlayer* InPlayer, const FMovieSceneEvaluationRange& InRange, EMovieScenePlayerStatus::Type InStatus)
+{
+	if (Evaluations.Num() > 0 && Evaluations[0].FrameCounter != GFrameCounter)
+	{
+		Evaluations.Reset();
+	}
+	const auto Range = InRange.GetRange();
+	const auto Direction = InRange.GetDirection();
+	for (auto& Evaluation : Evaluations)
+	{
+		if (Evaluation.Status != InStatus || Evaluation.Direction != Direction || Evaluation.Range != Range)continue;
+		auto Evaluator = Evaluation.Evaluator.Get();
+		if (Evaluator == nullptr || Evaluator == InPlayer)continue;
+		if (Evaluation.bEvaluated)
+		{
+			//evaluator is already flushed, eg. jump outside of tick, copy the result now
+			CopyEvaluationResult(Evaluator, InPlayer);
+		}
+		else
+		{
+			Evaluation.Followers.Add(InPlayer);
+		}
+		return true;
+	}
+
+	FEvaluation Evaluation;
+	Evaluation.FrameCounter = GFrameCounter;
+	Evaluation.Range = Range;
+	Evaluation.Direction = Direction;
+	Evaluation.Status = InStatus;
+	Evaluation.Evaluator = InPlayer;
+	Evaluations.Add(Evaluation);
+	return false;
+}
+
+void FLPrefabSequenceEvaluationGroup::OnPlayerEvaluated(ULPrefabSequencePlayer* InPlayer)
+{
+	for (auto& Evaluation : Evaluations)
+	{
+		if (Evaluation.bEvaluated || Evaluation.FrameCounter != GFrameCounter || Evaluation.Evaluator != InPlayer)continue;
+		Evaluation.bEvaluated = true;
+		for (auto& Follower : Evaluation.Followers)
+		{
+			if (auto FollowerPlayer = Follower.Get())
+			{
+				CopyEvaluationResult(InPlayer, FollowerPlayer);
+			}
+		}
+		Evaluation.Followers.Reset();
+	}
+}
+
+void FLPrefabSequenceEvaluationGroup::CopyEvaluationResult(ULPrefabSequencePlayer* InFrom, ULPrefabSequencePlayer* InTo)const
+{
+	SCOPE_CYCLE_COUNTER(STAT_CopySequenceEvaluation);
+	auto FromSequence = Cast<ULPrefabSequence>(InFrom->GetSequence());
+	auto ToSequence = Cast<ULPrefabSequence>(InTo->GetSequence());
+	if (FromSequence == nullptr || ToSequence == nullptr)return;
+	auto FromContext = InFrom->GetPlaybackContext();
+	auto ToContext = InTo->GetPlaybackContext();
+
+	TArray<UObject*, TInlineAllocator<1>> FromObjects, ToObjects;
+	FGuid ResolvedBindingId;
+	for (auto& Track : TracksToCopy)
+	{
+		if (Track.BindingId != ResolvedBindingId)
+		{
+			ResolvedBindingId = Track.BindingId;
+			FromObjects.Reset();
+			ToObjects.Reset();
+			FromSequence->LocateBoundObjects(ResolvedBindingId, FromContext, FromObjects);
+			ToSequence->LocateBoundObjects(ResolvedBindingId, ToContext, ToObjects);
+		}
+		const int32 Count = FMath::Min(FromObjects.Num(), ToObjects.Num());
+		for (int32 i = 0; i < Count; i++)
+		{
+			CopyTrackValue(Track, FromObjects[i], ToObjects[i]);
+		}
+	}
+}
+
+void FLPrefabSequenceEvaluationGroup::CopyTrackValue(const FTrackToCopy& InTrack, UObject* InFrom, UObject* InTo)const
+{
+	if (InTrack.bIsTransform)
+	{
+		auto GetSceneComponent = [](UObject* InObject) {
+			if (auto Actor = Cast<AActor>(InObject))
+			{
+				return Actor->GetRootComponent();
+			}
+			return Cast<USceneComponent>(InObject);
+		};
+		auto FromComp = GetSceneComponent(InFrom);
+		auto ToComp = GetSceneComponent(InTo);
+		if (FromComp == nullptr || ToComp == nullptr)return;
+		//only copy animated channels, others keep the value of this instance
+		const auto& FromLocation = FromComp->GetRelativeLocation();
+		const auto& FromRotation = FromComp->GetRelativeRotation();
+		const auto& FromScale = FromComp->GetRelativeScale3D();
+		auto Location = ToComp->GetRelativeLocation();
+		auto Rotation = ToComp->GetRelativeRotation();
+		auto Scale = ToComp->GetRelativeScale3D();
+		const double FromRotationAxis[3] = { FromRotation.Roll, FromRotation.Pitch, FromRotation.Yaw };
+		double* RotationAxis[3] = { &Rotation.Roll, &Rotation.Pitch, &Rotation.Yaw };
+		for (int32 Axis = 0; Axis < 3; Axis++)
+		{
+			if (InTrack.TransformChannels & (1u << Axis))Location[Axis] = FromLocation[Axis];
+			if (InTrack.TransformChannels & (1u << (Axis + 3)))*RotationAxis[Axis] = FromRotationAxis[Axis];
+			if (InTrack.TransformChannels & (1u << (Axis + 6)))Scale[Axis] = FromScale[Axis];
+		}
+		if (Location != ToComp->GetRelativeLocation() || Rotation != ToComp->GetRelativeRotation())
+		{
+			ToComp->SetRelativeLocationAndRotation(Location, Rotation);
+		}
+		if (Scale != ToComp->GetRelativeScale3D())
+		{
+			ToComp->SetRelativeScale3D(Scale);
+		}
+		return;
+	}
+
+	if (InFrom->GetClass() != InTo->GetClass())return;
+	void* FromValue = InFrom;
+	void* ToValue = InTo;
+	for (auto& Property : InTrack.PropertyChain)
+	{
+		FromValue = Property->ContainerPtrToValuePtr<void>(FromValue);
+		ToValue = Property->ContainerPtrToValuePtr<void>(ToValue);
+	}
+	auto ValueProperty = InTrack.PropertyChain.Last();
+	if (ValueProperty->Identical(FromValue, ToValue))return;
+	if (InTrack.SetterFunction != nullptr)
+	{
+		auto Function = InTrack.SetterFunction;
+		auto Param = CastField<FProperty>(Function->ChildProperties);
+		uint8* Params = (uint8*)FMemory_Alloca(Function->ParmsSize);
+		FMemory::Memzero(Params, Function->ParmsSize);
+		Param->InitializeValue_InContainer(Params);
+		Param->CopyCompleteValue(Param->ContainerPtrToValuePtr<void>(Params), FromValue);
+		InTo->ProcessEvent(Function, Params);
+		Param->DestroyValue_InContainer(Params);
+	}
+	else
+	{
+		ValueProperty->CopyCompleteValue(ToValue, FromValue);
+	}
+}
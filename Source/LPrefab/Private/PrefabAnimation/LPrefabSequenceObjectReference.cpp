@@ -95,6 +95,7 @@ bool FLPrefabSequenceObjectReference::FixObjectReferenceFromEditorHelpers(AActor
 	if (auto FoundHelperActor = GetActorFromContextActorByRelativePath(InContextActor, this->HelperActorPath))
 	{
 		HelperActor = FoundHelperActor;
+		SearchedComponentCount = INDEX_NONE;
 		HelperActorLabel = HelperActor->GetActorLabel();
 		if (HelperClass == AActor::StaticClass())
 		{
@@ -169,6 +170,7 @@ bool FLPrefabSequenceObjectReference::IsEditorHelpersGood(AActor* InContextActor
 
 bool FLPrefabSequenceObjectReference::InitHelpers(AActor* InContextActor)
 {
+	SearchedComponentCount = INDEX_NONE;
 	if (auto Actor = Cast<AActor>(Object))
 	{
 		this->HelperActor = Actor;
@@ -220,6 +222,15 @@ bool FLPrefabSequenceObjectReference::CheckTargetObject()const
 			}
 			else
 			{
+				//components not changed since last failed search, it will fail again
+				const int32 ComponentCount = HelperActor->GetComponents().Num();
+				if (SearchedComponentCount == ComponentCount && SearchedHelperActor == FObjectKey(HelperActor))
+				{
+					return false;
+				}
+				SearchedHelperActor = FObjectKey(HelperActor);
+				SearchedComponentCount = ComponentCount;
+
 				TArray<UActorComponent*> Components;
 				HelperActor->GetComponents(HelperClass, Components);
 				if (Components.Num() == 1)
@@ -250,30 +261,56 @@ UObject* FLPrefabSequenceObjectReference::Resolve() const
 	return Object;
 }
 
+int32 FLPrefabSequenceObjectReferenceMap::FindBindingIndex(const FGuid& ObjectId) const
+{
+	if (bBindingIdToIndexDirty || BindingIdToIndex.Num() != BindingIds.Num())
+	{
+		bBindingIdToIndexDirty = false;
+		BindingIdToIndex.Reset();
+		BindingIdToIndex.Reserve(BindingIds.Num());
+		for (int32 i = 0; i < BindingIds.Num(); i++)
+		{
+			BindingIdToIndex.Add(BindingIds[i], i);
+		}
+	}
+	auto IndexPtr = BindingIdToIndex.Find(ObjectId);
+	return IndexPtr != nullptr ? *IndexPtr : INDEX_NONE;
+}
+
+void FLPrefabSequenceObjectReferenceMap::PostSerialize(const FArchive& Ar)
+{
+	if (Ar.IsLoading())
+	{
+		bBindingIdToIndexDirty = true;
+	}
+}
+
 bool FLPrefabSequenceObjectReferenceMap::HasBinding(const FGuid& ObjectId) const
 {
-	return BindingIds.Contains(ObjectId);
+	return FindBindingIndex(ObjectId) != INDEX_NONE;
 }
 
 void FLPrefabSequenceObjectReferenceMap::RemoveBinding(const FGuid& ObjectId)
 {
-	int32 Index = BindingIds.IndexOfByKey(ObjectId);
+	int32 Index = FindBindingIndex(ObjectId);
 	if (Index != INDEX_NONE)
 	{
 		BindingIds.RemoveAtSwap(Index, 1, false);
 		References.RemoveAtSwap(Index, 1, false);
+		bBindingIdToIndexDirty = true;
 	}
 }
 
 void FLPrefabSequenceObjectReferenceMap::CreateBinding(const FGuid& ObjectId, const FLPrefabSequenceObjectReference& ObjectReference)
 {
-	int32 ExistingIndex = BindingIds.IndexOfByKey(ObjectId);
+	int32 ExistingIndex = FindBindingIndex(ObjectId);
 	if (ExistingIndex == INDEX_NONE)
 	{
 		ExistingIndex = BindingIds.Num();
 
 		BindingIds.Add(ObjectId);
 		References.AddDefaulted();
+		BindingIdToIndex.Add(ObjectId, ExistingIndex);
 	}
 
 	References[ExistingIndex].Array.AddUnique(ObjectReference);
@@ -281,7 +318,7 @@ void FLPrefabSequenceObjectReferenceMap::CreateBinding(const FGuid& ObjectId, co
 
 void FLPrefabSequenceObjectReferenceMap::ResolveBinding(const FGuid& ObjectId, TArray<UObject*, TInlineAllocator<1>>& OutObjects) const
 {
-	int32 Index = BindingIds.IndexOfByKey(ObjectId);
+	int32 Index = FindBindingIndex(ObjectId);
 	if (Index == INDEX_NONE)
 	{
 		return;
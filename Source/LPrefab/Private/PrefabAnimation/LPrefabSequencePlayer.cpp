@@ -2,6 +2,10 @@
 
 #include "PrefabAnimation/LPrefabSequencePlayer.h"
 #include "PrefabAnimation/LPrefabSequenceComponent.h"
+#include "PrefabAnimation/LPrefabSequenceEvaluationGroup.h"
+#include "PrefabSystem/LPrefabManager.h"
+#include "PrefabSystem/LPrefabSettings.h"
+#include "Engine/World.h"
 #include "Engine/BlueprintGeneratedClass.h"
 #include "Engine/SimpleConstructionScript.h"
 
@@ -18,6 +22,70 @@ UObject* ULPrefabSequencePlayer::GetPlaybackContext() const
 	return nullptr;
 }
 
+void ULPrefabSequencePlayer::SetSharedEvaluationGroup(FName InGroupName)
+{
+	EvaluationGroup = FLPrefabSequenceEvaluationGroup::FindOrCreate(this->GetWorld(), InGroupName, Cast<ULPrefabSequence>(Sequence));
+	if (EvaluationGroup.IsValid())
+	{
+		if (!SequenceUpdatedHandle.IsValid())
+		{
+			SequenceUpdatedHandle = OnSequenceUpdated().AddUObject(this, &ULPrefabSequencePlayer::HandleSequenceUpdated);
+		}
+	}
+	else
+	{
+		if (SequenceUpdatedHandle.IsValid())
+		{
+			OnSequenceUpdated().Remove(SequenceUpdatedHandle);
+			SequenceUpdatedHandle.Reset();
+		}
+	}
+}
+
+void ULPrefabSequencePlayer::UpdateMovieSceneInstance(FMovieSceneEvaluationRange InRange, EMovieScenePlayerStatus::Type PlayerStatus, const FMovieSceneUpdateArgs& Args)
+{
+	if (EvaluationGroup.IsValid() && EvaluationGroup->TryFollowEvaluation(this, InRange, PlayerStatus))
+	{
+		//same evaluation is done by other player, result will be copied to our bound objects
+		return;
+	}
+	Super::UpdateMovieSceneInstance(InRange, PlayerStatus, Args);
+}
+
+void ULPrefabSequencePlayer::TickFromSequenceTickManager(float DeltaSeconds, FMovieSceneEntitySystemRunner* Runner)
+{
+	if (ULPrefabSettings::GetScheduleSequencePlayerUpdate())
+	{
+		auto World = this->GetWorld();
+		if (World != nullptr && World->IsGameWorld())
+		{
+			if (auto Subsystem = ULPrefabWorldSubsystem::GetInstance(World))
+			{
+				//skipped time is added to DeltaSeconds of next update, so player catch up with correct time, and events in skipped range are still fired
+				if (!Subsystem->ShouldUpdateSequencePlayer(this, DeltaSeconds, DeltaSeconds))
+				{
+					return;
+				}
+			}
+		}
+	}
+	Super::TickFromSequenceTickManager(DeltaSeconds, Runner);
+}
+
+void ULPrefabSequencePlayer::HandleSequenceUpdated(const UMovieSceneSequencePlayer& Player, FFrameTime CurrentTime, FFrameTime PreviousTime)
+{
+	if (EvaluationGroup.IsValid())
+	{
+		EvaluationGroup->OnPlayerEvaluated(this);
+	}
+}
+
+void ULPrefabSequencePlayer::BeginDestroy()
+{
+	EvaluationGroup.Reset();
+	Super::BeginDestroy();
+}
+
 TArray<UObject*> ULPrefabSequencePlayer::GetEventContexts() const
 {
 	TArray<UObject*> Contexts;
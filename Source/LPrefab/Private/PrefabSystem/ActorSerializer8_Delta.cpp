@@ -0,0 +1,463 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabSystem/ActorSerializer8.h"
+#include "PrefabSystem/LPrefabObjectReaderAndWriter.h"
+#include "PrefabSystem/LPrefabInstanceHandle.h"
+#include "GameFramework/Actor.h"
+#include "Engine/World.h"
+#include "Components/SceneComponent.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/SoftObjectPath.h"
+#include "UObject/Package.h"
+#include "LPrefabModule.h"
+#include "LPrefabUtils.h"
+#include "PrefabSystem/LPrefabManager.h"
+#include "PrefabAnimation/LPrefabSequence.h"
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+UE_DISABLE_OPTIMIZATION
+#endif
+
+DECLARE_CYCLE_STAT(TEXT("LPrefab SaveInstanceDelta"), STAT_SaveInstanceDelta, STATGROUP_LexPrefab);
+DECLARE_CYCLE_STAT(TEXT("LPrefab ApplyInstanceDelta"), STAT_ApplyInstanceDelta, STATGROUP_LexPrefab);
+
+namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
+{
+	bool ActorSerializer::SaveInstanceDelta(ULPrefab* InPrefab, const FLPrefabInstanceHandle& InHandle, TArray<uint8>& OutDelta)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SaveInstanceDelta);
+		auto RootActor = InHandle.GetRootActor();
+		if (!IsValid(RootActor))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Instance handle is not valid!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return false;
+		}
+		if (!IsValid(InPrefab))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d InPrefab is null!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return false;
+		}
+		if (InHandle.GetObjectDataCRC().Num() == 0)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Instance handle have no guid data, it must be created by LoadPrefabWithHandle with newest prefab version!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return false;
+		}
+		auto World = RootActor->GetWorld();
+		//root transform is given by caller when restore, so it is not saved
+		auto RootComponent = RootActor->GetRootComponent();
+
+		//use prefab's reference lists and versions, so object's current data is comparable with prefab's data, and prefab's data can be read to temporary object
+		ActorSerializer PrefabSerializer;
+		PrefabSerializer.TargetWorld = World;
+#if !WITH_EDITOR
+		PrefabSerializer.bIsEditorOrRuntime = false;
+#endif
+		PrefabSerializer.bOverrideVersions = true;
+		FLPrefabSaveData SaveData;
+		PrefabSerializer.LoadSaveDataFromPrefab(InPrefab, SaveData);
+
+		//delta have it's own reference lists
+		ActorSerializer DeltaSerializer;
+		DeltaSerializer.TargetWorld = World;
+#if !WITH_EDITOR
+		DeltaSerializer.bIsEditorOrRuntime = false;
+#endif
+		DeltaSerializer.bOverrideVersions = false;
+
+		FLPrefabInstanceDeltaData DeltaData;
+		TArray<TPair<FGuid, UObject*>> ExistingObjects;
+		TSet<UObject*> ExistingObjectSet;
+		InHandle.ForEachGuidObject([&](const FGuid& InGuid, UObject* InObject) {
+			bool bIsAlive = IsValid(InObject);
+			if (auto Actor = Cast<AActor>(InObject))
+			{
+				bIsAlive = bIsAlive && !Actor->IsActorBeingDestroyed();
+			}
+			else if (auto Comp = Cast<UActorComponent>(InObject))
+			{
+				bIsAlive = bIsAlive && !Comp->IsBeingDestroyed();
+			}
+			if (bIsAlive)
+			{
+				ExistingObjects.Add(TPair<FGuid, UObject*>(InGuid, InObject));
+				ExistingObjectSet.Add(InObject);
+				PrefabSerializer.MapGuidToObject.Add(InGuid, InObject);
+				PrefabSerializer.MapObjectToGuid.Add(InObject, InGuid);
+			}
+			else
+			{
+				DeltaData.DestroyedObjects.Add(InGuid);
+			}
+			});
+		DeltaSerializer.MapGuidToObject = PrefabSerializer.MapGuidToObject;
+		DeltaSerializer.MapObjectToGuid = PrefabSerializer.MapObjectToGuid;
+		for (auto& Actor : InHandle.GetActors())
+		{
+			if (Actor.IsValid() && ExistingObjectSet.Contains(Actor.Get()))
+			{
+				DeltaSerializer.WillSerializeActorArray.Add(Actor.Get());
+			}
+		}
+		{
+			TArray<AActor*> ChildrenActors;
+			LPrefabUtils::CollectChildrenActors(RootActor, ChildrenActors);
+			int32 CreatedActorCount = 0;
+			for (auto& Actor : ChildrenActors)
+			{
+				if (!ExistingObjectSet.Contains(Actor))CreatedActorCount++;
+			}
+			if (CreatedActorCount > 0)
+			{
+				UE_LOG(LPrefab, Warning, TEXT("[%s].%d %d actors attached to instance of prefab '%s' are not created by the prefab, they will not be saved to delta."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, CreatedActorCount, *InPrefab->GetPathName());
+			}
+		}
+		//components created after load, collect them first so references to them can be written
+		for (auto& Actor : DeltaSerializer.WillSerializeActorArray)
+		{
+			for (auto& Comp : Actor->GetComponents())
+			{
+				if (Comp != nullptr && !ExistingObjectSet.Contains(Comp) && !Comp->IsBeingDestroyed())
+				{
+					FGuid Guid;
+					DeltaSerializer.CollectObjectToSerailize(Comp, Guid);
+				}
+			}
+		}
+
+		auto GetAttachParentGuid = [&DeltaSerializer](UObject* InObject) {
+			if (auto SceneComp = Cast<USceneComponent>(InObject))
+			{
+				if (auto AttachParent = SceneComp->GetAttachParent())
+				{
+					if (auto GuidPtr = DeltaSerializer.MapObjectToGuid.Find(AttachParent))
+					{
+						return *GuidPtr;
+					}
+				}
+			}
+			return FGuid();
+		};
+
+		//own movie scene of sequence that use shared movie scene is empty, the shared one is same as prefab's data. See ULPrefabSettings::bShareSequenceAcrossInstances
+		TSet<UObject*> UnusedMovieScenes;
+		for (auto& Item : ExistingObjects)
+		{
+			if (auto Sequence = Cast<ULPrefabSequence>(Item.Value))
+			{
+				if (Sequence->IsMovieSceneShared())
+				{
+					UnusedMovieScenes.Add(Sequence->GetOwnMovieScene());
+				}
+			}
+		}
+
+		//changed objects
+		for (auto& Item : ExistingObjects)
+		{
+			auto& Guid = Item.Key;
+			auto Object = Item.Value;
+			if (UnusedMovieScenes.Contains(Object))continue;
+			const bool bIsSceneComponent = Object->IsA<USceneComponent>();
+			const auto& ExcludeProperties = PrefabSerializer.GetExcludeProperties(bIsSceneComponent);
+
+			if (bIsSceneComponent)
+			{
+				if (auto ParentGuidPtr = SaveData.MapSceneComponentToParent.Find(Guid))
+				{
+					auto CurrentParentGuid = GetAttachParentGuid(Object);
+					if (CurrentParentGuid.IsValid() && CurrentParentGuid != *ParentGuidPtr)
+					{
+						DeltaData.MapSceneComponentToParent.Add(Guid, CurrentParentGuid);
+					}
+				}
+			}
+
+			auto PrefabDataPtr = SaveData.SavedObjectData.Find(Guid);
+			if (PrefabDataPtr == nullptr)
+			{
+				//not in this prefab's data (eg. sub prefab's object), store all properties
+				auto& FullData = DeltaData.FullDataObjects.Add(Guid);
+				LPrefabSystem::FLPrefabObjectWriter Writer(FullData, DeltaSerializer, ExcludeProperties);
+				Writer.DoSerialize(Object);
+				continue;
+			}
+
+			TArray<uint8> CurrentData;
+			{
+				LPrefabSystem::FLPrefabObjectWriter Writer(CurrentData, PrefabSerializer, ExcludeProperties);
+				Writer.DoSerialize(Object);
+			}
+			if (CurrentData == *PrefabDataPtr)continue;//same data with same reference table means same property values
+
+			//read prefab's data to a temporary object, then compare each member property. Data is written as delta to archetype, so temporary object must be created from the same archetype
+			auto TempObject = NewObject<UObject>(GetTransientPackage(), Object->GetClass(), NAME_None, RF_Transient, Object->GetArchetype());
+			{
+				LPrefabSystem::FLPrefabObjectReader Reader(*PrefabDataPtr, PrefabSerializer, ExcludeProperties);
+				Reader.DoSerialize(TempObject);
+			}
+			TArray<FName> ChangedPropertyNames;
+			for (TFieldIterator<FProperty> PropertyItr(Object->GetClass(), EFieldIteratorFlags::IncludeSuper); PropertyItr; ++PropertyItr)
+			{
+				auto Property = *PropertyItr;
+				if (LPrefabSystem::LPrefab_ShouldSkipProperty(Property) || Property->HasAnyPropertyFlags(CPF_Deprecated))continue;
+				if (ExcludeProperties.Contains(Property->GetFName()))continue;
+				for (int32 ArrayIndex = 0; ArrayIndex < Property->ArrayDim; ArrayIndex++)
+				{
+					if (!Property->Identical_InContainer(Object, TempObject, ArrayIndex))
+					{
+						ChangedPropertyNames.Add(Property->GetFName());
+						break;
+					}
+				}
+			}
+			TempObject->MarkAsGarbage();
+			if (Object == RootComponent)
+			{
+				ChangedPropertyNames.Remove(USceneComponent::GetRelativeLocationPropertyName());
+				ChangedPropertyNames.Remove(USceneComponent::GetRelativeRotationPropertyName());
+				ChangedPropertyNames.Remove(USceneComponent::GetRelativeScale3DPropertyName());
+			}
+			if (ChangedPropertyNames.Num() == 0)continue;
+
+			auto& ChangedData = DeltaData.ChangedObjects.Add(Guid);
+			{
+				LPrefabSystem::FLPrefabOverrideParameterObjectWriter Writer(ChangedData.OverrideParameterData, DeltaSerializer, ChangedPropertyNames);
+				Writer.DoSerialize(Object);
+			}
+			ChangedData.OverrideParameterNames = MoveTemp(ChangedPropertyNames);
+		}
+
+		//created objects, new objects could be collected when write data, so array could grow in loop. Outer object is always inserted before sub object
+		for (int i = 0; i < DeltaSerializer.WillSerializeObjectArray.Num(); i++)
+		{
+			auto Object = DeltaSerializer.WillSerializeObjectArray[i];
+			if (ExistingObjectSet.Contains(Object))continue;
+			FLPrefabInstanceDeltaCreatedObject CreatedObject;
+			CreatedObject.ObjectGuid = DeltaSerializer.MapObjectToGuid[Object];
+			if (auto OuterGuidPtr = DeltaSerializer.MapObjectToGuid.Find(Object->GetOuter()))
+			{
+				CreatedObject.OuterObjectGuid = *OuterGuidPtr;
+			}
+			CreatedObject.SceneComponentParentGuid = GetAttachParentGuid(Object);
+			CreatedObject.ObjectClass = DeltaSerializer.FindOrAddClassFromList(Object->GetClass());
+			CreatedObject.ObjectFlags = (uint32)Object->GetFlags();
+			CreatedObject.ObjectName = Object->GetFName();
+			{
+				LPrefabSystem::FLPrefabObjectWriter Writer(CreatedObject.ObjectData, DeltaSerializer, DeltaSerializer.GetExcludeProperties(Object->IsA<USceneComponent>()));
+				Writer.DoSerialize(Object);
+			}
+			DeltaData.CreatedObjects.Add(MoveTemp(CreatedObject));
+		}
+
+		for (auto& Asset : DeltaSerializer.ReferenceAssetList)
+		{
+			DeltaData.ReferenceAssetPaths.Add(Asset != nullptr ? Asset->GetPathName() : FString());
+		}
+		for (auto& Class : DeltaSerializer.ReferenceClassList)
+		{
+			DeltaData.ReferenceClassPaths.Add(Class != nullptr ? Class->GetPathName() : FString());
+		}
+		DeltaData.ReferenceNames = DeltaSerializer.ReferenceNameList;
+
+		OutDelta.Reset();
+		FMemoryWriter ToBinary(OutDelta);
+		ToBinary << DeltaData;
+		return true;
+	}
+
+	AActor* ActorSerializer::RestoreInstanceDelta(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, FVector RelativeLocation, FQuat RelativeRotation, FVector RelativeScale, const TArray<uint8>& InDelta, FLPrefabInstanceHandle* OutInstanceHandle)
+	{
+		if (!IsValid(InWorld))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Not valid world!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return nullptr;
+		}
+		if (!IsValid(InPrefab))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d InPrefab is null!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return nullptr;
+		}
+		FLPrefabInstanceDeltaData DeltaData;
+		{
+			FMemoryReader FromBinary(InDelta);
+			FromBinary << DeltaData;
+			if (FromBinary.IsError() || DeltaData.DeltaVersion != FLPrefabInstanceDeltaData::DeltaVersion_Initial)
+			{
+				UE_LOG(LPrefab, Error, TEXT("[%s].%d Delta data is not valid! Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *InPrefab->GetPathName());
+				return nullptr;
+			}
+		}
+
+		ActorSerializer serializer;
+		serializer.TargetWorld = InWorld;
+		serializer.InstanceHandle = OutInstanceHandle;
+		serializer.InstanceDeltaToApply = &DeltaData;
+#if !WITH_EDITOR
+		serializer.bIsEditorOrRuntime = false;
+#endif
+		serializer.bOverrideVersions = true;
+		serializer.ReaderFunction = [&serializer](UObject* InObject, const TArray<uint8>& InBuffer, bool InIsSceneComponent) {
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
+			LPrefabSystem::FLPrefabObjectReader Reader(InBuffer, serializer, ExcludeProperties);
+			Reader.DoSerialize(InObject);
+		};
+		serializer.WriterOrReaderFunctionForSubPrefabOverride = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNames) {
+			LPrefabSystem::FLPrefabOverrideParameterObjectReader Reader(InOutBuffer, serializer, InOverridePropertyNames);
+			Reader.DoSerialize(InObject);
+		};
+		return serializer.DeserializeActor(Parent, InPrefab, nullptr, true, RelativeLocation, RelativeRotation, RelativeScale);
+	}
+
+	void ActorSerializer::ApplyInstanceDelta(FLPrefabInstanceDeltaData& InDeltaData)
+	{
+		SCOPE_CYCLE_COUNTER(STAT_ApplyInstanceDelta);
+		ActorSerializer DeltaSerializer;
+		DeltaSerializer.TargetWorld = TargetWorld;
+		DeltaSerializer.bIsEditorOrRuntime = bIsEditorOrRuntime;
+		DeltaSerializer.bOverrideVersions = false;
+		for (auto& Path : InDeltaData.ReferenceAssetPaths)
+		{
+			DeltaSerializer.ReferenceAssetList.Add(Path.IsEmpty() ? nullptr : FSoftObjectPath(Path).TryLoad());
+		}
+		for (auto& Path : InDeltaData.ReferenceClassPaths)
+		{
+			DeltaSerializer.ReferenceClassList.Add(Path.IsEmpty() ? nullptr : FSoftClassPath(Path).TryLoadClass<UObject>());
+		}
+		DeltaSerializer.ReferenceNameList = InDeltaData.ReferenceNames;
+		DeltaSerializer.MapGuidToObject = MapGuidToObject;
+
+		AActor* RootActor = AllActors.Num() > 0 ? AllActors[0] : nullptr;
+		//destroyed objects, also remove from collection so they are not registered and Awake will not be called on them
+		auto RemoveComponent = [this](UActorComponent* InComp) {
+			AllComponents.Remove(InComp);
+			ComponentsInThisPrefab.RemoveAll([InComp](const FComponentDataStruct& Item) { return Item.Component == InComp; });
+			SubPrefabRootComponents.RemoveAll([InComp](const FComponentDataStruct& Item) { return Item.Component == InComp; });
+		};
+		for (auto& Guid : InDeltaData.DestroyedObjects)
+		{
+			TObjectPtr<UObject> Object = nullptr;
+			if (!DeltaSerializer.MapGuidToObject.RemoveAndCopyValue(Guid, Object))continue;
+			if (auto Actor = Cast<AActor>(Object))
+			{
+				if (Actor == RootActor)continue;
+				AllActors.Remove(Actor);
+				for (auto& Comp : Actor->GetComponents())
+				{
+					RemoveComponent(Comp);
+				}
+				LPrefabManager->RemoveActorForPrefabSystem(Actor, DeserializationSessionId);
+				if (!Actor->IsActorBeingDestroyed())
+				{
+					Actor->Destroy();
+				}
+			}
+			else if (auto Comp = Cast<UActorComponent>(Object))
+			{
+				RemoveComponent(Comp);
+				if (!Comp->IsBeingDestroyed())
+				{
+					Comp->DestroyComponent();
+				}
+			}
+		}
+
+		//created objects
+		TArray<TPair<UObject*, FLPrefabInstanceDeltaCreatedObject*>> CreatedObjects;
+		for (auto& CreatedObjectData : InDeltaData.CreatedObjects)
+		{
+			auto ObjectClass = DeltaSerializer.FindClassFromListByIndex(CreatedObjectData.ObjectClass);
+			if (ObjectClass == nullptr || ObjectClass->IsChildOf(AActor::StaticClass()))
+			{
+				UE_LOG(LPrefab, Warning, TEXT("[%s].%d Missing or wrong object class when creating object: '%s'. Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(CreatedObjectData.ObjectName.ToString()), *PrefabAssetPath);
+				continue;
+			}
+			auto OuterObjectPtr = DeltaSerializer.MapGuidToObject.Find(CreatedObjectData.OuterObjectGuid);
+			if (OuterObjectPtr == nullptr)
+			{
+				UE_LOG(LPrefab, Warning, TEXT("[%s].%d Missing Outer object when creating object: '%s'. Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(CreatedObjectData.ObjectName.ToString()), *PrefabAssetPath);
+				continue;
+			}
+			auto ObjectName = CreatedObjectData.ObjectName;
+			if (StaticFindObjectFast(nullptr, *OuterObjectPtr, ObjectName) != nullptr)
+			{
+				ObjectName = NAME_None;//name is used by another object
+			}
+			auto CreatedNewObject = NewObject<UObject>(*OuterObjectPtr, ObjectClass, ObjectName, (EObjectFlags)CreatedObjectData.ObjectFlags);
+			DeltaSerializer.MapGuidToObject.Add(CreatedObjectData.ObjectGuid, CreatedNewObject);
+			CreatedObjects.Add(TPair<UObject*, FLPrefabInstanceDeltaCreatedObject*>(CreatedNewObject, &CreatedObjectData));
+		}
+
+		//properties, after all objects are created so references are valid. components are registered after this, so no need to reregister
+		for (auto& Item : CreatedObjects)
+		{
+			LPrefabSystem::FLPrefabObjectReader Reader(Item.Value->ObjectData, DeltaSerializer, DeltaSerializer.GetExcludeProperties(Item.Key->IsA<USceneComponent>()));
+			Reader.DoSerialize(Item.Key);
+		}
+		for (auto& KeyValue : InDeltaData.FullDataObjects)
+		{
+			if (auto ObjectPtr = DeltaSerializer.MapGuidToObject.Find(KeyValue.Key))
+			{
+				LPrefabSystem::FLPrefabObjectReader Reader(KeyValue.Value, DeltaSerializer, DeltaSerializer.GetExcludeProperties(Cast<USceneComponent>(*ObjectPtr) != nullptr));
+				Reader.DoSerialize(*ObjectPtr);
+			}
+		}
+		for (auto& KeyValue : InDeltaData.ChangedObjects)
+		{
+			if (auto ObjectPtr = DeltaSerializer.MapGuidToObject.Find(KeyValue.Key))
+			{
+				LPrefabSystem::FLPrefabOverrideParameterObjectReader Reader(KeyValue.Value.OverrideParameterData, DeltaSerializer, KeyValue.Value.OverrideParameterNames);
+				Reader.DoSerialize(*ObjectPtr);
+			}
+		}
+
+		//attachment, components of this prefab are attached and registered by DeserializeActorFromData with DeltaAttachParent
+		auto FindSceneComponent = [&DeltaSerializer](const FGuid& InGuid)->USceneComponent* {
+			if (auto ObjectPtr = DeltaSerializer.MapGuidToObject.Find(InGuid))
+			{
+				return Cast<USceneComponent>(*ObjectPtr);
+			}
+			return nullptr;
+		};
+		for (auto& KeyValue : InDeltaData.MapSceneComponentToParent)
+		{
+			auto SceneComp = FindSceneComponent(KeyValue.Key);
+			auto ParentComp = FindSceneComponent(KeyValue.Value);
+			if (SceneComp == nullptr || ParentComp == nullptr)continue;
+			if (auto CompDataPtr = ComponentsInThisPrefab.FindByPredicate([SceneComp](const FComponentDataStruct& Item) { return Item.Component == SceneComp; }))
+			{
+				CompDataPtr->DeltaAttachParent = ParentComp;
+			}
+			else if (SceneComp->IsRegistered())//sub prefab's component
+			{
+				SceneComp->AttachToComponent(ParentComp, FAttachmentTransformRules::KeepRelativeTransform);
+			}
+			else
+			{
+				SceneComp->SetupAttachment(ParentComp);
+			}
+		}
+		for (auto& Item : CreatedObjects)
+		{
+			auto CreatedNewComponent = Cast<UActorComponent>(Item.Key);
+			if (CreatedNewComponent == nullptr)continue;
+			FComponentDataStruct CompData;
+			CompData.Component = CreatedNewComponent;
+			if (auto SceneComp = Cast<USceneComponent>(CreatedNewComponent))
+			{
+				auto ParentComp = FindSceneComponent(Item.Value->SceneComponentParentGuid);
+				if (ParentComp == nullptr && SceneComp->GetOwner() != nullptr && SceneComp->GetOwner()->GetRootComponent() != SceneComp)
+				{
+					ParentComp = SceneComp->GetOwner()->GetRootComponent();
+				}
+				CompData.DeltaAttachParent = ParentComp;
+			}
+			ComponentsInThisPrefab.Add(CompData);
+			AllComponents.Add(CreatedNewComponent);
+		}
+	}
+}
+
+#if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
+UE_ENABLE_OPTIMIZATION
+#endif
@@ -1,4 +1,4 @@
-// Copyright 2019-Present LexLiu. All Rights Reserved.
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
 
 #include "PrefabSystem/ActorSerializer8.h"
 #include "PrefabSystem/LPrefabObjectReaderAndWriter.h"
@@ -6,8 +6,11 @@
 #include "Engine/World.h"
 #include "Components/PrimitiveComponent.h"
 #include "Components/SplineComponent.h"
+#include "Components/ActorComponent.h"
 #include "Runtime/Launch/Resources/Version.h"
 #include "PrefabSystem/LPrefabManager.h"
+#include "PrefabSystem/LPrefabHierarchyIndex.h"
+#include "PrefabSystem/LPrefabSharedReferenceTable.h"
 #include "LPrefabModule.h"
 #include "Misc/NetworkVersion.h"
 #include "UObject/UObjectThreadContext.h"
@@ -15,6 +18,10 @@
 #include "Serialization/MemoryReader.h"
 #include "PrefabSystem/ILPrefabInterface.h"
 #include "PhysicsEngine/BodyInstance.h"
+#include "Engine/CollisionProfile.h"
+#include "Physics/Experimental/PhysScene_Chaos.h"
+#include "HAL/IConsoleManager.h"
+#include "PrefabAnimation/LPrefabSequence.h"
 #if WITH_EDITOR
 #include "LPrefabUtils.h"
 #endif
@@ -25,6 +32,8 @@ UE_DISABLE_OPTIMIZATION
 
 #define LOCTEXT_NAMESPACE "LPrefabSystem8_Deserialize"
 
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("LPrefab Shared Sequence Objects"), STAT_SharedSequenceObjects, STATGROUP_LexPrefab);
+
 namespace LPrefabSystem8
 {
 	AActor* ActorSerializer::LoadPrefabWithExistingObjects(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent
@@ -59,9 +68,9 @@ namespace LPrefabSystem8
 		serializer.bIsEditorOrRuntime = false;
 #endif
 		serializer.bOverrideVersions = true;
-		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
-			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
+		serializer.ReaderFunction = [&serializer](UObject* InObject, const TArray<uint8>& InBuffer, bool InIsSceneComponent) {
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
+			LPrefabSystem::FLPrefabObjectReader Reader(InBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
 		serializer.WriterOrReaderFunctionForSubPrefabOverride = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNames) {
@@ -74,6 +83,116 @@ namespace LPrefabSystem8
 		return rootActor;
 	}
 
+	AActor* ActorSerializer::ApplyPrefabToInstance(ULPrefab* InPrefab, FLPrefabInstanceHandle& InOutHandle)
+	{
+		auto RootActor = InOutHandle.GetRootActor();
+		if (!IsValid(RootActor))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Instance handle is not valid!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return nullptr;
+		}
+		if (!IsValid(InPrefab))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d InPrefab is null!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return nullptr;
+		}
+		if (InOutHandle.GetObjectDataCRC().Num() == 0)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Instance handle have no guid data, it must be created by LoadPrefabWithHandle with newest prefab version!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return nullptr;
+		}
+
+		auto World = RootActor->GetWorld();
+		USceneComponent* Parent = nullptr;
+		FTransform RelativeTransform = FTransform::Identity;
+		if (auto RootComp = RootActor->GetRootComponent())
+		{
+			Parent = RootComp->GetAttachParent();
+			RelativeTransform = RootComp->GetRelativeTransform();
+		}
+		//properties of clustered objects will change, so the cluster is not valid anymore
+		if (auto LPrefabManager = ULPrefabWorldSubsystem::GetInstance(World))
+		{
+			LPrefabManager->DissolveInstanceClusterOfActor(RootActor);
+		}
+
+		ActorSerializer serializer;
+		serializer.TargetWorld = World;
+		InOutHandle.GetMapGuidToObject(serializer.MapGuidToObject);
+		for (auto& KeyValue : serializer.MapGuidToObject)
+		{
+			serializer.ExistingObjectsForApply.Add(KeyValue.Value);
+		}
+		serializer.ExistingObjectDataCRC = InOutHandle.GetObjectDataCRC();
+		serializer.ExistingReferenceTableCRC = InOutHandle.GetReferenceTableCRC();
+		serializer.bApplyToExistingInstance = true;
+		FLPrefabInstanceHandle NewHandle;
+		serializer.InstanceHandle = &NewHandle;
+#if !WITH_EDITOR
+		serializer.bIsEditorOrRuntime = false;
+#endif
+		serializer.bOverrideVersions = true;
+		serializer.ReaderFunction = [&serializer](UObject* InObject, const TArray<uint8>& InBuffer, bool InIsSceneComponent) {
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
+			LPrefabSystem::FLPrefabObjectReader Reader(InBuffer, serializer, ExcludeProperties);
+			Reader.DoSerialize(InObject);
+		};
+		serializer.WriterOrReaderFunctionForSubPrefabOverride = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNames) {
+			LPrefabSystem::FLPrefabOverrideParameterObjectReader Reader(InOutBuffer, serializer, InOverridePropertyNames);
+			Reader.DoSerialize(InObject);
+		};
+		//keep root actor's transform
+		auto NewRootActor = serializer.DeserializeActor(Parent, InPrefab, nullptr, true, RelativeTransform.GetLocation(), RelativeTransform.GetRotation(), RelativeTransform.GetScale3D());
+		if (NewRootActor == nullptr)
+		{
+			return nullptr;
+		}
+
+		//destroy objects that not exist in new data
+		TSet<AActor*> NewActors(serializer.AllActors);
+		TSet<UActorComponent*> NewComponents(serializer.AllComponents);
+		for (auto& Comp : InOutHandle.GetComponents())
+		{
+			if (Comp.IsValid() && !Comp->IsBeingDestroyed() && !NewComponents.Contains(Comp.Get()))
+			{
+				auto Owner = Comp->GetOwner();
+				if (Owner != nullptr && NewActors.Contains(Owner))
+				{
+					Comp->DestroyComponent();
+				}
+			}
+		}
+		for (auto& Actor : InOutHandle.GetActors())
+		{
+			if (Actor.IsValid() && !Actor->IsActorBeingDestroyed() && !NewActors.Contains(Actor.Get()))
+			{
+				Actor->Destroy();
+			}
+		}
+		FLPrefabHierarchyIndex::MarkDirty(NewRootActor);//objects are created or destroyed
+		InOutHandle = MoveTemp(NewHandle);
+		return NewRootActor;
+	}
+	uint32 ActorSerializer::CalculateReferenceTableCRC()const
+	{
+		uint32 Result = GetTypeHash(PrefabVersion);
+		Result = HashCombine(Result, GetTypeHash(ArchiveVersion.ToValue()));
+		Result = HashCombine(Result, GetTypeHash(SharedReferenceTable));
+		for (auto& Item : ReferenceAssetList)
+		{
+			Result = HashCombine(Result, GetTypeHash(Item));
+		}
+		for (auto& Item : ReferenceClassList)
+		{
+			Result = HashCombine(Result, GetTypeHash(Item));
+		}
+		for (auto& Item : ReferenceNameList)
+		{
+			Result = HashCombine(Result, GetTypeHash(Item));
+		}
+		return Result;
+	}
+
 	AActor* ActorSerializer::LoadPrefab(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, bool SetRelativeTransformToIdentity, TFunction<void(AActor*)> CallbackBeforeAwake)
 	{
 		if (!IsValid(InWorld))
@@ -94,9 +213,9 @@ namespace LPrefabSystem8
 		serializer.bIsEditorOrRuntime = false;
 #endif
 		serializer.bOverrideVersions = true;
-		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
-			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
+		serializer.ReaderFunction = [&serializer](UObject* InObject, const TArray<uint8>& InBuffer, bool InIsSceneComponent) {
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
+			LPrefabSystem::FLPrefabObjectReader Reader(InBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
 		serializer.WriterOrReaderFunctionForSubPrefabOverride = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNames) {
@@ -114,7 +233,7 @@ namespace LPrefabSystem8
 		}
 		return result;
 	}
-	AActor* ActorSerializer::LoadPrefab(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, FVector RelativeLocation, FQuat RelativeRotation, FVector RelativeScale, TFunction<void(AActor*)> CallbackBeforeAwake)
+	AActor* ActorSerializer::LoadPrefab(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, FVector RelativeLocation, FQuat RelativeRotation, FVector RelativeScale, TFunction<void(AActor*)> CallbackBeforeAwake, FLPrefabInstanceHandle* OutInstanceHandle)
 	{
 		if (!IsValid(InWorld))
 		{
@@ -130,13 +249,14 @@ namespace LPrefabSystem8
 		ActorSerializer serializer;
 		serializer.TargetWorld = InWorld;
 		serializer.CallbackBeforeAwake = CallbackBeforeAwake;
+		serializer.InstanceHandle = OutInstanceHandle;
 #if !WITH_EDITOR
 		serializer.bIsEditorOrRuntime = false;
 #endif
 		serializer.bOverrideVersions = true;
-		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
-			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
+		serializer.ReaderFunction = [&serializer](UObject* InObject, const TArray<uint8>& InBuffer, bool InIsSceneComponent) {
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
+			LPrefabSystem::FLPrefabObjectReader Reader(InBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
 		serializer.WriterOrReaderFunctionForSubPrefabOverride = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNames) {
@@ -145,11 +265,47 @@ namespace LPrefabSystem8
 		};
 		return serializer.DeserializeActor(Parent, InPrefab, nullptr, true, RelativeLocation, RelativeRotation, RelativeScale);
 	}
+	AActor* ActorSerializer::LoadPrefabWithReplacement(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, const TMap<UObject*, UObject*>& InReplaceAssetMap, const TMap<UClass*, UClass*>& InReplaceClassMap, TFunction<void(AActor*)> CallbackBeforeAwake)
+	{
+		if (!IsValid(InWorld))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Not valid world!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return nullptr;
+		}
+		if (!IsValid(InPrefab))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d InPrefab is null!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return nullptr;
+		}
+
+		ActorSerializer serializer;
+		serializer.TargetWorld = InWorld;
+		serializer.CallbackBeforeAwake = CallbackBeforeAwake;
+#if !WITH_EDITOR
+		serializer.bIsEditorOrRuntime = false;
+#endif
+		serializer.bOverrideVersions = true;
+		serializer.ReaderFunction = [&serializer](UObject* InObject, const TArray<uint8>& InBuffer, bool InIsSceneComponent) {
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
+			LPrefabSystem::FLPrefabObjectReader Reader(InBuffer, serializer, ExcludeProperties);
+			Reader.DoSerialize(InObject);
+		};
+		serializer.WriterOrReaderFunctionForSubPrefabOverride = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNames) {
+			LPrefabSystem::FLPrefabOverrideParameterObjectReader Reader(InOutBuffer, serializer, InOverridePropertyNames);
+			Reader.DoSerialize(InObject);
+		};
+		//reference lists are filled from prefab before this callback, replace in these lists so prefab is not changed
+		auto ReplaceReferences = [&serializer, &InReplaceAssetMap, &InReplaceClassMap]() {
+			serializer.bReferenceReplaced = serializer.ApplyReferenceReplacement(InReplaceAssetMap, InReplaceClassMap);
+		};
+		return serializer.DeserializeActor(Parent, InPrefab, ReplaceReferences);
+	}
 	AActor* ActorSerializer::LoadSubPrefab(
 		UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent
 		, const FGuid& InParentDeserializationSessionId
 		, TMap<FGuid, TObjectPtr<UObject>>& InMapGuidToObject
 		, const TFunction<void(AActor*, const TMap<FGuid, TObjectPtr<UObject>>&, const TMap<TObjectPtr<UObject>, FGuid>&, const TArray<AActor*>&, const TArray<UActorComponent*>&)>& InOnSubPrefabFinishDeserializeFunction
+		, ActorSerializer* InParentSerializer, uint32 InSequenceShareOverrideHash
 	)
 	{
 		ActorSerializer serializer;
@@ -161,9 +317,11 @@ namespace LPrefabSystem8
 		serializer.MapGuidToObject = InMapGuidToObject;
 		serializer.DeserializationSessionId = InParentDeserializationSessionId;
 		serializer.bIsSubPrefab = true;
-		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
-			LPrefabSystem::FLPrefabObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
+		serializer.ParentSerializer = InParentSerializer;
+		serializer.SequenceShareOverrideHash = InSequenceShareOverrideHash;
+		serializer.ReaderFunction = [&serializer](UObject* InObject, const TArray<uint8>& InBuffer, bool InIsSceneComponent) {
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
+			LPrefabSystem::FLPrefabObjectReader Reader(InBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
 		serializer.WriterOrReaderFunctionForSubPrefabOverride = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNames) {
@@ -175,6 +333,15 @@ namespace LPrefabSystem8
 		return rootActor;
 	}
 
+	void ActorSerializer::AddCreatedObject(const FGuid& InGuid, UObject* InObject)
+	{
+		AddGuidToObject(InGuid, InObject);
+		if (!bUseSequentialGuid)
+		{
+			MapObjectToOriginGuid.Add(InObject, InGuid);
+		}
+	}
+
 	void ActorSerializer::PostSetPropertiesOnActor(UActorComponent* Comp)
 	{
 		//here two methods to apply the deserialized data to component
@@ -196,9 +363,107 @@ namespace LPrefabSystem8
 		Comp->ReregisterComponent();
 #endif
 	}
+	/**
+	 * Apply collision profile to body instances, every distinct profile is searched only once. Same result as FBodyInstance::LoadProfileData(false) (UCollisionProfile::ReadConfig), which search the profile for every body.
+	 * Collision properties of FBodyInstance are private and the public setters clear the profile name, so write them by reflection.
+	 */
+	struct FLPrefabCollisionProfileApplier
+	{
+		void Apply(FBodyInstance& InBody)
+		{
+			static const FByteProperty* CollisionEnabledProperty = CastField<FByteProperty>(FBodyInstance::StaticStruct()->FindPropertyByName(TEXT("CollisionEnabled")));
+			static const FByteProperty* ObjectTypeProperty = CastField<FByteProperty>(FBodyInstance::StaticStruct()->FindPropertyByName(TEXT("ObjectType")));
+			static const FStructProperty* CollisionResponsesProperty = CastField<FStructProperty>(FBodyInstance::StaticStruct()->FindPropertyByName(TEXT("CollisionResponses")));
+			const FName ProfileName = InBody.GetCollisionProfileName();
+			if (ProfileName == NAME_None || ProfileName == UCollisionProfile::CustomCollisionProfileName
+				|| CollisionEnabledProperty == nullptr || ObjectTypeProperty == nullptr
+				|| CollisionResponsesProperty == nullptr || CollisionResponsesProperty->Struct != FCollisionResponse::StaticStruct()
+				)
+			{
+				InBody.LoadProfileData(false);
+				return;
+			}
+			auto TemplatePtr = ProfileTemplates.Find(ProfileName);
+			if (TemplatePtr == nullptr)
+			{
+				TemplatePtr = &ProfileTemplates.Add(ProfileName);
+				FCollisionResponseTemplate Template;
+				if (UCollisionProfile::Get()->GetProfileTemplate(ProfileName, Template))
+				{
+					*TemplatePtr = Template;
+				}
+			}
+			if (!TemplatePtr->IsSet())//profile not found (or redirected), let the body handle it
+			{
+				InBody.LoadProfileData(false);
+				return;
+			}
+			const auto& Template = TemplatePtr->GetValue();
+			*CollisionEnabledProperty->ContainerPtrToValuePtr<uint8>(&InBody) = Template.CollisionEnabled;
+			*ObjectTypeProperty->ContainerPtrToValuePtr<uint8>(&InBody) = Template.ObjectType;
+			CollisionResponsesProperty->ContainerPtrToValuePtr<FCollisionResponse>(&InBody)->SetCollisionResponseContainer(Template.ResponseToChannels);
+		}
+	private:
+		TMap<FName, TOptional<FCollisionResponseTemplate>> ProfileTemplates;
+	};
+
+	void ActorSerializer::PostSetPropertiesOnComponentsBatched(const TArray<UActorComponent*>& InComps)
+	{
+		//load all collision profiles and unregister all components first
+		FLPrefabCollisionProfileApplier ProfileApplier;
+		TArray<UActorComponent*> ComponentsToRegister;
+		ComponentsToRegister.Reserve(InComps.Num());
+		for (auto& Comp : InComps)
+		{
+			if (!IsValid(Comp))continue;
+			if (auto PrimitiveComp = Cast<UPrimitiveComponent>(Comp))
+			{
+				ProfileApplier.Apply(PrimitiveComp->BodyInstance);
+				if (auto SplineComp = Cast<USplineComponent>(Comp))
+				{
+					SplineComp->UpdateSpline();
+				}
+			}
+			if (Comp->IsRegistered())//same as ReregisterComponent, only registered component need to do it
+			{
+				Comp->UnregisterComponent();
+				ComponentsToRegister.Add(Comp);
+			}
+		}
+		if (ComponentsToRegister.Num() == 0)return;
+
+		//defer physics state creation when register components, use engine's deferred physics creation, then create all bodies together after all components are registered
+		static IConsoleVariable* DeferredPhysicsCreationCVar = IConsoleManager::Get().FindConsoleVariable(TEXT("p.EnableDeferredPhysicsCreation"));
+		auto PhysicsScene = TargetWorld->GetPhysicsScene();
+		const bool bDeferPhysicsCreation = PhysicsScene != nullptr && DeferredPhysicsCreationCVar != nullptr;
+		const bool bOverrideCVar = bDeferPhysicsCreation && DeferredPhysicsCreationCVar->GetInt() == 0;
+		//set with the same priority, so it will not be rejected and will not change the priority of the cvar
+		const auto CVarSetBy = bOverrideCVar ? (EConsoleVariableFlags)(DeferredPhysicsCreationCVar->GetFlags() & ECVF_SetByMask) : ECVF_Default;
+		if (bOverrideCVar)
+		{
+			DeferredPhysicsCreationCVar->Set(1, CVarSetBy);
+		}
+		//register with one context, render primitives are added to scene in one batch when process the context
+		FRegisterComponentContext Context(TargetWorld);
+		for (auto& Comp : ComponentsToRegister)
+		{
+			//component may already be registered by a previous one in this loop (eg. scene component register its attach parent first)
+			if (Comp->IsRegistered())continue;
+			Comp->RegisterComponentWithWorld(TargetWorld, &Context);
+		}
+		Context.Process();
+		if (bOverrideCVar)
+		{
+			DeferredPhysicsCreationCVar->Set(0, CVarSetBy);
+		}
+		if (bDeferPhysicsCreation)
+		{
+			PhysicsScene->ProcessDeferredCreatePhysicsState();
+		}
+	}
 
 #define LPREFAB_LOG_DETAIL_TIME 0
-	AActor* ActorSerializer::DeserializeActorFromData(FLPrefabSaveData& SaveData, USceneComponent* Parent, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale)
+	AActor* ActorSerializer::DeserializeActorFromData(const FLPrefabSaveData& SaveData, USceneComponent* Parent, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale)
 	{
 #if LPREFAB_LOG_DETAIL_TIME
 		auto Time = FDateTime::Now();
@@ -220,7 +485,7 @@ namespace LPrefabSystem8
 		{
 			UE_LOG(LPrefab, Error, TEXT("[%s].%d No actor generated!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
 
-			if (!bIsSubPrefab)
+			if (!bIsSubPrefab && BatchInstanceActors == nullptr)//batch end the session by itself
 			{
 				check(DeserializationSessionId.IsValid());
 				LPrefabManager->EndPrefabSystemProcessingActor(DeserializationSessionId);
@@ -233,11 +498,32 @@ namespace LPrefabSystem8
 		Time = FDateTime::Now();
 #endif
 		//properties
+		const bool bCalculateDataCRC = InstanceHandle != nullptr || bApplyToExistingInstance;
+		const bool bReferenceTableUnchanged = bApplyToExistingInstance && CalculateReferenceTableCRC() == ExistingReferenceTableCRC;
 		for (auto& KeyValue : SaveData.SavedObjectData)
 		{
-			if (auto ObjectPtr = MapGuidToObject.Find(KeyValue.Key))
+			if (bShareSequenceMovieScene && SharedObjectGuids.Contains(KeyValue.Key))continue;//replaced by shared object
+			if (auto Object = FindObjectByGuid(KeyValue.Key))
 			{
-				WriterOrReaderFunction(*ObjectPtr, KeyValue.Value, Cast<USceneComponent>(*ObjectPtr) != nullptr);
+				if (bCalculateDataCRC)
+				{
+					auto DataCRC = FCrc::MemCrc32(KeyValue.Value.GetData(), KeyValue.Value.Num());
+					ObjectDataCRC.Add(KeyValue.Key, DataCRC);
+					if (bApplyToExistingInstance)
+					{
+						//same data with same reference table means same property values, no need to deserialize again
+						if (bReferenceTableUnchanged && ExistingObjectsForApply.Contains(Object))
+						{
+							auto ExistingDataCRCPtr = ExistingObjectDataCRC.Find(KeyValue.Key);
+							if (ExistingDataCRCPtr != nullptr && *ExistingDataCRCPtr == DataCRC)
+							{
+								continue;
+							}
+						}
+						ObjectsChangedByApply.Add(Object);
+					}
+				}
+				ReaderFunction(Object, KeyValue.Value, Cast<USceneComponent>(Object) != nullptr);
 			}
 		}
 
@@ -247,6 +533,46 @@ namespace LPrefabSystem8
 			WriterOrReaderFunctionForSubPrefabOverride(Item.Object, Item.ParameterDatas, Item.ParameterNames);
 		}
 
+		if (bShareSequenceMovieScene)
+		{
+			if (ParentSerializer != nullptr)
+			{
+				//override parameters of parent prefab are not applied yet, let parent share them
+				ParentSerializer->SequencesToShare.Append(SequencesToShare);
+			}
+			else
+			{
+				//this instance keep its own movie scene, and a copy is shared by later instances. The copy is not outered by any instance or prefab, and it is released when the world is teardown
+				for (auto& Item : SequencesToShare)
+				{
+					auto SharedMovieScene = DuplicateObject(Item.Sequence->GetOwnMovieScene(), GetTransientPackage(), MakeUniqueObjectName(GetTransientPackage(), UMovieScene::StaticClass()));
+					SharedMovieScene->SetFlags(RF_Transient);
+					Item.Prefab->SharedSequenceMovieScenes.Add(Item.Key, SharedMovieScene);
+					if (LPrefabManager != nullptr)
+					{
+						LPrefabManager->AddPrefabWithSharedSequence(Item.Prefab);
+					}
+				}
+			}
+			SequencesToShare.Reset();
+			INC_DWORD_STAT_BY(STAT_SharedSequenceObjects, SharedObjectGuids.Num());
+		}
+		//shared movie scene and baked data are not in duplicate data, use the same one as source
+		for (auto& KeyValue : SequenceRuntimeDataForDuplicate)
+		{
+			if (auto Sequence = Cast<ULPrefabSequence>(FindObjectByGuid(KeyValue.Key)))
+			{
+				Sequence->SetSharedMovieScene(KeyValue.Value.SharedMovieScene);
+				Sequence->SetBakedData(KeyValue.Value.BakedData);
+			}
+		}
+
+		//delta modify properties and create/destroy components, so apply it before components are registered
+		if (InstanceDeltaToApply != nullptr && !bIsSubPrefab)
+		{
+			ApplyInstanceDelta(*InstanceDeltaToApply);
+		}
+
 #if LPREFAB_LOG_DETAIL_TIME
 		UE_LOG(LPrefab, Log, TEXT("--DeserializeObject take time: %fms"), (FDateTime::Now() - Time).GetTotalMilliseconds());
 		Time = FDateTime::Now();
@@ -257,13 +583,12 @@ namespace LPrefabSystem8
 		{
 			if (auto SceneComp = Cast<USceneComponent>(CompData.Component))
 			{
-				if (CompData.SceneComponentParentGuid.IsValid())
+				if (CompData.DeltaAttachParent != nullptr || CompData.SceneComponentParentGuid.IsValid())
 				{
-					USceneComponent* ParentComp = nullptr;
-					auto ParentObjectPtr = MapGuidToObject.Find(CompData.SceneComponentParentGuid);
-					if (ParentObjectPtr != nullptr)
+					USceneComponent* ParentComp = CompData.DeltaAttachParent;
+					if (ParentComp == nullptr)
 					{
-						ParentComp = Cast<USceneComponent>(*ParentObjectPtr);
+						ParentComp = Cast<USceneComponent>(FindObjectByGuid(CompData.SceneComponentParentGuid));
 					}
 					if (!ParentComp)
 					{
@@ -308,10 +633,26 @@ namespace LPrefabSystem8
 
 		if (!bIsSubPrefab)//sub-prefab's re-register should handle in parent after all override property
 		{
+			//apply to existing instance only need to update changed or newly created components
+			TArray<UActorComponent*> ChangedComponents;
+			if (bApplyToExistingInstance)
+			{
+				ChangedComponents = AllComponents.FilterByPredicate([this](const UActorComponent* Comp) {
+					return ObjectsChangedByApply.Contains(Comp) || !ExistingObjectsForApply.Contains(Comp);
+					});
+			}
+			const auto& ComponentsToUpdate = bApplyToExistingInstance ? ChangedComponents : AllComponents;
 			//mark component reregister to use new property value
-			for (auto& Comp : AllComponents)
+			if (ULPrefabSettings::GetBatchComponentRegistration())
 			{
-				PostSetPropertiesOnActor(Comp);
+				PostSetPropertiesOnComponentsBatched(ComponentsToUpdate);
+			}
+			else
+			{
+				for (auto& Comp : ComponentsToUpdate)
+				{
+					PostSetPropertiesOnActor(Comp);
+				}
 			}
 		}
 
@@ -321,6 +662,10 @@ namespace LPrefabSystem8
 			if (Parent)
 			{
 				RootComp->AttachToComponent(Parent, FAttachmentTransformRules::KeepRelativeTransform);
+				if (!bIsSubPrefab)
+				{
+					FLPrefabHierarchyIndex::MarkDirty(Parent->GetOwner());//new actors under indexed hierarchy
+				}
 			}
 			if (!bIsSubPrefab)//need to do this in root actor and it will propogate to children. If do this in subprefab and parent prefab override transform data on subprefab's actor, then transform goes wrong
 			{
@@ -332,6 +677,10 @@ namespace LPrefabSystem8
 				RootComp->SetRelativeScale3D(InScale);
 			}
 		}
+		if (bApplyToExistingInstance && !bIsSubPrefab)
+		{
+			FLPrefabHierarchyIndex::MarkDirty(CreatedRootActor);//existing actors are re-attached above, mark before Awake of new objects
+		}
 
 #if WITH_EDITOR
 		if (!bIsSubPrefab)//sub-prefab's RerunConstructionScripts should handle in parent after all override property, and after root actor attach to parent
@@ -353,6 +702,16 @@ namespace LPrefabSystem8
 		{
 			OnSubPrefabFinishDeserializeFunction(CreatedRootActor, MapGuidToObject, MapObjectToOriginGuid, AllActors, AllComponents);
 		}
+		if (InstanceHandle != nullptr && !bIsSubPrefab)
+		{
+			InstanceHandle->Init(CreatedRootActor, AllActors, AllComponents, MapGuidToObject);
+			InstanceHandle->SetDataCRC(MoveTemp(ObjectDataCRC), CalculateReferenceTableCRC());
+		}
+		if (LoadingPrefab != nullptr)
+		{
+			//register before Awake, so Awake can find this instance
+			LPrefabManager->RegisterPrefabInstance(LoadingPrefab, CreatedRootActor);
+		}
 		if (CallbackBeforeAwake != nullptr)
 		{
 			CallbackBeforeAwake(CreatedRootActor);
@@ -363,19 +722,42 @@ namespace LPrefabSystem8
 #endif
 		if (!bIsSubPrefab)
 		{
-			check(DeserializationSessionId.IsValid());
-			for (auto item : AllActors)
+			if (BatchInstanceActors != nullptr)
 			{
-				LPrefabManager->RemoveActorForPrefabSystem(item, DeserializationSessionId);
+				//finish together with other copies of the batch
+				BatchInstanceActors->Add(AllActors);
+			}
+			else
+			{
+				FinishDeserialize(MakeArrayView(&AllActors, 1));
 			}
-			LPrefabManager->EndPrefabSystemProcessingActor(DeserializationSessionId);
+		}
+
+#if LPREFAB_LOG_DETAIL_TIME
+		UE_LOG(LPrefab, Log, TEXT("--Call Awake (and OnEnable) take time: %fms"), (FDateTime::Now() - Time).GetTotalMilliseconds());
+#endif
 
+		return CreatedRootActor;
+	}
+	void ActorSerializer::FinishDeserialize(TConstArrayView<TArray<AActor*>> InInstanceActors)
+	{
+		check(DeserializationSessionId.IsValid());
+		for (auto& Actors : InInstanceActors)
+		{
+			for (auto item : Actors)
+			{
+				LPrefabManager->RemoveActorForPrefabSystem(item, DeserializationSessionId);
+			}
+		}
+		LPrefabManager->EndPrefabSystemProcessingActor(DeserializationSessionId);
+		for (auto& Actors : InInstanceActors)
+		{
 #if WITH_EDITOR
 			if (!TargetWorld->IsGameWorld())
 			{
-				for (int i = 0; i < AllActors.Num(); i++)
+				for (int i = 0; i < Actors.Num(); i++)
 				{
-					auto& Actor = AllActors[i];
+					auto& Actor = Actors[i];
 					if (Actor->GetClass()->ImplementsInterface(ULPrefabInterface::StaticClass()))
 					{
 						ILPrefabInterface::Execute_EditorAwake(Actor);
@@ -393,34 +775,36 @@ namespace LPrefabSystem8
 			else
 #endif
 			{
-				for (int i = 0; i < AllActors.Num(); i++)
+				for (int i = 0; i < Actors.Num(); i++)
 				{
-					auto& Actor = AllActors[i];
-					if (Actor->GetClass()->ImplementsInterface(ULPrefabInterface::StaticClass()))
+					auto& Actor = Actors[i];
+					if (Actor->GetClass()->ImplementsInterface(ULPrefabInterface::StaticClass())
+						&& !ExistingObjectsForApply.Contains(Actor)//apply to existing instance only call Awake on newly created objects
+						)
 					{
 						ILPrefabInterface::Execute_Awake(Actor);
 					}
 					auto Components = Actor->GetComponents();
 					for (auto& Comp : Components)
 					{
-						if (Comp->GetClass()->ImplementsInterface(ULPrefabInterface::StaticClass()))
+						if (Comp->GetClass()->ImplementsInterface(ULPrefabInterface::StaticClass())
+							&& !ExistingObjectsForApply.Contains(Comp)
+							)
 						{
 							ILPrefabInterface::Execute_Awake(Comp);
 						}
 					}
 				}
+				//cluster is created after Awake, so objects created in Awake are also included
+				if (ULPrefabSettings::GetCreateGCClusterForPrefabInstance() && !bApplyToExistingInstance)
+				{
+					LPrefabManager->CreateInstanceCluster(Actors);
+				}
 			}
 		}
-
-#if LPREFAB_LOG_DETAIL_TIME
-		UE_LOG(LPrefab, Log, TEXT("--Call Awake (and OnEnable) take time: %fms"), (FDateTime::Now() - Time).GetTotalMilliseconds());
-#endif
-
-		return CreatedRootActor;
 	}
-	AActor* ActorSerializer::DeserializeActor(USceneComponent* Parent, ULPrefab* InPrefab, const TFunction<void()>& InCallbackBeforeDeserialize, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale)
+	void ActorSerializer::LoadSaveDataFromPrefab(ULPrefab* InPrefab, FLPrefabSaveData& OutSaveData)
 	{
-		auto StartTime = FDateTime::Now();
 		PrefabAssetPath = InPrefab->GetPathName();
 #if WITH_EDITOR
 		if (bIsEditorOrRuntime)
@@ -442,6 +826,7 @@ namespace LPrefabSystem8
 			this->ReferenceAssetList = InPrefab->ReferenceAssetListForBuild;
 			this->ReferenceClassList = InPrefab->ReferenceClassListForBuild;
 			this->ReferenceNameList = InPrefab->ReferenceNameListForBuild;
+			this->SharedReferenceTable = InPrefab->SharedReferenceTableForBuild;
 
 			this->ArchiveVersion = FPackageFileVersion(InPrefab->ArchiveVersion_ForBuild, (EUnrealEngineObjectUE5Version)InPrefab->ArchiveVersionUE5_ForBuild);
 			this->ArchiveLicenseeVer = InPrefab->ArchiveLicenseeVer_ForBuild;
@@ -451,28 +836,40 @@ namespace LPrefabSystem8
 		this->PrefabVersion = InPrefab->PrefabVersion;
 		this->ArEngineVer = FEngineVersionBase(InPrefab->EngineMajorVersion, InPrefab->EngineMinorVersion, InPrefab->EnginePatchVersion);
 
-		FLPrefabSaveData SaveData;
-		{
-			auto& LoadedData =
+		//runtime data could be inside prefab bundle file, read directly from it
+		auto LoadedData =
 #if WITH_EDITOR
-				bIsEditorOrRuntime ? InPrefab->BinaryData :
+			bIsEditorOrRuntime ? TArrayView64<const uint8>(InPrefab->BinaryData.GetData(), InPrefab->BinaryData.Num()) :
 #endif
-				InPrefab->BinaryDataForBuild;
+			InPrefab->GetBinaryDataForBuild();
 
-			auto FromBinary = FMemoryReader(LoadedData, false);
+		auto FromBinary = FMemoryReaderView(LoadedData, false);
 #if WITH_EDITOR
-			if (bIsEditorOrRuntime)
-			{
-				FStructuredArchiveFromArchive(FromBinary).GetSlot() << SaveData;
-			}
-			else
+		if (bIsEditorOrRuntime)
+		{
+			FStructuredArchiveFromArchive(FromBinary).GetSlot() << OutSaveData;
+		}
+		else
 #endif
-			{
-				FromBinary << SaveData;
-			}
+		{
+			FromBinary << OutSaveData;
 		}
+	}
+	AActor* ActorSerializer::DeserializeActor(USceneComponent* Parent, ULPrefab* InPrefab, const TFunction<void()>& InCallbackBeforeDeserialize, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale)
+	{
+		auto StartTime = FDateTime::Now();
+		FLPrefabSaveData SaveData;
+		LoadSaveDataFromPrefab(InPrefab, SaveData);
 
 		if (InCallbackBeforeDeserialize != nullptr)InCallbackBeforeDeserialize();
+		LoadingPrefab = InPrefab;
+		//prefab data will not change in game world. existing objects are reused so not share. Sub-prefab can only share if parent share, because parent's override parameters are part of the key
+		bShareSequenceMovieScene = ULPrefabSettings::GetShareSequenceAcrossInstances()
+			&& TargetWorld->IsGameWorld()
+			&& !bApplyToExistingInstance
+			&& MapGuidToObject.Num() == 0
+			&& !bReferenceReplaced
+			&& (!bIsSubPrefab || (ParentSerializer != nullptr && ParentSerializer->bShareSequenceMovieScene));
 		auto CreatedRootActor = DeserializeActorFromData(SaveData, Parent, ReplaceTransform, InLocation, InRotation, InScale);
 
 		if (ULPrefabSettings::GetLogPrefabLoadTime())
@@ -491,9 +888,9 @@ namespace LPrefabSystem8
 
 
 
-	void ActorSerializer::GenerateObjectArray(TMap<FGuid, FLGUIObjectSaveData>& SavedObjects, TMap<FGuid, FGuid>& MapSceneComponentToParent)
+	void ActorSerializer::GenerateObjectArray(const TMap<FGuid, FLGUIObjectSaveData>& SavedObjects, const TMap<FGuid, FGuid>& MapSceneComponentToParent)
 	{
-		auto CollectDefaultSubobjects = [&](UObject* Target, const FGuid& TargetGuid, FLGUICommonObjectSaveData& ObjectData) {
+		auto CollectDefaultSubobjects = [&](UObject* Target, const FGuid& TargetGuid, const FLGUICommonObjectSaveData& ObjectData) {
 			//collect default sub object
 			TArray<UObject*> DefaultSubObjects;
 			Target->CollectDefaultSubobjects(DefaultSubObjects);
@@ -514,8 +911,7 @@ namespace LPrefabSystem8
 					continue;
 				}
 				auto DefaultSubObjectGuid = ObjectData.DefaultSubObjectGuidArray[Index];
-				MapGuidToObject.Add(DefaultSubObjectGuid, DefaultSubObject);
-				MapObjectToOriginGuid.Add(DefaultSubObject, DefaultSubObjectGuid);
+				AddCreatedObject(DefaultSubObjectGuid, DefaultSubObject);
 			}
 		};
 		for (auto& KeyValuePair : SavedObjects)
@@ -523,17 +919,25 @@ namespace LPrefabSystem8
 			auto& ObjectGuid = KeyValuePair.Key;
 			auto& ObjectData = KeyValuePair.Value;
 			UObject* CreatedNewObject = nullptr;
-#if WITH_EDITOR
-			//MapGuidToObject can passed from LoadPrefabWithExistingObjects, so we need to find from map first. This only needed in editor, because runtime never use LoadPrefabWithExistingObjects
+			//MapGuidToObject can passed from LoadPrefabWithExistingObjects or ApplyPrefabToInstance, so we need to find from map first
 			if (auto ObjectPtr = MapGuidToObject.Find(ObjectGuid))
 			{
 				CreatedNewObject = *ObjectPtr;
 				MapObjectToOriginGuid.Add(CreatedNewObject, ObjectGuid);
 				CollectDefaultSubobjects(CreatedNewObject, ObjectGuid, ObjectData);
+				if (auto Sequence = Cast<ULPrefabSequence>(CreatedNewObject))
+				{
+					Sequence->SetSharedMovieScene(nullptr);//existing sequence use its own movie scene, which will be filled with prefab data, eg. ApplyPrefabToInstance
+					Sequence->SetBakedData(FindBakedSequence(ObjectGuid));
+				}
 			}
 			else
-#endif
 			{
+				if (bShareSequenceMovieScene && SharedObjectGuids.Contains(ObjectData.OuterObjectGuid))//outer is replaced by shared object
+				{
+					SharedObjectGuids.Add(ObjectGuid);
+					continue;
+				}
 				if (auto ObjectClass = FindClassFromListByIndex(ObjectData.ObjectClass))
 				{
 					if (ObjectClass->IsChildOf(AActor::StaticClass()))
@@ -542,12 +946,19 @@ namespace LPrefabSystem8
 						continue;
 					}
 
-					if (auto OuterObjectPtr = MapGuidToObject.Find(ObjectData.OuterObjectGuid))
+					if (auto OuterObject = FindObjectByGuid(ObjectData.OuterObjectGuid))
 					{
-						CreatedNewObject = NewObject<UObject>(*OuterObjectPtr, ObjectClass, ObjectData.ObjectName, (EObjectFlags)ObjectData.ObjectFlags);
-						MapGuidToObject.Add(ObjectGuid, CreatedNewObject);
-						MapObjectToOriginGuid.Add(CreatedNewObject, ObjectGuid);
+						CreatedNewObject = NewObject<UObject>(OuterObject, ObjectClass, ObjectData.ObjectName, (EObjectFlags)ObjectData.ObjectFlags);
+						AddCreatedObject(ObjectGuid, CreatedNewObject);
 						CollectDefaultSubobjects(CreatedNewObject, ObjectGuid, ObjectData);
+						if (auto Sequence = Cast<ULPrefabSequence>(CreatedNewObject))
+						{
+							if (bShareSequenceMovieScene)
+							{
+								ShareSequenceMovieScene(Sequence, ObjectGuid, ObjectData);
+							}
+							Sequence->SetBakedData(FindBakedSequence(ObjectGuid));
+						}
 					}
 					else
 					{
@@ -570,7 +981,34 @@ namespace LPrefabSystem8
 		}
 	}
 
-	AActor* ActorSerializer::GenerateActorArray(TArray<FLGUIActorSaveData>& SavedActors, TMap<FGuid, FLGUIObjectSaveData>& SavedObjects, TMap<FGuid, FGuid>& MapSceneComponentToParent, FGuid ParentGuid)
+	TSharedPtr<const FLPrefabBakedSequence> ActorSerializer::FindBakedSequence(const FGuid& InSequenceGuid)const
+	{
+		//baked data is only in runtime data, editor data may be changed after cook
+		if (bIsEditorOrRuntime || LoadingPrefab == nullptr)return nullptr;
+		return LoadingPrefab->FindBakedSequence(InSequenceGuid);
+	}
+	void ActorSerializer::ShareSequenceMovieScene(ULPrefabSequence* InSequence, const FGuid& InSequenceGuid, const FLGUICommonObjectSaveData& InObjectData)
+	{
+		auto OwnMovieScene = InSequence->GetOwnMovieScene();
+		if (OwnMovieScene == nullptr)return;
+		auto Index = InObjectData.DefaultSubObjectNameArray.IndexOfByKey(OwnMovieScene->GetFName());
+		if (Index == INDEX_NONE)return;
+		//parent's override parameters may change objects in movie scene, so they are part of the key
+		const FGuid Key(InSequenceGuid.A, InSequenceGuid.B, InSequenceGuid.C, InSequenceGuid.D ^ SequenceShareOverrideHash);
+		auto SharedMovieScenePtr = LoadingPrefab->SharedSequenceMovieScenes.Find(Key);
+		if (SharedMovieScenePtr != nullptr && *SharedMovieScenePtr != nullptr)
+		{
+			InSequence->SetSharedMovieScene(*SharedMovieScenePtr);
+			//own movie scene stay empty, objects inside it (tracks, sections) will not be created
+			SharedObjectGuids.Add(InObjectData.DefaultSubObjectGuidArray[Index]);
+		}
+		else
+		{
+			SequencesToShare.Add({ LoadingPrefab, Key, InSequence });
+		}
+	}
+
+	AActor* ActorSerializer::GenerateActorArray(const TArray<FLGUIActorSaveData>& SavedActors, const TMap<FGuid, FLGUIObjectSaveData>& SavedObjects, const TMap<FGuid, FGuid>& MapSceneComponentToParent, FGuid ParentGuid)
 	{
 		AActor* RootActor = nullptr;//first actor is the RootActor
 		for (int i = 0; i < SavedActors.Num(); i++)
@@ -601,9 +1039,8 @@ namespace LPrefabSystem8
 							{
 								MapObjectGuidFromSubPrefabToParentPrefab.Add(KeyValue.Value, KeyValue.Key);
 							}
-#if WITH_EDITOR
-							//edit mode must check if the object already exist, because the deserialize process could happen when use revert-prefab
-							if (bIsEditorOrRuntime)
+							//edit mode must check if the object already exist, because the deserialize process could happen when use revert-prefab. ApplyPrefabToInstance also reuse existing objects
+							if (bIsEditorOrRuntime || bApplyToExistingInstance)
 							{
 								for (auto& KeyValue : MapObjectGuidFromSubPrefabToParentPrefab)
 								{
@@ -614,7 +1051,8 @@ namespace LPrefabSystem8
 									}
 								}
 							}
-#endif
+							//newly created id is only needed during this load, so use a copy and keep save data unchanged
+							auto MapObjectIdToNewlyCreatedId = InActorData.MapObjectIdToNewlyCreatedId;
 							bool bAnyGuidFrom_MapObjectIdToNewlyCreatedId = false;
 							auto GetObjectGuidInParent = [&](const FGuid& GuidInSubPrefab, const FGuid& GuidInOriginPrefab) {
 								FGuid GuidInParent;
@@ -622,14 +1060,14 @@ namespace LPrefabSystem8
 								if (ObjectGuidInParentPrefabPtr == nullptr)
 								{
 									auto UniqueId = FLGUISubPrefabObjectUniqueIdSaveData{ InActorData.ActorGuid, GuidInOriginPrefab };
-									if (auto GuidInParentPtr = InActorData.MapObjectIdToNewlyCreatedId.Find(UniqueId))
+									if (auto GuidInParentPtr = MapObjectIdToNewlyCreatedId.Find(UniqueId))
 									{
 										GuidInParent = *GuidInParentPtr;
 									}
 									else
 									{
 										GuidInParent = FGuid::NewGuid();
-										InActorData.MapObjectIdToNewlyCreatedId.Add(UniqueId, GuidInParent);
+										MapObjectIdToNewlyCreatedId.Add(UniqueId, GuidInParent);
 									}
 									bAnyGuidFrom_MapObjectIdToNewlyCreatedId = true;
 									MapObjectGuidFromSubPrefabToParentPrefab.Add(GuidInSubPrefab, GuidInParent);
@@ -671,18 +1109,11 @@ namespace LPrefabSystem8
 										MapGuidToObject.Add(GuidInParent, ObjectInSubPrefab);
 									}
 								}
-								//if we don't need to get any guid from MapObjectIdToNewlyCreatedId, that means subprefab already have a persistent guid for all objects, then we can clear the data
-								if (!bAnyGuidFrom_MapObjectIdToNewlyCreatedId)
-								{
-									if (InActorData.MapObjectIdToNewlyCreatedId.Num() > 0)
-									{
-										InActorData.MapObjectIdToNewlyCreatedId.Empty();
-									}
-								}
-								else
+								//if we don't need to get any guid from MapObjectIdToNewlyCreatedId, that means subprefab already have a persistent guid for all objects, then no need to keep the data
+								if (bAnyGuidFrom_MapObjectIdToNewlyCreatedId)
 								{
 									//convert data to save
-									for (auto& DataItem : InActorData.MapObjectIdToNewlyCreatedId)
+									for (auto& DataItem : MapObjectIdToNewlyCreatedId)
 									{
 										SubPrefabData.MapObjectIdToNewlyCreatedId.Add({ DataItem.Key.RootActorGuidInParentPrefab, DataItem.Key.ObjectGuidInOrignPrefab }, DataItem.Value);
 									}
@@ -690,11 +1121,28 @@ namespace LPrefabSystem8
 								//collect sub-prefab's actor to parent prefab
 								AllActors.Append(InSubActors);
 								AllComponents.Append(InSubComponents);
+								if (bApplyToExistingInstance)//sub-prefab's properties are always deserialized
+								{
+									for (auto& Comp : InSubComponents)
+									{
+										ObjectsChangedByApply.Add(Comp);
+									}
+								}
 								MapObjectToOriginGuid.Append(InMapObjectToOriginGuid);
 								};
 
+							uint32 SubPrefabSequenceShareOverrideHash = SequenceShareOverrideHash;
+							if (bShareSequenceMovieScene)
+							{
+								for (auto& KeyValue : InActorData.MapObjectGuidToSubPrefabOverrideParameter)
+								{
+									SubPrefabSequenceShareOverrideHash = HashCombine(SubPrefabSequenceShareOverrideHash, GetTypeHash(KeyValue.Key));
+									SubPrefabSequenceShareOverrideHash = FCrc::MemCrc32(KeyValue.Value.OverrideParameterData.GetData(), KeyValue.Value.OverrideParameterData.Num(), SubPrefabSequenceShareOverrideHash);
+								}
+							}
 							SubPrefabRootActor = ActorSerializer::LoadSubPrefab(this->TargetWorld, SubPrefabAsset, nullptr, DeserializationSessionId, SubMapGuidToObject
 								, NewOnSubPrefabFinishDeserializeFunction
+								, this, SubPrefabSequenceShareOverrideHash
 							);
 						}
 						
@@ -751,15 +1199,13 @@ namespace LPrefabSystem8
 								continue;
 							}
 							auto DefaultSubObjectGuid = InActorData.DefaultSubObjectGuidArray[Index];
-							MapGuidToObject.Add(DefaultSubObjectGuid, DefaultSubObject);
-							MapObjectToOriginGuid.Add(DefaultSubObject, DefaultSubObjectGuid);
+							AddCreatedObject(DefaultSubObjectGuid, DefaultSubObject);
 						}
 						};
 
 					AActor* NewActor = nullptr;
 					bool bNeedFinishSpawn = false;
-#if WITH_EDITOR
-					//MapGuidToObject can passed from LoadPrefabWithExistingObjects, so we need to find from map first. This only needed in editor, because runtime never use LoadPrefabWithExistingObjects
+					//MapGuidToObject can passed from LoadPrefabWithExistingObjects or ApplyPrefabToInstance, so we need to find from map first
 					if (auto ActorPtr = MapGuidToObject.Find(InActorData.ActorGuid))
 					{
 						NewActor = (AActor*)(*ActorPtr);
@@ -767,7 +1213,6 @@ namespace LPrefabSystem8
 						CollectDefaultSubobjects(NewActor);
 					}
 					else
-#endif
 					{
 						FActorSpawnParameters Spawnparameters;
 						Spawnparameters.ObjectFlags = (EObjectFlags)InActorData.ObjectFlags;
@@ -784,8 +1229,7 @@ namespace LPrefabSystem8
 						}
 #endif
 						NewActor = TargetWorld->SpawnActor<AActor>(ActorClass, Spawnparameters);
-						MapGuidToObject.Add(InActorData.ActorGuid, NewActor);
-						MapObjectToOriginGuid.Add(NewActor, InActorData.ActorGuid);
+						AddCreatedObject(InActorData.ActorGuid, NewActor);
 						CollectDefaultSubobjects(NewActor);
 						bNeedFinishSpawn = true;
 					}
@@ -798,10 +1242,9 @@ namespace LPrefabSystem8
 
 					if (auto RootComp = NewActor->GetRootComponent())
 					{
-						if (!MapGuidToObject.Contains(InActorData.RootComponentGuid))
+						if (FindObjectByGuid(InActorData.RootComponentGuid) == nullptr)
 						{
-							MapGuidToObject.Add(InActorData.RootComponentGuid, RootComp);
-							MapObjectToOriginGuid.Add(RootComp, InActorData.RootComponentGuid);
+							AddCreatedObject(InActorData.RootComponentGuid, RootComp);
 						}
 
 						if (ParentGuid.IsValid())
@@ -6,10 +6,12 @@
 #include "Engine/World.h"
 #include "Components/PrimitiveComponent.h"
 #include "PrefabSystem/LPrefabManager.h"
+#include "PrefabSystem/LPrefabSharedReferenceTable.h"
 #include "LPrefabModule.h"
 #include "Misc/NetworkVersion.h"
 #include "Runtime/Launch/Resources/Version.h"
 #if WITH_EDITOR
+#include "PrefabSystem/LPrefabSettings.h"
 #include "Tools/UEdMode.h"
 #include "LPrefabUtils.h"
 #endif
@@ -70,8 +72,14 @@ namespace LPrefabSystem8
 			}
 		}
 		serializer.bIsEditorOrRuntime = InForEditorOrRuntimeUse;
+#if WITH_EDITOR
+		if (!InForEditorOrRuntimeUse)
+		{
+			serializer.SharedReferenceTable = ULPrefabSettings::GetSharedReferenceTableForCook();
+		}
+#endif
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabObjectWriter Writer(InOutBuffer, serializer, ExcludeProperties);
 			Writer.DoSerialize(InObject);
 		};
@@ -222,6 +230,7 @@ namespace LPrefabSystem8
 			InPrefab->ReferenceAssetListForBuild = this->ReferenceAssetList;
 			InPrefab->ReferenceClassListForBuild = this->ReferenceClassList;
 			InPrefab->ReferenceNameListForBuild = this->ReferenceNameList;
+			InPrefab->SharedReferenceTableForBuild = this->SharedReferenceTable;
 
 			InPrefab->ArchiveVersion_ForBuild = GPackageFileUEVersion.FileVersionUE4;
 			InPrefab->ArchiveVersionUE5_ForBuild = GPackageFileUEVersion.FileVersionUE5;
@@ -281,7 +290,7 @@ namespace LPrefabSystem8
 		//collect all actors include sub-prefab's actor, because some property could reference it
 		if (!MapObjectToGuid.Contains(Actor))
 		{
-			MapObjectToGuid.Add(Actor, FGuid::NewGuid());
+			MapObjectToGuid.Add(Actor, MakeObjectGuid());
 		}
 
 		TArray<AActor*> ChildrenActors;
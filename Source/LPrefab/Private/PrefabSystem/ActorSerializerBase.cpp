@@ -5,6 +5,7 @@
 #include "PrefabSystem/LPrefabObjectReaderAndWriter.h"
 #include "LPrefabModule.h"
 #include "Misc/ConfigCacheIni.h"
+#include "PrefabSystem/LPrefabSharedReferenceTable.h"
 #if WITH_EDITOR
 #include "Tools/UEdMode.h"
 #include "LPrefabUtils.h"
@@ -93,7 +94,7 @@ namespace LPrefabSystem
 				}
 				else
 				{
-					OutGuid = FGuid::NewGuid();
+					OutGuid = MakeObjectGuid();
 					MapObjectToGuid.Add(Object, OutGuid);
 				}
 				return true;
@@ -106,7 +107,7 @@ namespace LPrefabSystem
 				}
 				else
 				{
-					OutGuid = FGuid::NewGuid();
+					OutGuid = MakeObjectGuid();
 					MapObjectToGuid.Add(Object, OutGuid);
 				}
 				auto Index = WillSerializeObjectArray.Add(Object);
@@ -118,7 +119,7 @@ namespace LPrefabSystem
 					WillSerializeObjectArray.Insert(Outer, Index);//insert before object
 					if (!MapObjectToGuid.Contains(Outer))
 					{
-						MapObjectToGuid.Add(Outer, FGuid::NewGuid());
+						MapObjectToGuid.Add(Outer, MakeObjectGuid());
 					}
 					Outer = Outer->GetOuter();
 				}
@@ -128,6 +129,48 @@ namespace LPrefabSystem
 		return false;
 	}
 
+	FGuid ActorSerializerBase::MakeObjectGuid()
+	{
+		if (bUseSequentialGuid)
+		{
+			return FGuid(0, 0, 0, ++SequentialGuidCounter);
+		}
+		return FGuid::NewGuid();
+	}
+	void ActorSerializerBase::AddGuidToObject(const FGuid& InGuid, UObject* InObject)
+	{
+		if (bUseSequentialGuid && IsSequentialGuid(InGuid))
+		{
+			const int32 Index = (int32)InGuid.D - 1;
+			if (Index >= SequentialIndexToObject.Num())
+			{
+				SequentialIndexToObject.SetNumZeroed(Index + 1);
+			}
+			SequentialIndexToObject[Index] = InObject;
+		}
+		else
+		{
+			MapGuidToObject.Add(InGuid, InObject);
+		}
+	}
+	UObject* ActorSerializerBase::FindObjectByGuid(const FGuid& InGuid)const
+	{
+		if (bUseSequentialGuid && IsSequentialGuid(InGuid))
+		{
+			const int32 Index = (int32)InGuid.D - 1;
+			if (SequentialIndexToObject.IsValidIndex(Index) && SequentialIndexToObject[Index] != nullptr)
+			{
+				return SequentialIndexToObject[Index];
+			}
+			//could be added to MapGuidToObject directly, eg. RestoreActorWithPreparedData
+		}
+		if (auto ObjectPtr = MapGuidToObject.Find(InGuid))
+		{
+			return *ObjectPtr;
+		}
+		return nullptr;
+	}
+
 	TMap<UObject*, TArray<uint8>> ActorSerializerBase::SaveOverrideParameterToData(TArray<FLPrefabOverrideParameterData> InData)
 	{
 		this->bIsEditorOrRuntime = true;
@@ -163,6 +206,13 @@ namespace LPrefabSystem
 	int32 ActorSerializerBase::FindOrAddAssetIdFromList(UObject* AssetObject)
 	{
 		if (!AssetObject)return -1;
+#if WITH_EDITOR
+		if (SharedReferenceTable != nullptr)
+		{
+			auto SharedIndex = SharedReferenceTable->FindAsset(AssetObject);
+			if (SharedIndex != INDEX_NONE)return SharedIndexToId(SharedIndex);
+		}
+#endif
 		int32 resultIndex;
 		if (ReferenceAssetList.Find(AssetObject, resultIndex))
 		{
@@ -178,6 +228,13 @@ namespace LPrefabSystem
 	int32 ActorSerializerBase::FindOrAddClassFromList(UClass* Class)
 	{
 		if (!Class)return -1;
+#if WITH_EDITOR
+		if (SharedReferenceTable != nullptr)
+		{
+			auto SharedIndex = SharedReferenceTable->FindClass(Class);
+			if (SharedIndex != INDEX_NONE)return SharedIndexToId(SharedIndex);
+		}
+#endif
 		int32 resultIndex;
 		if (ReferenceClassList.Find(Class, resultIndex))
 		{
@@ -192,6 +249,13 @@ namespace LPrefabSystem
 	int32 ActorSerializerBase::FindOrAddNameFromList(const FName& Name)
 	{
 		if (!Name.IsValid())return -1;
+#if WITH_EDITOR
+		if (SharedReferenceTable != nullptr)
+		{
+			auto SharedIndex = SharedReferenceTable->FindName(Name);
+			if (SharedIndex != INDEX_NONE)return SharedIndexToId(SharedIndex);
+		}
+#endif
 		int32 resultIndex;
 		if (ReferenceNameList.Find(Name, resultIndex))
 		{
@@ -205,19 +269,116 @@ namespace LPrefabSystem
 	}
 	FName ActorSerializerBase::FindNameFromListByIndex(int32 Id)
 	{
+		if (Id < -1)
+		{
+			return SharedReferenceTable != nullptr ? SharedReferenceTable->GetNameByIndex(IdToSharedIndex(Id)) : NAME_None;
+		}
 		return ReferenceNameList.IsValidIndex(Id) ? ReferenceNameList.GetData()[Id] : NAME_None;
 	}
 
+	int32 ActorSerializerBase::FindOrAddExternalObject(UObject* InObject)
+	{
+		if (auto IndexPtr = MapExternalObjectToIndex.Find(InObject))
+		{
+			return *IndexPtr;
+		}
+		auto Index = ExternalObjectList.Add(InObject);
+		MapExternalObjectToIndex.Add(InObject, Index);
+		return Index;
+	}
+	UObject* ActorSerializerBase::FindExternalObjectByIndex(int32 Id)const
+	{
+		return ExternalObjectList.IsValidIndex(Id) ? ExternalObjectList[Id].Get() : nullptr;
+	}
+
 	UObject* ActorSerializerBase::FindAssetFromListByIndex(int32 Id)
 	{
+		if (Id < -1)
+		{
+			if (SharedAssetListOverride.Num() > 0)
+			{
+				auto SharedIndex = IdToSharedIndex(Id);
+				return SharedAssetListOverride.IsValidIndex(SharedIndex) ? SharedAssetListOverride.GetData()[SharedIndex] : nullptr;
+			}
+			return SharedReferenceTable != nullptr ? SharedReferenceTable->GetAssetByIndex(IdToSharedIndex(Id)) : nullptr;
+		}
 		return ReferenceAssetList.IsValidIndex(Id) ? ReferenceAssetList.GetData()[Id] : nullptr;
 	}
 
 	UClass* ActorSerializerBase::FindClassFromListByIndex(int32 Id)
 	{
+		if (Id < -1)
+		{
+			if (SharedClassListOverride.Num() > 0)
+			{
+				auto SharedIndex = IdToSharedIndex(Id);
+				return SharedClassListOverride.IsValidIndex(SharedIndex) ? SharedClassListOverride.GetData()[SharedIndex] : nullptr;
+			}
+			return SharedReferenceTable != nullptr ? SharedReferenceTable->GetClassByIndex(IdToSharedIndex(Id)) : nullptr;
+		}
 		return ReferenceClassList.IsValidIndex(Id) ? ReferenceClassList.GetData()[Id] : nullptr;
 	}
 
+	bool ActorSerializerBase::ApplyReferenceReplacement(const TMap<UObject*, UObject*>& InReplaceAssetMap, const TMap<UClass*, UClass*>& InReplaceClassMap)
+	{
+		bool bReplaced = false;
+		if (InReplaceAssetMap.Num() > 0)
+		{
+			for (auto& Item : ReferenceAssetList)
+			{
+				if (auto ReplaceAssetPtr = InReplaceAssetMap.Find(Item))
+				{
+					Item = *ReplaceAssetPtr;
+					bReplaced = true;
+				}
+			}
+			if (SharedReferenceTable != nullptr)
+			{
+				const auto& AssetList = SharedReferenceTable->AssetList;
+				for (int i = 0; i < AssetList.Num(); i++)
+				{
+					if (auto ReplaceAssetPtr = InReplaceAssetMap.Find(AssetList[i]))
+					{
+						if (SharedAssetListOverride.Num() == 0)
+						{
+							SharedAssetListOverride = ObjectPtrDecay(AssetList);
+						}
+						SharedAssetListOverride[i] = *ReplaceAssetPtr;
+						bReplaced = true;
+					}
+				}
+			}
+		}
+		if (InReplaceClassMap.Num() > 0)
+		{
+			for (auto& Item : ReferenceClassList)
+			{
+				if (auto ReplaceClassPtr = InReplaceClassMap.Find(Item))
+				{
+					Item = *ReplaceClassPtr;
+					bReplaced = true;
+				}
+			}
+			if (SharedReferenceTable != nullptr)
+			{
+				const auto& ClassList = SharedReferenceTable->ClassList;
+				for (int i = 0; i < ClassList.Num(); i++)
+				{
+					if (auto ReplaceClassPtr = InReplaceClassMap.Find(ClassList[i]))
+					{
+						if (SharedClassListOverride.Num() == 0)
+						{
+							SharedClassListOverride = ObjectPtrDecay(ClassList);
+						}
+						SharedClassListOverride[i] = *ReplaceClassPtr;
+						bReplaced = true;
+					}
+				}
+			}
+		}
+		return bReplaced;
+	}
+
 	const TSet<FName>& ActorSerializerBase::GetSceneComponentExcludeProperties()
 	{
 		static TSet<FName> result = {
@@ -225,6 +386,11 @@ namespace LPrefabSystem
 		};
 		return result;
 	}
+	const TSet<FName>& ActorSerializerBase::GetExcludeProperties(bool InIsSceneComponent)
+	{
+		static TSet<FName> EmptyResult;
+		return InIsSceneComponent ? GetSceneComponentExcludeProperties() : EmptyResult;
+	}
 
 	bool ActorSerializerBase::CanUseUnversionedPropertySerialization()
 	{
@@ -11,9 +11,13 @@
 #include "PrefabSystem/LPrefabManager.h"
 #include "LPrefabModule.h"
 #include "PrefabSystem/LPrefabSettings.h"
+#include "Serialization/ArchiveUObject.h"
+#include "Serialization/ObjectWriter.h"
+#include "Serialization/ObjectReader.h"
+#include "LPrefabUtils.h"
+#include "PrefabAnimation/LPrefabSequence.h"
 #if WITH_EDITOR
 #include "Tools/UEdMode.h"
-#include "LPrefabUtils.h"
 #endif
 
 #if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
@@ -39,6 +43,7 @@ namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 		serializer.bIsEditorOrRuntime = false;
 #endif
 		serializer.bOverrideVersions = false;
+		serializer.bUseSequentialGuid = true;
 
 		auto Name =
 #if WITH_EDITOR
@@ -50,17 +55,18 @@ namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 
 		//serialize
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabDuplicateObjectWriter Writer(InOutBuffer, serializer, ExcludeProperties);
 			Writer.DoSerialize(InObject);
 		};
 		FLPrefabSaveData SaveData;
 		serializer.SerializeActorToData(OriginRootActor, SaveData);
+		serializer.CollectSequenceRuntimeDataForDuplicate();
 
 		//deserialize
-		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
-			LPrefabSystem::FLPrefabDuplicateObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
+		serializer.ReaderFunction = [&serializer](UObject* InObject, const TArray<uint8>& InBuffer, bool InIsSceneComponent) {
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
+			LPrefabSystem::FLPrefabDuplicateObjectReader Reader(InBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
 		auto CreatedRootActor = serializer.DeserializeActorFromData(SaveData, Parent, false, FVector::ZeroVector, FQuat::Identity, FVector::OneVector);
@@ -76,17 +82,327 @@ namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 #endif
 		return CreatedRootActor;
 	}
-	bool ActorSerializer::PrepareDataForDuplicate(AActor* OriginRootActor, FDuplicateActorDataContainer& OutData)
+
+	/** Struct with native serializer and not plain-old-data, may contains runtime data (eg. FBodyInstance's physics handle), so should not use operator= to copy it. */
+	static bool LPrefab_IsPropertyNeedSerializeToCopy(const FProperty* InProperty)
+	{
+		if (auto StructProperty = CastField<FStructProperty>(InProperty))
+		{
+			return (StructProperty->Struct->StructFlags & STRUCT_SerializeNative) != 0
+				&& (StructProperty->Struct->StructFlags & STRUCT_IsPlainOldData) == 0;
+		}
+		if (auto ArrayProperty = CastField<FArrayProperty>(InProperty))
+		{
+			return LPrefab_IsPropertyNeedSerializeToCopy(ArrayProperty->Inner);
+		}
+		if (auto SetProperty = CastField<FSetProperty>(InProperty))
+		{
+			return LPrefab_IsPropertyNeedSerializeToCopy(SetProperty->ElementProp);
+		}
+		if (auto MapProperty = CastField<FMapProperty>(InProperty))
+		{
+			return LPrefab_IsPropertyNeedSerializeToCopy(MapProperty->KeyProp) || LPrefab_IsPropertyNeedSerializeToCopy(MapProperty->ValueProp);
+		}
+		return false;
+	}
+	/** Archive to copy one property value, FObjectWriter/FObjectReader's constructor with bytes is protected. Members inside struct are filtered by LPrefabSystem::LPrefab_ShouldSkipPropertyForDuplicate, same as top level property. */
+	class FLPrefabCloneValueWriter : public FObjectWriter
+	{
+	public:
+		FLPrefabCloneValueWriter(TArray<uint8>& InBytes) :FObjectWriter(InBytes)
+		{
+			SetIsPersistent(true);
+		}
+		virtual bool ShouldSkipProperty(const FProperty* InProperty) const override
+		{
+			return LPrefabSystem::LPrefab_ShouldSkipPropertyForDuplicate(InProperty);
+		}
+	};
+	class FLPrefabCloneValueReader : public FObjectReader
+	{
+	public:
+		FLPrefabCloneValueReader(TArray<uint8>& InBytes) :FObjectReader(InBytes)
+		{
+			SetIsPersistent(true);
+		}
+		virtual bool ShouldSkipProperty(const FProperty* InProperty) const override
+		{
+			return LPrefabSystem::LPrefab_ShouldSkipPropertyForDuplicate(InProperty);
+		}
+	};
+	/** Replace object references inside one property value, only visit the value instead of whole object like FArchiveReplaceObjectRef. */
+	class FLPrefabCloneRemapArchive : public FArchiveUObject
+	{
+	public:
+		FLPrefabCloneRemapArchive(const TMap<UObject*, UObject*>& InReplaceMap) :ReplaceMap(InReplaceMap)
+		{
+			ArIsObjectReferenceCollector = true;
+			ArIsModifyingWeakAndStrongReferences = true;
+			ArIgnoreOuterRef = true;
+			ArIgnoreArchetypeRef = true;
+			ArIgnoreClassRef = true;
+		}
+		virtual FArchive& operator<<(UObject*& Obj) override
+		{
+			if (Obj != nullptr)
+			{
+				if (auto FoundPtr = ReplaceMap.Find(Obj))
+				{
+					Obj = *FoundPtr;
+				}
+			}
+			return *this;
+		}
+		virtual FString GetArchiveName() const override { return TEXT("FLPrefabCloneRemapArchive"); }
+	private:
+		const TMap<UObject*, UObject*>& ReplaceMap;
+	};
+	/** Data used by all objects in one direct clone. */
+	struct FLPrefabDirectCloneContext
+	{
+		TArray<uint8> ValueBuffer;
+		/** Reference to object in origin hierarchy should point to created object. */
+		const TMap<UObject*, UObject*>* MapOriginToCreated = nullptr;
+		/** Property (of class or struct) to its copy method, checked once for each property. */
+		enum class ECopyMethod : uint8
+		{
+			Assign,
+			AssignAndRemap,
+			Serialize,
+		};
+		TMap<const FProperty*, ECopyMethod> MapPropertyToCopyMethod;
+		/** Struct to whether any member (include nested struct) need to be filtered. */
+		TMap<const UStruct*, bool> MapStructToHasSkippedMember;
+
+		bool StructHasSkippedMember(const UStruct* InStruct)
+		{
+			if (auto FoundPtr = MapStructToHasSkippedMember.Find(InStruct))
+			{
+				return *FoundPtr;
+			}
+			MapStructToHasSkippedMember.Add(InStruct, false);//incase recursive struct
+			bool bResult = false;
+			for (TFieldIterator<FProperty> PropertyItr(InStruct, EFieldIteratorFlags::IncludeSuper); PropertyItr; ++PropertyItr)
+			{
+				if (LPrefabSystem::LPrefab_ShouldSkipPropertyForDuplicate(*PropertyItr) || PropertyHasSkippedMember(*PropertyItr))
+				{
+					bResult = true;
+					break;
+				}
+			}
+			MapStructToHasSkippedMember.Add(InStruct, bResult);
+			return bResult;
+		}
+		bool PropertyHasSkippedMember(const FProperty* InProperty)
+		{
+			if (auto StructProperty = CastField<FStructProperty>(InProperty))
+			{
+				return StructHasSkippedMember(StructProperty->Struct);
+			}
+			if (auto ArrayProperty = CastField<FArrayProperty>(InProperty))
+			{
+				return PropertyHasSkippedMember(ArrayProperty->Inner);
+			}
+			if (auto SetProperty = CastField<FSetProperty>(InProperty))
+			{
+				return PropertyHasSkippedMember(SetProperty->ElementProp);
+			}
+			if (auto MapProperty = CastField<FMapProperty>(InProperty))
+			{
+				return PropertyHasSkippedMember(MapProperty->KeyProp) || PropertyHasSkippedMember(MapProperty->ValueProp);
+			}
+			return false;
+		}
+		ECopyMethod GetCopyMethod(const FProperty* InProperty)
+		{
+			if (auto FoundPtr = MapPropertyToCopyMethod.Find(InProperty))
+			{
+				return *FoundPtr;
+			}
+			ECopyMethod Result = ECopyMethod::Assign;
+			if (LPrefab_IsPropertyNeedSerializeToCopy(InProperty) || PropertyHasSkippedMember(InProperty))
+			{
+				Result = ECopyMethod::Serialize;
+			}
+			else
+			{
+				TArray<const FStructProperty*> EncounteredStructProps;
+				if (InProperty->ContainsObjectReference(EncounteredStructProps, EPropertyObjectReferenceType::Strong)
+					|| InProperty->ContainsObjectReference(EncounteredStructProps, EPropertyObjectReferenceType::Weak))
+				{
+					Result = ECopyMethod::AssignAndRemap;
+				}
+			}
+			MapPropertyToCopyMethod.Add(InProperty, Result);
+			return Result;
+		}
+		void RemapValue(const FProperty* InProperty, void* InValuePtr)
+		{
+			FLPrefabCloneRemapArchive Remap(*MapOriginToCreated);
+			InProperty->SerializeItem(FStructuredArchiveFromArchive(Remap).GetSlot(), InValuePtr);
+		}
+	};
+	/** Copy properties and replace references in one pass, skip rule is LPrefabSystem::LPrefab_ShouldSkipPropertyForDuplicate, same as FLPrefabDuplicateObjectWriter. */
+	static void LPrefab_CopyPropertiesForDirectClone(UObject* InSource, UObject* InTarget, const TSet<FName>& InExcludeProperties, FLPrefabDirectCloneContext& InContext)
+	{
+		for (TFieldIterator<FProperty> PropertyItr(InSource->GetClass(), EFieldIteratorFlags::IncludeSuper); PropertyItr; ++PropertyItr)
+		{
+			auto Property = *PropertyItr;
+			if (LPrefabSystem::LPrefab_ShouldSkipPropertyForDuplicate(Property)
+				|| InExcludeProperties.Contains(Property->GetFName())
+				)
+			{
+				continue;
+			}
+			auto CopyMethod = InContext.GetCopyMethod(Property);
+			for (int32 i = 0; i < Property->ArrayDim; i++)
+			{
+				auto TargetValuePtr = Property->ContainerPtrToValuePtr<void>(InTarget, i);
+				if (CopyMethod == FLPrefabDirectCloneContext::ECopyMethod::Serialize)
+				{
+					//serialize skip filtered members inside struct, so target keep its own value for them
+					InContext.ValueBuffer.Reset();
+					{
+						FLPrefabCloneValueWriter Writer(InContext.ValueBuffer);
+						Property->SerializeItem(FStructuredArchiveFromArchive(Writer).GetSlot(), Property->ContainerPtrToValuePtr<void>(InSource, i));
+					}
+					{
+						FLPrefabCloneValueReader Reader(InContext.ValueBuffer);
+						Property->SerializeItem(FStructuredArchiveFromArchive(Reader).GetSlot(), TargetValuePtr);
+					}
+					InContext.RemapValue(Property, TargetValuePtr);
+				}
+				else
+				{
+					Property->CopySingleValue(TargetValuePtr, Property->ContainerPtrToValuePtr<void>(InSource, i));
+					if (CopyMethod == FLPrefabDirectCloneContext::ECopyMethod::AssignAndRemap)
+					{
+						InContext.RemapValue(Property, TargetValuePtr);
+					}
+				}
+			}
+		}
+	}
+	AActor* ActorSerializer::DuplicateActorDirect(AActor* OriginRootActor, USceneComponent* Parent)
 	{
 		if (!OriginRootActor)
 		{
 			UE_LOG(LPrefab, Error, TEXT("[%s].%d OriginRootActor is null!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
-			return false;
+			return nullptr;
 		}
 		if (!OriginRootActor->GetWorld())
 		{
 			UE_LOG(LPrefab, Error, TEXT("[%s].%d Cannot get World from OriginRootActor!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
-			return false;
+			return nullptr;
+		}
+		ActorSerializer serializer;
+		serializer.TargetWorld = OriginRootActor->GetWorld();
+#if !WITH_EDITOR
+		serializer.bIsEditorOrRuntime = false;
+#endif
+		serializer.bOverrideVersions = false;
+		serializer.bUseSequentialGuid = true;
+
+		auto Name =
+#if WITH_EDITOR
+			OriginRootActor->GetActorLabel();
+#else
+			OriginRootActor->GetPathName();
+#endif
+		auto StartTime = FDateTime::Now();
+
+		//collect objects in hierarchy, no data is written
+		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
+			LPrefabSystem::FLPrefabDuplicateReferenceCollector Collector(serializer, ExcludeProperties);
+			Collector.DoSerialize(InObject);
+		};
+		FLPrefabSaveData SaveData;
+		serializer.SerializeActorToData(OriginRootActor, SaveData);
+		serializer.CollectSequenceRuntimeDataForDuplicate();
+		//guid is sequential, so origin object can be found by index, same as created object in SequentialIndexToObject
+		TArray<UObject*> OriginSequentialIndexToObject;
+		OriginSequentialIndexToObject.SetNumZeroed(serializer.MapObjectToGuid.Num());
+		for (auto& KeyValue : serializer.MapObjectToGuid)
+		{
+			const int32 Index = (int32)KeyValue.Value.D - 1;
+			if (OriginSequentialIndexToObject.IsValidIndex(Index))
+			{
+				OriginSequentialIndexToObject[Index] = KeyValue.Key;
+			}
+		}
+
+		//create objects and copy properties
+		TMap<UObject*, UObject*> MapOriginToCreated;
+		TMap<UObject*, UObject*> MapCreatedToOrigin;
+		FLPrefabDirectCloneContext CloneContext;
+		CloneContext.MapOriginToCreated = &MapOriginToCreated;
+		serializer.ReaderFunction = [&](UObject* InObject, const TArray<uint8>& InBuffer, bool InIsSceneComponent) {
+			if (MapCreatedToOrigin.Num() == 0)//all objects are created before read properties, so build the map when first call
+			{
+				const auto& CreatedObjects = serializer.SequentialIndexToObject;
+				MapOriginToCreated.Reserve(CreatedObjects.Num());
+				MapCreatedToOrigin.Reserve(CreatedObjects.Num());
+				for (int32 Index = 0; Index < CreatedObjects.Num() && Index < OriginSequentialIndexToObject.Num(); Index++)
+				{
+					auto CreatedObject = CreatedObjects[Index];
+					auto OriginObject = OriginSequentialIndexToObject[Index];
+					if (CreatedObject != nullptr && OriginObject != nullptr)
+					{
+						MapOriginToCreated.Add(OriginObject, CreatedObject);
+						MapCreatedToOrigin.Add(CreatedObject, OriginObject);
+					}
+				}
+			}
+			auto OriginObjectPtr = MapCreatedToOrigin.Find(InObject);
+			if (OriginObjectPtr == nullptr)return;
+			LPrefab_CopyPropertiesForDirectClone(*OriginObjectPtr, InObject, serializer.GetExcludeProperties(InIsSceneComponent), CloneContext);
+		};
+		auto CreatedRootActor = serializer.DeserializeActorFromData(SaveData, Parent, false, FVector::ZeroVector, FQuat::Identity, FVector::OneVector);
+
+		if (ULPrefabSettings::GetLogPrefabLoadTime())
+		{
+			auto TimeSpan = FDateTime::Now() - StartTime;
+			UE_LOG(LPrefab, Log, TEXT("Duplicate actor direct: '%s', total time: %fms"), *Name, TimeSpan.GetTotalMilliseconds());
+		}
+
+#if WITH_EDITOR
+		ULPrefabManagerObject::MarkBroadcastLevelActorListChanged();//UE5 will not auto refresh scene outliner and display actor label, so manually refresh it.
+#endif
+		return CreatedRootActor;
+	}
+	void ActorSerializer::CollectSequenceRuntimeDataForDuplicate()
+	{
+		SequenceRuntimeDataForDuplicate.Reset();
+		for (auto& KeyValue : MapObjectToGuid)
+		{
+			if (auto Sequence = Cast<ULPrefabSequence>(KeyValue.Key))
+			{
+				if (Sequence->IsMovieSceneShared() || Sequence->GetBakedData().IsValid())
+				{
+					FLPrefabSequenceRuntimeData RuntimeData;
+					RuntimeData.SharedMovieScene = Sequence->IsMovieSceneShared() ? Sequence->GetMovieScene() : nullptr;
+					RuntimeData.BakedData = Sequence->GetBakedData();
+					SequenceRuntimeDataForDuplicate.Add(KeyValue.Value, RuntimeData);
+				}
+			}
+		}
+	}
+	TSharedPtr<const FDuplicateActorTemplate, ESPMode::ThreadSafe> ActorSerializer::PrepareDuplicateTemplate(AActor* RootActor)
+	{
+		return CreateDuplicateTemplate(RootActor, nullptr);
+	}
+	TSharedPtr<const FDuplicateActorTemplate, ESPMode::ThreadSafe> ActorSerializer::CreateDuplicateTemplate(AActor* OriginRootActor, TMap<FGuid, TWeakObjectPtr<UObject>>* OutMapGuidToObject)
+	{
+		if (!OriginRootActor)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d OriginRootActor is null!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return nullptr;
+		}
+		if (!OriginRootActor->GetWorld())
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Cannot get World from OriginRootActor!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return nullptr;
 		}
 
 		auto Name =
@@ -97,55 +413,88 @@ namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 #endif
 		auto StartTime = FDateTime::Now();
 
-		auto& serializer = OutData.Serializer;
+		ActorSerializer serializer;
 		serializer.TargetWorld = OriginRootActor->GetWorld();
 #if !WITH_EDITOR
 		serializer.bIsEditorOrRuntime = false;
 #endif
 		serializer.bOverrideVersions = false;
+		serializer.bUseSequentialGuid = true;
+		serializer.bStoreExternalObjectByIndex = true;
 
 		//serialize
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabDuplicateObjectWriter Writer(InOutBuffer, serializer, ExcludeProperties);
 			Writer.DoSerialize(InObject);
 		};
-		serializer.SerializeActorToData(OriginRootActor, OutData.ActorData);
-
-		//for deserialize, set once for all use
-		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
-			LPrefabSystem::FLPrefabDuplicateObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
-			Reader.DoSerialize(InObject);
-		};
+		auto Template = MakeShared<FDuplicateActorTemplate, ESPMode::ThreadSafe>();
+		serializer.SerializeActorToData(OriginRootActor, Template->ActorData);
+		serializer.CollectSequenceRuntimeDataForDuplicate();
+		Template->SourceWorld = serializer.TargetWorld;
+		Template->SequenceRuntimeDatas = serializer.SequenceRuntimeDataForDuplicate;
+		Template->ReferenceAssetList = TArray<TObjectPtr<UObject>>(serializer.ReferenceAssetList);
+		Template->ReferenceClassList = TArray<TObjectPtr<UClass>>(serializer.ReferenceClassList);
+		Template->ReferenceNameList = serializer.ReferenceNameList;
+		Template->ExternalObjectList = serializer.ExternalObjectList;
+		if (OutMapGuidToObject != nullptr)
+		{
+			OutMapGuidToObject->Reset();
+			for (auto& KeyValue : serializer.MapObjectToGuid)
+			{
+				OutMapGuidToObject->Add(KeyValue.Value, KeyValue.Key);
+			}
+		}
 
 		if (ULPrefabSettings::GetLogPrefabLoadTime())
 		{
 			auto TimeSpan = FDateTime::Now() - StartTime;
 			UE_LOG(LPrefab, Log, TEXT("PrepareData_ForDuplicate, actor: '%s' total time: %fms"), *Name, TimeSpan.GetTotalMilliseconds());
 		}
+		return Template;
+	}
+	bool ActorSerializer::SetupForDuplicateTemplate(const FDuplicateActorTemplate& InTemplate, USceneComponent* InParent)
+	{
+		auto SourceWorld = InTemplate.SourceWorld.Get();
+		if (SourceWorld == nullptr)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d World that template is prepared from is not valid anymore!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return false;
+		}
+		TargetWorld = InParent != nullptr ? InParent->GetWorld() : SourceWorld;
+		if (TargetWorld != SourceWorld)//objects outside of the hierarchy belong to source world
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Template can only duplicate in the world it is prepared from!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return false;
+		}
+#if !WITH_EDITOR
+		bIsEditorOrRuntime = false;
+#endif
+		bOverrideVersions = false;
+		bUseSequentialGuid = true;
+		ReferenceAssetList = ObjectPtrDecay(InTemplate.ReferenceAssetList);
+		ReferenceClassList = ObjectPtrDecay(InTemplate.ReferenceClassList);
+		ReferenceNameList = InTemplate.ReferenceNameList;
+		ExternalObjectList = InTemplate.ExternalObjectList;
+		SequenceRuntimeDataForDuplicate = InTemplate.SequenceRuntimeDatas;
+		ReaderFunction = [this](UObject* InObject, const TArray<uint8>& InBuffer, bool InIsSceneComponent) {
+			const auto& ExcludeProperties = GetExcludeProperties(InIsSceneComponent);
+			LPrefabSystem::FLPrefabDuplicateObjectReader Reader(InBuffer, *this, ExcludeProperties);
+			Reader.DoSerialize(InObject);
+		};
 		return true;
 	}
-	AActor* ActorSerializer::DuplicateActorWithPreparedData(FDuplicateActorDataContainer& InData, USceneComponent* InParent)
+	AActor* ActorSerializer::DuplicateActorWithTemplate(const TSharedRef<const FDuplicateActorTemplate, ESPMode::ThreadSafe>& InTemplate, USceneComponent* InParent)
 	{
 		auto StartTime = FDateTime::Now();
-		auto& serializer = InData.Serializer;//use copied, incase undesired data
-		//clear these data for deserializer use
-		serializer.WillSerializeActorArray.Reset();
-		serializer.WillSerializeObjectArray.Reset();
-		serializer.MapGuidToObject.Reset();
-		serializer.MapObjectToGuid.Reset();
-		serializer.ComponentsInThisPrefab.Reset();
-		serializer.SubPrefabMap.Reset();
-		serializer.SubPrefabRootComponents.Reset();
-		serializer.AllActors.Reset();
-		serializer.AllComponents.Reset();
-		serializer.SubPrefabOverrideParameters.Reset();
-		serializer.DeserializationSessionId = FGuid();
-		serializer.bIsSubPrefab = false;
-		serializer.SubPrefabObjectOverrideData.Reset();
-
-		auto CreatedRootActor = serializer.DeserializeActorFromData(InData.ActorData, InParent, false, FVector::ZeroVector, FQuat::Identity, FVector::OneVector);
+		//all mutable state is in this serializer, so it is safe to duplicate again inside Awake of created actor
+		ActorSerializer serializer;
+		if (!serializer.SetupForDuplicateTemplate(*InTemplate, InParent))
+		{
+			return nullptr;
+		}
+		//deserialize only read the data, template is never changed
+		auto CreatedRootActor = serializer.DeserializeActorFromData(InTemplate->ActorData, InParent, false, FVector::ZeroVector, FQuat::Identity, FVector::OneVector);
 		if (ULPrefabSettings::GetLogPrefabLoadTime())
 		{
 			auto TimeSpan = FDateTime::Now() - StartTime;
@@ -156,6 +505,249 @@ namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 #endif
 		return CreatedRootActor;
 	}
+	bool ActorSerializer::PrepareDataForDuplicate(AActor* OriginRootActor, FDuplicateActorDataContainer& OutData)
+	{
+		OutData.Template = CreateDuplicateTemplate(OriginRootActor, nullptr);
+		return OutData.Template.IsValid();
+	}
+	AActor* ActorSerializer::DuplicateActorWithPreparedData(FDuplicateActorDataContainer& InData, USceneComponent* InParent)
+	{
+		if (!InData.Template.IsValid())
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Data is not prepared!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return nullptr;
+		}
+		return DuplicateActorWithTemplate(InData.Template.ToSharedRef(), InParent);
+	}
+	bool ActorSerializer::DuplicateActorWithPreparedDataBatch(FDuplicateActorDataContainer& InData, USceneComponent* InParent, int32 InCount, const TArray<FTransform>& InTransforms, TArray<AActor*>& OutActors)
+	{
+		if (!InData.Template.IsValid())
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Data is not prepared!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return false;
+		}
+		const bool bUseTransforms = InTransforms.Num() > 0;
+		const int32 Count = bUseTransforms ? InTransforms.Num() : InCount;
+		if (Count <= 0)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Count must be greater than 0!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+			return false;
+		}
+		auto StartTime = FDateTime::Now();
+		//hold template, incase InData is changed in Awake of created actor
+		auto Template = InData.Template.ToSharedRef();
+		const auto& ActorData = Template->ActorData;
+		//one serializer for this batch, containers are reused between copies
+		ActorSerializer serializer;
+		if (!serializer.SetupForDuplicateTemplate(*Template, InParent))
+		{
+			return false;
+		}
+		TArray<AActor*> CreatedRootActors;
+		CreatedRootActors.Reserve(Count);
+		TArray<TArray<AActor*>> InstanceActors;
+		InstanceActors.Reserve(Count);
+		serializer.BatchInstanceActors = &InstanceActors;
+		int32 FailedIndex = INDEX_NONE;
+		for (int i = 0; i < Count; i++)
+		{
+			//all copies in one session, session is created by first copy
+			auto SessionId = serializer.DeserializationSessionId;
+			serializer.ResetForDeserializePreparedData();
+			serializer.DeserializationSessionId = SessionId;
+			AActor* CreatedRootActor = nullptr;
+			if (bUseTransforms)
+			{
+				const auto& Transform = InTransforms[i];
+				CreatedRootActor = serializer.DeserializeActorFromData(ActorData, InParent, true, Transform.GetLocation(), Transform.GetRotation(), Transform.GetScale3D());
+			}
+			else
+			{
+				CreatedRootActor = serializer.DeserializeActorFromData(ActorData, InParent, false, FVector::ZeroVector, FQuat::Identity, FVector::OneVector);
+			}
+			if (CreatedRootActor == nullptr)
+			{
+				FailedIndex = i;
+				break;
+			}
+			CreatedRootActors.Add(CreatedRootActor);
+		}
+		serializer.BatchInstanceActors = nullptr;
+		if (FailedIndex != INDEX_NONE)
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Duplicate fail at index: %d, destroy all %d created copies."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, FailedIndex, CreatedRootActors.Num());
+			if (serializer.DeserializationSessionId.IsValid())
+			{
+				for (auto& Actors : InstanceActors)
+				{
+					for (auto& Actor : Actors)
+					{
+						serializer.LPrefabManager->RemoveActorForPrefabSystem(Actor, serializer.DeserializationSessionId);
+					}
+				}
+				serializer.LPrefabManager->EndPrefabSystemProcessingActor(serializer.DeserializationSessionId);
+			}
+			for (auto& Actor : CreatedRootActors)
+			{
+				LPrefabUtils::DestroyActorWithHierarchy(Actor, true);
+			}
+			return false;
+		}
+		serializer.FinishDeserialize(InstanceActors);
+		OutActors.Append(CreatedRootActors);
+		if (ULPrefabSettings::GetLogPrefabLoadTime())
+		{
+			auto TimeSpan = FDateTime::Now() - StartTime;
+			UE_LOG(LPrefab, Log, TEXT("DuplicateActorWithPreparedDataBatch count: %d, total time: %fms"), Count, TimeSpan.GetTotalMilliseconds());
+		}
+#if WITH_EDITOR
+		ULPrefabManagerObject::MarkBroadcastLevelActorListChanged();//only refresh once for all copies
+#endif
+		return true;
+	}
+	void ActorSerializer::ResetForDeserializePreparedData()
+	{
+		//clear these data for deserializer use
+		WillSerializeActorArray.Reset();
+		WillSerializeObjectArray.Reset();
+		MapGuidToObject.Reset();
+		MapObjectToGuid.Reset();
+		ComponentsInThisPrefab.Reset();
+		SubPrefabMap.Reset();
+		SubPrefabRootComponents.Reset();
+		AllActors.Reset();
+		AllComponents.Reset();
+		SubPrefabOverrideParameters.Reset();
+		DeserializationSessionId = FGuid();
+		bIsSubPrefab = false;
+		SubPrefabObjectOverrideData.Reset();
+		SequentialIndexToObject.Reset();
+	}
+
+	bool ActorSerializer::PrepareDataForRestore(AActor* RootActor, FDuplicateActorDataContainer& OutData)
+	{
+		OutData.Template = CreateDuplicateTemplate(RootActor, &OutData.MapGuidToObjectForRestore);
+		return OutData.Template.IsValid();
+	}
+	bool ActorSerializer::PrepareDataForRestore(AActor* RootActor, const TSharedRef<const FDuplicateActorTemplate, ESPMode::ThreadSafe>& InTemplate, FDuplicateActorDataContainer& OutData)
+	{
+		if (!IsValid(RootActor) || RootActor->GetWorld() == nullptr)
+		{
+			return false;
+		}
+		if (RootActor->GetWorld() != InTemplate->SourceWorld.Get())//objects outside of the hierarchy that referenced by template belong to source world
+		{
+			return false;
+		}
+		ActorSerializer serializer;
+		serializer.TargetWorld = RootActor->GetWorld();
+#if !WITH_EDITOR
+		serializer.bIsEditorOrRuntime = false;
+#endif
+		serializer.bOverrideVersions = false;
+		serializer.bUseSequentialGuid = true;
+		//collect objects in hierarchy, no data is written. sequential guid is decided by collect order, so it is same as template if hierarchy is same
+		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
+			LPrefabSystem::FLPrefabDuplicateReferenceCollector Collector(serializer, ExcludeProperties);
+			Collector.DoSerialize(InObject);
+		};
+		FLPrefabSaveData SaveData;
+		serializer.SerializeActorToData(RootActor, SaveData);
+
+		//check hierarchy, every object must have same guid, class and name as template
+		const auto& TemplateData = InTemplate->ActorData;
+		auto IsSameClass = [&serializer, &InTemplate](int32 InClassIndex, int32 InTemplateClassIndex) {
+			return serializer.ReferenceClassList.IsValidIndex(InClassIndex) && InTemplate->ReferenceClassList.IsValidIndex(InTemplateClassIndex)
+				&& serializer.ReferenceClassList[InClassIndex] == InTemplate->ReferenceClassList[InTemplateClassIndex];
+		};
+		if (SaveData.SavedActors.Num() != TemplateData.SavedActors.Num()
+			|| SaveData.SavedObjects.Num() != TemplateData.SavedObjects.Num()
+			|| SaveData.SavedObjectData.Num() != TemplateData.SavedObjectData.Num()
+			|| !SaveData.MapSceneComponentToParent.OrderIndependentCompareEqual(TemplateData.MapSceneComponentToParent)
+			)
+		{
+			return false;
+		}
+		for (int i = 0; i < SaveData.SavedActors.Num(); i++)
+		{
+			const auto& ActorData = SaveData.SavedActors[i];
+			const auto& TemplateActorData = TemplateData.SavedActors[i];
+			if (ActorData.ActorGuid != TemplateActorData.ActorGuid
+				|| ActorData.RootComponentGuid != TemplateActorData.RootComponentGuid
+				|| !IsSameClass(ActorData.ObjectClass, TemplateActorData.ObjectClass)
+				|| ActorData.DefaultSubObjectGuidArray != TemplateActorData.DefaultSubObjectGuidArray
+				|| ActorData.DefaultSubObjectNameArray != TemplateActorData.DefaultSubObjectNameArray
+				)
+			{
+				return false;
+			}
+		}
+		for (auto& KeyValue : SaveData.SavedObjects)
+		{
+			auto TemplateObjectDataPtr = TemplateData.SavedObjects.Find(KeyValue.Key);
+			if (TemplateObjectDataPtr == nullptr
+				|| KeyValue.Value.ObjectName != TemplateObjectDataPtr->ObjectName
+				|| KeyValue.Value.OuterObjectGuid != TemplateObjectDataPtr->OuterObjectGuid
+				|| !IsSameClass(KeyValue.Value.ObjectClass, TemplateObjectDataPtr->ObjectClass)
+				|| KeyValue.Value.DefaultSubObjectGuidArray != TemplateObjectDataPtr->DefaultSubObjectGuidArray
+				)
+			{
+				return false;
+			}
+		}
+
+		OutData.Template = InTemplate;
+		OutData.MapGuidToObjectForRestore.Reset();
+		OutData.MapGuidToObjectForRestore.Reserve(serializer.MapObjectToGuid.Num());
+		for (auto& KeyValue : serializer.MapObjectToGuid)
+		{
+			OutData.MapGuidToObjectForRestore.Add(KeyValue.Value, KeyValue.Key);
+		}
+		return true;
+	}
+	bool ActorSerializer::RestoreActorWithPreparedData(FDuplicateActorDataContainer& InData)
+	{
+		if (!InData.Template.IsValid())
+		{
+			return false;
+		}
+		auto Template = InData.Template.ToSharedRef();
+		ActorSerializer serializer;
+		if (!serializer.SetupForDuplicateTemplate(*Template, nullptr))
+		{
+			return false;
+		}
+		//objects are not created again, just use the objects when prepare data
+		for (auto& KeyValue : InData.MapGuidToObjectForRestore)
+		{
+			auto Object = KeyValue.Value.Get();
+			if (!IsValid(Object))
+			{
+				return false;
+			}
+			serializer.MapGuidToObject.Add(KeyValue.Key, Object);
+		}
+
+		TArray<UActorComponent*> Components;
+		for (auto& KeyValue : Template->ActorData.SavedObjectData)
+		{
+			if (auto ObjectPtr = serializer.MapGuidToObject.Find(KeyValue.Key))
+			{
+				serializer.ReaderFunction(*ObjectPtr, KeyValue.Value, Cast<USceneComponent>(*ObjectPtr) != nullptr);
+				if (auto Comp = Cast<UActorComponent>(*ObjectPtr))
+				{
+					Components.Add(Comp);
+				}
+			}
+		}
+		//mark component reregister to use new property value
+		for (auto& Comp : Components)
+		{
+			PostSetPropertiesOnActor(Comp);
+		}
+		return true;
+	}
 
 	AActor* ActorSerializer::DuplicateActorForEditor(AActor* OriginRootActor, USceneComponent* Parent
 		, const TMap<TObjectPtr<AActor>, FLSubPrefabData>& InSubPrefabMap
@@ -194,7 +786,7 @@ namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 		//serialize
 		serializer.SubPrefabMap = InSubPrefabMap;
 		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
 			LPrefabSystem::FLPrefabDuplicateObjectWriter Writer(InOutBuffer, serializer, ExcludeProperties);
 			Writer.DoSerialize(InObject);
 		};
@@ -204,12 +796,13 @@ namespace LPREFAB_SERIALIZER_NEWEST_NAMESPACE
 		};
 		FLPrefabSaveData SaveData;
 		serializer.SerializeActorToData(OriginRootActor, SaveData);
+		serializer.CollectSequenceRuntimeDataForDuplicate();
 
 		//deserialize
 		serializer.SubPrefabMap = {};//clear it for deserializer to fill
-		serializer.WriterOrReaderFunction = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, bool InIsSceneComponent) {
-			auto ExcludeProperties = InIsSceneComponent ? serializer.GetSceneComponentExcludeProperties() : TSet<FName>();
-			LPrefabSystem::FLPrefabDuplicateObjectReader Reader(InOutBuffer, serializer, ExcludeProperties);
+		serializer.ReaderFunction = [&serializer](UObject* InObject, const TArray<uint8>& InBuffer, bool InIsSceneComponent) {
+			const auto& ExcludeProperties = serializer.GetExcludeProperties(InIsSceneComponent);
+			LPrefabSystem::FLPrefabDuplicateObjectReader Reader(InBuffer, serializer, ExcludeProperties);
 			Reader.DoSerialize(InObject);
 		};
 		serializer.WriterOrReaderFunctionForSubPrefabOverride = [&serializer](UObject* InObject, TArray<uint8>& InOutBuffer, const TArray<FName>& InOverridePropertyNameSet) {
@@ -9,11 +9,16 @@
 #include "PrefabSystem/ActorSerializer5.h"
 #include "PrefabSystem/ActorSerializer6.h"
 #include "PrefabSystem/ActorSerializer7.h"
+#include "Interfaces/ITargetPlatform.h"
 #endif
 #include LPREFAB_SERIALIZER_NEWEST_INCLUDE
 #include "LPrefabUtils.h"
 #include "PrefabSystem/LPrefabManager.h"
 #include "PrefabSystem/LPrefabHelperObject.h"
+#include "PrefabSystem/LPrefabSharedReferenceTable.h"
+#include "PrefabSystem/LPrefabBundle.h"
+#include "PrefabSystem/LPrefabSettings.h"
+#include "PrefabAnimation/LPrefabSequence.h"
 #include "Engine/Engine.h"
 
 #define LOCTEXT_NAMESPACE "LPrefab"
@@ -227,6 +232,10 @@ ULPrefabHelperObject* ULPrefab::GetPrefabHelperObject()
 void ULPrefab::BeginCacheForCookedPlatformData(const ITargetPlatform* TargetPlatform)
 {
 	BinaryDataForBuild.Empty();
+	BundleOffsetForBuild = -1;
+	BundleSizeForBuild = 0;
+	BundleCrcForBuild = 0;
+	CookedBundleEntries.Remove(TargetPlatform->PlatformName());
 	if (!IsValid(PrefabHelperObject) || !IsValid(PrefabHelperObject->LoadedRootActor))
 	{
 		UE_LOG(LPrefab, Log, TEXT("[%s].%d AgentObjects not valid, recreate it! prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(this->GetPathName()));
@@ -262,12 +271,52 @@ void ULPrefab::BeginCacheForCookedPlatformData(const ITargetPlatform* TargetPlat
 			, MapObjectToGuid, PrefabHelperObject->SubPrefabMap
 			, false
 		);
+		BakedSequencesForBuild.Empty();
+		if (ULPrefabSettings::GetBakeSimpleSequenceWhenCook())
+		{
+			//sequence in sub prefab is baked in sub prefab asset, because it is loaded with guid in sub prefab
+			TSet<UObject*> SubPrefabObjects;
+			for (auto& SubPrefabKeyValue : PrefabHelperObject->SubPrefabMap)
+			{
+				for (auto& KeyValue : SubPrefabKeyValue.Value.MapGuidToObject)
+				{
+					SubPrefabObjects.Add(KeyValue.Value);
+				}
+			}
+			for (auto& KeyValue : MapObjectToGuid)
+			{
+				auto Sequence = Cast<ULPrefabSequence>(KeyValue.Key);
+				if (Sequence == nullptr || SubPrefabObjects.Contains(Sequence))continue;
+				FLPrefabBakedSequence BakedData;
+				if (FLPrefabBakedSequence::Bake(Sequence->GetMovieScene(), BakedData))
+				{
+					UE_LOG(LPrefab, Log, TEXT("[%s].%d Baked sequence '%s' of prefab '%s', tracks: %d, samples: %d."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__
+						, *Sequence->GetDisplayNameString(), *this->GetPathName(), BakedData.Tracks.Num(), BakedData.SampleCount);
+					BakedSequencesForBuild.Add(KeyValue.Value, MoveTemp(BakedData));
+				}
+			}
+		}
 		PrefabHelperObject->MapGuidToObject.Empty();
 		for (auto KeyValue : MapObjectToGuid)
 		{
 			PrefabHelperObject->MapGuidToObject.Add(KeyValue.Value, KeyValue.Key);
 		}
 	}
+
+	if (GetDefault<ULPrefabSettings>()->bWritePrefabBundleWhenCook && BinaryDataForBuild.Num() > 0)
+	{
+		uint32 Crc = 0;
+		auto Offset = FLPrefabBundle::AppendForCook(TargetPlatform, BinaryDataForBuild, Crc);
+		if (Offset >= 0)
+		{
+			//BinaryDataForBuild is kept for other platforms, it is moved to BundleFallbackDataForBuild when serialize for this platform
+			FCookedBundleEntry Entry;
+			Entry.Offset = Offset;
+			Entry.Size = BinaryDataForBuild.Num();
+			Entry.Crc = Crc;
+			CookedBundleEntries.Add(TargetPlatform->PlatformName(), Entry);
+		}
+	}
 }
 void ULPrefab::WillNeverCacheCookedPlatformDataAgain()
 {
@@ -277,6 +326,12 @@ void ULPrefab::WillNeverCacheCookedPlatformDataAgain()
 		ReferenceAssetListForBuild.Empty();
 		ReferenceClassListForBuild.Empty();
 		ReferenceNameListForBuild.Empty();
+		SharedReferenceTableForBuild = nullptr;
+		BundleOffsetForBuild = -1;
+		BundleSizeForBuild = 0;
+		BundleCrcForBuild = 0;
+		CookedBundleEntries.Empty();
+		BundleFallbackDataForBuild.RemoveBulkData();
 	}
 }
 void ULPrefab::ClearCachedCookedPlatformData(const ITargetPlatform* TargetPlatform)
@@ -287,6 +342,11 @@ void ULPrefab::ClearCachedCookedPlatformData(const ITargetPlatform* TargetPlatfo
 		ReferenceAssetListForBuild.Empty();
 		ReferenceClassListForBuild.Empty();
 		ReferenceNameListForBuild.Empty();
+		SharedReferenceTableForBuild = nullptr;
+		BundleOffsetForBuild = -1;
+		BundleSizeForBuild = 0;
+		BundleCrcForBuild = 0;
+		CookedBundleEntries.Remove(TargetPlatform->PlatformName());
 	}
 }
 
@@ -326,6 +386,45 @@ void ULPrefab::PostLoad()
 {
 	Super::PostLoad();
 }
+#endif
+
+void ULPrefab::Serialize(FArchive& Ar)
+{
+#if WITH_EDITOR
+	if (Ar.IsSaving() && Ar.IsCooking() && Ar.CookingTarget() != nullptr)
+	{
+		if (auto EntryPtr = CookedBundleEntries.Find(Ar.CookingTarget()->PlatformName()))
+		{
+			//runtime data is in bundle, put a copy in bulk data that is loaded only if bundle entry is not valid
+			BundleFallbackDataForBuild.Lock(LOCK_READ_WRITE);
+			FMemory::Memcpy(BundleFallbackDataForBuild.Realloc(BinaryDataForBuild.Num()), BinaryDataForBuild.GetData(), BinaryDataForBuild.Num());
+			BundleFallbackDataForBuild.Unlock();
+			BundleFallbackDataForBuild.SetBulkDataFlags(BULKDATA_Force_NOT_InlinePayload);
+
+			TArray<uint8> InlineData = MoveTemp(BinaryDataForBuild);
+			BundleOffsetForBuild = EntryPtr->Offset;
+			BundleSizeForBuild = EntryPtr->Size;
+			BundleCrcForBuild = EntryPtr->Crc;
+			bHasBundleFallbackDataForBuild = true;
+			Super::Serialize(Ar);
+			BundleFallbackDataForBuild.Serialize(Ar, this);
+			BinaryDataForBuild = MoveTemp(InlineData);
+			BundleOffsetForBuild = -1;
+			BundleSizeForBuild = 0;
+			BundleCrcForBuild = 0;
+			bHasBundleFallbackDataForBuild = false;
+			return;
+		}
+	}
+#endif
+	Super::Serialize(Ar);
+	if (bHasBundleFallbackDataForBuild)
+	{
+		BundleFallbackDataForBuild.Serialize(Ar, this);
+	}
+}
+
+#if WITH_EDITOR
 
 void ULPrefab::BeginDestroy()
 {
@@ -485,113 +584,82 @@ AActor* ULPrefab::LoadPrefabWithReplacement(UObject* WorldContextObject, USceneC
 	auto World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
 	if (World)
 	{
-		TSet<TTuple<int, UObject*>> ReplacedAssets;
-		TSet<TTuple<int, UClass*>> ReplacedClasses;
-		if (InReplaceAssetMap.Num() > 0)
-		{
-			auto& List =
+		auto CallbackBeforeAwake = [&InCallbackBeforeAwake](AActor* RootActor) {
+			InCallbackBeforeAwake.ExecuteIfBound(RootActor);
+			};
 #if WITH_EDITOR
-				ReferenceAssetList;
-#else
-				ReferenceAssetListForBuild;
-#endif
-			for (int i = 0; i < List.Num(); i++)
+		if ((ELPrefabVersion)PrefabVersion == ELPrefabVersion::NewObjectOnNestedPrefab)
+		{
+			//replacement is resolved into serializer's own reference lists, so this prefab is not changed
+			LoadedRootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefabWithReplacement(World, this, InParent, InReplaceAssetMap, InReplaceClassMap, CallbackBeforeAwake);
+		}
+		else
+		{
+			//old serializers read reference lists from prefab directly, so replace in prefab and restore after load
+			TSet<TTuple<int, UObject*>> ReplacedAssets;
+			TSet<TTuple<int, UClass*>> ReplacedClasses;
+			for (int i = 0; i < ReferenceAssetList.Num() && InReplaceAssetMap.Num() > 0; i++)
 			{
-				if (auto ReplaceAssetPtr = InReplaceAssetMap.Find(List[i]))
+				if (auto ReplaceAssetPtr = InReplaceAssetMap.Find(ReferenceAssetList[i]))
 				{
-					ReplacedAssets.Add({ i, List[i] });
-					List[i] = *ReplaceAssetPtr;
+					ReplacedAssets.Add({ i, ReferenceAssetList[i] });
+					ReferenceAssetList[i] = *ReplaceAssetPtr;
 				}
 			}
-		}
-		if (InReplaceClassMap.Num() > 0)
-		{
-			auto& List =
-#if WITH_EDITOR
-				ReferenceClassList;
-#else
-				ReferenceClassListForBuild;
-#endif
-			for (int i = 0; i < List.Num(); i++)
+			for (int i = 0; i < ReferenceClassList.Num() && InReplaceClassMap.Num() > 0; i++)
 			{
-				if (auto ReplaceClassPtr = InReplaceClassMap.Find(List[i]))
+				if (auto ReplaceClassPtr = InReplaceClassMap.Find(ReferenceClassList[i]))
 				{
-					ReplacedClasses.Add({ i, List[i] });
-					List[i] = *ReplaceClassPtr;
+					ReplacedClasses.Add({ i, ReferenceClassList[i] });
+					ReferenceClassList[i] = *ReplaceClassPtr;
 				}
 			}
-		}
-		auto CallbackBeforeAwake = [&InCallbackBeforeAwake](AActor* RootActor) {
-			InCallbackBeforeAwake.ExecuteIfBound(RootActor);
-			};
-#if WITH_EDITOR
-		switch ((ELPrefabVersion)PrefabVersion)
-		{
-		case ELPrefabVersion::NewObjectOnNestedPrefab:
-		{
-			LoadedRootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
-		}
-		break;
-		case ELPrefabVersion::ActorAttachToSubPrefab:
-		{
-			LoadedRootActor = LPrefabSystem7::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
-		}
-		break;
-		case ELPrefabVersion::CommonActor:
-		{
-			LoadedRootActor = LPrefabSystem6::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
-		}
-		break;
-		case ELPrefabVersion::ObjectName:
-		{
-			LoadedRootActor = LPrefabSystem5::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
-		}
-		break;
-		case ELPrefabVersion::NestedDefaultSubObject:
-		{
-			LoadedRootActor = LPrefabSystem4::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
-		}
-		break;
-		case ELPrefabVersion::BuildinFArchive:
-		{
-			LoadedRootActor = LPrefabSystem3::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
-		}
-		break;
-		default:
-		{
-			UE_LOG(LPrefab, Error, TEXT("[%s].%d This prefab version is too old to support this function, open this prefab and hit \"Apply\" button to fix it. Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *this->GetPathName());
-		}
-		break;
-		}
-#else
-		LoadedRootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
-#endif
-		if (ReplacedAssets.Num() > 0)
-		{
-			auto& List =
-#if WITH_EDITOR
-				ReferenceAssetList;
-#else
-				ReferenceAssetListForBuild;
-#endif
+			switch ((ELPrefabVersion)PrefabVersion)
+			{
+			case ELPrefabVersion::ActorAttachToSubPrefab:
+			{
+				LoadedRootActor = LPrefabSystem7::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
+			}
+			break;
+			case ELPrefabVersion::CommonActor:
+			{
+				LoadedRootActor = LPrefabSystem6::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
+			}
+			break;
+			case ELPrefabVersion::ObjectName:
+			{
+				LoadedRootActor = LPrefabSystem5::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
+			}
+			break;
+			case ELPrefabVersion::NestedDefaultSubObject:
+			{
+				LoadedRootActor = LPrefabSystem4::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
+			}
+			break;
+			case ELPrefabVersion::BuildinFArchive:
+			{
+				LoadedRootActor = LPrefabSystem3::ActorSerializer::LoadPrefab(World, this, InParent, false, CallbackBeforeAwake);
+			}
+			break;
+			default:
+			{
+				UE_LOG(LPrefab, Error, TEXT("[%s].%d This prefab version is too old to support this function, open this prefab and hit \"Apply\" button to fix it. Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *this->GetPathName());
+			}
+			break;
+			}
 			for (auto& Item : ReplacedAssets)
 			{
-				List[Item.Key] = Item.Value;
+				ReferenceAssetList[Item.Key] = Item.Value;
 			}
-		}
-		if (ReplacedClasses.Num() > 0)
-		{
-			auto& List =
-#if WITH_EDITOR
-				ReferenceClassList;
-#else
-				ReferenceClassListForBuild;
-#endif
 			for (auto& Item : ReplacedClasses)
 			{
-				List[Item.Key] = Item.Value;
+				ReferenceClassList[Item.Key] = Item.Value;
 			}
 		}
+#else
+		//replacement is resolved into serializer's own reference lists, so this prefab and the shared table are not changed
+		LoadedRootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefabWithReplacement(World, this, InParent, InReplaceAssetMap, InReplaceClassMap, CallbackBeforeAwake);
+#endif
 	}
 	return LoadedRootActor;
 }
@@ -647,6 +715,155 @@ AActor* ULPrefab::LoadPrefabWithTransform(UObject* WorldContextObject, USceneCom
 	return LoadedRootActor;
 }
 
+AActor* ULPrefab::LoadPrefabWithHandle(UObject* WorldContextObject, USceneComponent* InParent, FVector Location, FRotator Rotation, FVector Scale, FLPrefabInstanceHandle& OutHandle)
+{
+	OutHandle.Reset();
+	AActor* LoadedRootActor = nullptr;
+	auto World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	if (World)
+	{
+#if WITH_EDITOR
+		if ((ELPrefabVersion)PrefabVersion != ELPrefabVersion::NewObjectOnNestedPrefab)
+		{
+			//old serializer have no handle support, collect from hierarchy instead
+			LoadedRootActor = LoadPrefabWithTransform(World, InParent, Location, Rotation.Quaternion(), Scale, [&OutHandle](AActor* RootActor) {
+				OutHandle.InitFromHierarchy(RootActor);
+				});
+			return LoadedRootActor;
+		}
+#endif
+		LoadedRootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::LoadPrefab(World, this, InParent, Location, Rotation.Quaternion(), Scale, nullptr, &OutHandle);
+	}
+	return LoadedRootActor;
+}
+
+AActor* ULPrefab::ApplyToInstance(FLPrefabInstanceHandle& InOutHandle)
+{
+#if WITH_EDITOR
+	if ((ELPrefabVersion)PrefabVersion != ELPrefabVersion::NewObjectOnNestedPrefab)
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Prefab: '%s' is old version, need to resave it."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *this->GetPathName());
+		return nullptr;
+	}
+#endif
+	return LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::ApplyPrefabToInstance(this, InOutHandle);
+}
+
+bool ULPrefab::SaveInstanceDelta(const FLPrefabInstanceHandle& InHandle, TArray<uint8>& OutDelta)
+{
+#if WITH_EDITOR
+	if ((ELPrefabVersion)PrefabVersion != ELPrefabVersion::NewObjectOnNestedPrefab)
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Prefab: '%s' is old version, need to resave it."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *this->GetPathName());
+		return false;
+	}
+#endif
+	return LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::SaveInstanceDelta(this, InHandle, OutDelta);
+}
+
+AActor* ULPrefab::RestoreInstanceDelta(UObject* WorldContextObject, USceneComponent* InParent, FVector Location, FRotator Rotation, FVector Scale, const TArray<uint8>& InDelta, FLPrefabInstanceHandle& OutHandle)
+{
+	OutHandle.Reset();
+#if WITH_EDITOR
+	if ((ELPrefabVersion)PrefabVersion != ELPrefabVersion::NewObjectOnNestedPrefab)
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Prefab: '%s' is old version, need to resave it."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *this->GetPathName());
+		return nullptr;
+	}
+#endif
+	AActor* LoadedRootActor = nullptr;
+	auto World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	if (World)
+	{
+		LoadedRootActor = LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::RestoreInstanceDelta(World, this, InParent, Location, Rotation.Quaternion(), Scale, InDelta, &OutHandle);
+	}
+	return LoadedRootActor;
+}
+
+ULPrefab* ULPrefab::CreateTransientFromActor(AActor* RootActor)
+{
+	if (!IsValid(RootActor))
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d RootActor is not valid!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+		return nullptr;
+	}
+	//shared movie scene is not outered by the sequence so it will not be serialized, use a copy of it instead
+	{
+		TArray<AActor*> ChildrenActors;
+		LPrefabUtils::CollectChildrenActors(RootActor, ChildrenActors);
+		for (auto& Actor : ChildrenActors)
+		{
+			ForEachObjectWithOuter(Actor, [](UObject* InObject) {
+				if (auto Sequence = Cast<ULPrefabSequence>(InObject))
+				{
+					Sequence->UnshareMovieScene();
+				}
+				});
+		}
+	}
+	auto Prefab = NewObject<ULPrefab>(GetTransientPackage(), NAME_None, RF_Transient);
+	TMap<UObject*, FGuid> MapObjectToGuid;
+	TMap<TObjectPtr<AActor>, FLSubPrefabData> SubPrefabMap;
+	//LoadPrefab read editor data in editor, and runtime data in packaged game
+#if WITH_EDITOR
+	const bool bForEditorOrRuntimeUse = true;
+#else
+	const bool bForEditorOrRuntimeUse = false;
+#endif
+	LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::SavePrefab(RootActor, Prefab, MapObjectToGuid, SubPrefabMap, bForEditorOrRuntimeUse);
+	const bool bHasData =
+#if WITH_EDITOR
+		Prefab->BinaryData.Num() > 0;
+#else
+		Prefab->BinaryDataForBuild.Num() > 0;
+#endif
+	if (!bHasData)
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Fail to capture actor: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *RootActor->GetPathName());
+		Prefab->MarkAsGarbage();
+		return nullptr;
+	}
+	return Prefab;
+}
+
+TSharedPtr<const FLPrefabBakedSequence> ULPrefab::FindBakedSequence(const FGuid& InSequenceGuid)const
+{
+	if (auto SharedPtr = SharedBakedSequences.Find(InSequenceGuid))
+	{
+		return *SharedPtr;
+	}
+	auto BakedDataPtr = BakedSequencesForBuild.Find(InSequenceGuid);
+	if (BakedDataPtr == nullptr || !BakedDataPtr->IsValid())return nullptr;
+	TSharedPtr<const FLPrefabBakedSequence> Shared = MakeShared<FLPrefabBakedSequence>(*BakedDataPtr);
+	SharedBakedSequences.Add(InSequenceGuid, Shared);
+	return Shared;
+}
+
+TArrayView64<const uint8> ULPrefab::GetBinaryDataForBuild()const
+{
+	if (BundleOffsetForBuild >= 0)
+	{
+		auto Data = FLPrefabBundle::Get().GetData(BundleOffsetForBuild, BundleSizeForBuild, BundleCrcForBuild, !bBundleDataVerified);
+		if (Data.Num() > 0)
+		{
+			bBundleDataVerified = true;
+			return Data;
+		}
+		if (bHasBundleFallbackDataForBuild)
+		{
+			if (BundleFallbackLoadedData.Num() == 0 && BundleFallbackDataForBuild.GetBulkDataSize() > 0)
+			{
+				UE_LOG(LPrefab, Warning, TEXT("[%s].%d Bundle entry not valid, use data in package. Prefab: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *(this->GetPathName()));
+				BundleFallbackLoadedData.SetNumUninitialized(BundleFallbackDataForBuild.GetBulkDataSize());
+				void* Dest = BundleFallbackLoadedData.GetData();
+				BundleFallbackDataForBuild.GetCopy(&Dest, true);
+			}
+			return TArrayView64<const uint8>(BundleFallbackLoadedData.GetData(), BundleFallbackLoadedData.Num());
+		}
+	}
+	return TArrayView64<const uint8>(BinaryDataForBuild.GetData(), BinaryDataForBuild.Num());
+}
+
 #if WITH_EDITOR
 AActor* ULPrefab::LoadPrefabWithExistingObjects(UWorld* InWorld, USceneComponent* InParent
 	, TMap<FGuid, TObjectPtr<UObject>>& InOutMapGuidToObject, TMap<TObjectPtr<AActor>, FLSubPrefabData>& OutSubPrefabMap
@@ -796,6 +1013,7 @@ void ULPrefab::SavePrefab(AActor* RootActor
 		, InOutMapObjectToGuid, InSubPrefabMap
 		, InForEditorOrRuntimeUse
 	);
+	SharedSequenceMovieScenes.Empty();//data changed, PIE instances loaded after this should not use old movie scene
 }
 
 void ULPrefab::RecreatePrefab()
@@ -0,0 +1,214 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabSystem/LPrefabBundle.h"
+#include "PrefabSystem/LPrefabSettings.h"
+#include "LPrefabModule.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/MappedFileHandle.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#if WITH_EDITOR
+#include "Interfaces/ITargetPlatform.h"
+#include "HAL/CriticalSection.h"
+#include "Misc/App.h"
+#endif
+
+FLPrefabBundle::~FLPrefabBundle()
+{
+	if (MappedFileRegion != nullptr)
+	{
+		delete MappedFileRegion;
+		MappedFileRegion = nullptr;
+	}
+	if (MappedFileHandle != nullptr)
+	{
+		delete MappedFileHandle;
+		MappedFileHandle = nullptr;
+	}
+}
+
+FLPrefabBundle& FLPrefabBundle::Get()
+{
+	static FLPrefabBundle Instance;
+	if (!Instance.bOpened)
+	{
+		Instance.OpenBundle();
+	}
+	return Instance;
+}
+
+FString FLPrefabBundle::GetBundleFilePath()
+{
+	return FPaths::ProjectContentDir() / GetDefault<ULPrefabSettings>()->PrefabBundleFile;
+}
+
+void FLPrefabBundle::OpenBundle()
+{
+	bOpened = true;
+	auto FilePath = GetBundleFilePath();
+	auto& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	MappedFileHandle = PlatformFile.OpenMapped(*FilePath);
+	if (MappedFileHandle != nullptr)
+	{
+		MappedFileRegion = MappedFileHandle->MapRegion(0, MappedFileHandle->GetFileSize());
+		if (MappedFileRegion != nullptr)
+		{
+			BundleData = TArrayView64<const uint8>(MappedFileRegion->GetMappedPtr(), MappedFileRegion->GetMappedSize());
+		}
+	}
+	if (BundleData.Num() == 0)//can not map the file, load it to memory
+	{
+		if (FFileHelper::LoadFileToArray(LoadedFileData, *FilePath, FILEREAD_Silent))
+		{
+			BundleData = TArrayView64<const uint8>(LoadedFileData.GetData(), LoadedFileData.Num());
+		}
+		else
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Can not open prefab bundle file: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *FilePath);
+			return;
+		}
+	}
+	if (BundleData.Num() < BundleHeaderSize || *(const uint32*)BundleData.GetData() != BundleFileMagic || *(const uint32*)(BundleData.GetData() + 4) != BundleFileVersion)
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Not valid prefab bundle file: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *FilePath);
+		BundleData = TArrayView64<const uint8>();
+	}
+}
+
+TArrayView64<const uint8> FLPrefabBundle::GetData(int64 InOffset, int64 InSize, uint32 InCrc, bool bVerifyData)
+{
+	if (InOffset < BundleHeaderSize + BundleEntryHeaderSize || InSize <= 0 || InOffset + InSize > BundleData.Num())
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Out of range, offset: %lld, size: %lld, bundle size: %lld"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, InOffset, InSize, BundleData.Num());
+		return TArrayView64<const uint8>();
+	}
+	const uint8* EntryHeader = BundleData.GetData() + InOffset - BundleEntryHeaderSize;
+	if (*(const uint32*)EntryHeader != BundleEntryMagic || *(const uint32*)(EntryHeader + 4) != InCrc || *(const int64*)(EntryHeader + 8) != InSize)
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Entry not match, offset: %lld, size: %lld, crc: %u"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, InOffset, InSize, InCrc);
+		return TArrayView64<const uint8>();
+	}
+	auto Data = BundleData.Slice(InOffset, InSize);
+	if (bVerifyData && FCrc::MemCrc32(Data.GetData(), Data.Num()) != InCrc)
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Data crc not match, offset: %lld, size: %lld, crc: %u"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, InOffset, InSize, InCrc);
+		return TArrayView64<const uint8>();
+	}
+	return Data;
+}
+
+#if WITH_EDITOR
+FString FLPrefabBundle::GetCookedBundleFilePath(const ITargetPlatform* InTargetPlatform)
+{
+	return FPaths::ProjectSavedDir() / TEXT("Cooked") / InTargetPlatform->PlatformName() / FApp::GetProjectName() / TEXT("Content") / GetDefault<ULPrefabSettings>()->PrefabBundleFile;
+}
+
+int64 FLPrefabBundle::AppendForCook(const ITargetPlatform* InTargetPlatform, const TArray<uint8>& InData, uint32& OutCrc)
+{
+	OutCrc = FCrc::MemCrc32(InData.GetData(), InData.Num());
+	const int64 DataSize = InData.Num();
+	const auto FilePath = GetCookedBundleFilePath(InTargetPlatform);
+
+	//multi-process cook could write the same file at the same time
+	FSystemWideCriticalSection FileLock(FString::Printf(TEXT("LPrefabBundle_%08x"), FCrc::StrCrc32(*FPaths::ConvertRelativePathToFull(FilePath))), FTimespan::FromSeconds(60));
+	if (!FileLock.IsValid())
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Can not lock prefab bundle file: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *FilePath);
+		return -1;
+	}
+
+	//entries in file (key is crc and size, value is data offset), only read entries that are appended after last call
+	struct FCookedBundleIndex
+	{
+		int64 IndexedSize = 0;
+		TMap<TPair<uint32, int64>, int64> Entries;
+	};
+	static TMap<FString, FCookedBundleIndex> CookedBundleIndices;
+	auto& Index = CookedBundleIndices.FindOrAdd(FilePath);
+
+	auto& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(FilePath));
+	TUniquePtr<IFileHandle> FileHandle(PlatformFile.OpenWrite(*FilePath, true, true));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Can not open prefab bundle file: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *FilePath);
+		return -1;
+	}
+	auto FileSize = FileHandle->Size();
+	if (FileSize < Index.IndexedSize)//file is deleted and created again, eg. clean cook
+	{
+		Index = FCookedBundleIndex();
+	}
+	if (FileSize >= BundleHeaderSize && Index.IndexedSize == 0)
+	{
+		uint8 Header[BundleHeaderSize] = { 0 };
+		FileHandle->Seek(0);
+		if (!FileHandle->Read(Header, BundleHeaderSize) || *(uint32*)Header != BundleFileMagic || *(uint32*)(Header + 4) != BundleFileVersion)
+		{
+			UE_LOG(LPrefab, Log, TEXT("[%s].%d Prefab bundle file is not valid or from old version, recreate it: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *FilePath);
+			FileHandle.Reset(PlatformFile.OpenWrite(*FilePath, false, true));
+			if (!FileHandle.IsValid())
+			{
+				UE_LOG(LPrefab, Error, TEXT("[%s].%d Can not create prefab bundle file: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *FilePath);
+				return -1;
+			}
+			FileSize = 0;
+		}
+	}
+	if (FileSize == 0)
+	{
+		uint8 Header[BundleHeaderSize] = { 0 };
+		*(uint32*)Header = BundleFileMagic;
+		*(uint32*)(Header + 4) = BundleFileVersion;
+		if (!FileHandle->Write(Header, BundleHeaderSize))
+		{
+			UE_LOG(LPrefab, Error, TEXT("[%s].%d Write prefab bundle file fail: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *FilePath);
+			return -1;
+		}
+		FileSize = BundleHeaderSize;
+		Index = FCookedBundleIndex();
+		Index.IndexedSize = FileSize;
+	}
+	//read entries that are written by other process or previous cook
+	for (int64 Position = Align(FMath::Max(Index.IndexedSize, BundleHeaderSize), BundleDataAlignment); Position + BundleEntryHeaderSize <= FileSize; )
+	{
+		uint8 EntryHeader[BundleEntryHeaderSize] = { 0 };
+		FileHandle->Seek(Position);
+		if (!FileHandle->Read(EntryHeader, BundleEntryHeaderSize) || *(uint32*)EntryHeader != BundleEntryMagic)
+		{
+			break;
+		}
+		const uint32 EntryCrc = *(uint32*)(EntryHeader + 4);
+		const int64 EntrySize = *(int64*)(EntryHeader + 8);
+		Index.Entries.Add(MakeTuple(EntryCrc, EntrySize), Position + BundleEntryHeaderSize);
+		Position = Align(Position + BundleEntryHeaderSize + EntrySize, BundleDataAlignment);
+	}
+	Index.IndexedSize = FileSize;
+
+	if (auto OffsetPtr = Index.Entries.Find(MakeTuple(OutCrc, DataSize)))
+	{
+		return *OffsetPtr;
+	}
+
+	FileHandle->SeekFromEnd(0);
+	const auto EntryPosition = Align(FileSize, BundleDataAlignment);
+	if (EntryPosition > FileSize)
+	{
+		uint8 Padding[BundleDataAlignment] = { 0 };
+		FileHandle->Write(Padding, EntryPosition - FileSize);
+	}
+	uint8 EntryHeader[BundleEntryHeaderSize] = { 0 };
+	*(uint32*)EntryHeader = BundleEntryMagic;
+	*(uint32*)(EntryHeader + 4) = OutCrc;
+	*(int64*)(EntryHeader + 8) = DataSize;
+	if (!FileHandle->Write(EntryHeader, BundleEntryHeaderSize) || !FileHandle->Write(InData.GetData(), DataSize))
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d Write prefab bundle file fail: '%s'"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *FilePath);
+		return -1;
+	}
+	const auto Offset = EntryPosition + BundleEntryHeaderSize;
+	Index.Entries.Add(MakeTuple(OutCrc, DataSize), Offset);
+	Index.IndexedSize = Offset + DataSize;
+	return Offset;
+}
+#endif
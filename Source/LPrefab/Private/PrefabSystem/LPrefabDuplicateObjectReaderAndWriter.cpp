@@ -11,23 +11,18 @@
 
 namespace LPrefabSystem
 {
-	FLPrefabDuplicateObjectWriter::FLPrefabDuplicateObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames)
+	FLPrefabDuplicateObjectWriter::FLPrefabDuplicateObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames)
 		: FLPrefabObjectWriter(Bytes, InSerializer, InSkipPropertyNames)
 	{
 		
 	}
 	bool FLPrefabDuplicateObjectWriter::ShouldSkipProperty(const FProperty* InProperty) const
 	{
-		if (InProperty->HasAnyPropertyFlags(CPF_Transient | CPF_DuplicateTransient | CPF_NonPIEDuplicateTransient | CPF_DisableEditOnInstance)
-			|| InProperty->IsA<FMulticastDelegateProperty>()
-			|| InProperty->IsA<FDelegateProperty>()
-			)
+		if (LPrefab_ShouldSkipPropertyForDuplicate(InProperty))
 		{
 			return true;
 		}
-		if (SkipPropertyNames.Contains(InProperty->GetFName())
-			&& CurrentIsMemberProperty(*this)//Skip property only support UObject's member property
-			)
+		if (IsSkipMemberProperty(InProperty))//Skip property only support UObject's member property, and cached member properties are exactly what we need
 		{
 			return true;
 		}
@@ -105,6 +100,14 @@ namespace LPrefabSystem
 				*this << *guidPtr;
 				return true;
 			}
+			else if (Serializer.bStoreExternalObjectByIndex)//template could be used after the object is destroyed, so store as index and keep weak reference
+			{
+				auto id = Serializer.FindOrAddExternalObject(Object);
+				auto type = (uint8)EObjectType::ExternalObjectForDuplicate;
+				*this << type;
+				*this << id;
+				return true;
+			}
 			else//object not belongs to this actor hierarchy, just copy pointer
 			{
 				auto type = (uint8)EObjectType::NativeSerailizeForDuplicate;
@@ -121,23 +124,18 @@ namespace LPrefabSystem
 
 
 
-	FLPrefabDuplicateObjectReader::FLPrefabDuplicateObjectReader(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames)
+	FLPrefabDuplicateObjectReader::FLPrefabDuplicateObjectReader(const TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames)
 		: FLPrefabObjectReader(Bytes, InSerializer, InSkipPropertyNames)
 	{
 
 	}
 	bool FLPrefabDuplicateObjectReader::ShouldSkipProperty(const FProperty* InProperty) const
 	{
-		if (InProperty->HasAnyPropertyFlags(CPF_Transient | CPF_DuplicateTransient | CPF_NonPIEDuplicateTransient | CPF_DisableEditOnInstance)
-			|| InProperty->IsA<FMulticastDelegateProperty>()
-			|| InProperty->IsA<FDelegateProperty>()
-			)
+		if (LPrefab_ShouldSkipPropertyForDuplicate(InProperty))
 		{
 			return true;
 		}
-		if (SkipPropertyNames.Contains(InProperty->GetFName())
-			&& CurrentIsMemberProperty(*this)//Skip property only support UObject's member property
-			)
+		if (IsSkipMemberProperty(InProperty))//Skip property only support UObject's member property, and cached member properties are exactly what we need
 		{
 			return true;
 		}
@@ -178,7 +176,7 @@ namespace LPrefabSystem
 			*this << FunctionNameId;
 			auto OuterClass = Serializer.FindClassFromListByIndex(OuterClasstId);
 			auto FunctionName = Serializer.FindNameFromListByIndex(FunctionNameId);
-			Object = OuterClass->FindFunctionByName(FunctionName);
+			Object = FLPrefabFunctionReferenceCache::FindFunction(OuterClass, FunctionName);
 			return true;
 		}
 		break;
@@ -194,12 +192,7 @@ namespace LPrefabSystem
 				if (OuterObject != nullptr)
 				{
 					auto NodeName = Serializer.FindNameFromListByIndex(NodeNameId);
-					ForEachObjectWithOuter(OuterObject, [&NodeName, &Object](UObject* ItemObject) {
-						if (NodeName == ItemObject->GetFName())
-						{
-							Object = ItemObject;
-						}
-						});
+					Object = FLPrefabFunctionReferenceCache::FindK2Node(OuterObject, NodeName);
 					return true;
 				}
 			}
@@ -209,9 +202,9 @@ namespace LPrefabSystem
 		{
 			FGuid guid;
 			*this << guid;
-			if (auto ObjectPtr = Serializer.MapGuidToObject.Find(guid))
+			if (auto FoundObject = Serializer.FindObjectByGuid(guid))
 			{
-				Object = *ObjectPtr;
+				Object = FoundObject;
 				return true;
 			}
 		}
@@ -222,6 +215,14 @@ namespace LPrefabSystem
 			return true;
 		}
 		break;
+		case LPrefabSystem::EObjectType::ExternalObjectForDuplicate:
+		{
+			int32 id = -1;
+			*this << id;
+			Object = Serializer.FindExternalObjectByIndex(id);//null if object is destroyed after template is prepared
+			return true;
+		}
+		break;
 		}
 		return false;
 	}
@@ -229,4 +230,49 @@ namespace LPrefabSystem
 	{
 		return TEXT("FLPrefabDuplicateObjectReader");
 	}
+
+
+
+	FLPrefabDuplicateReferenceCollector::FLPrefabDuplicateReferenceCollector(ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames)
+		: Serializer(InSerializer)
+		, SkipNameSetId(FLPrefabSkipPropertyCache::GetSkipNameSetId(InSkipPropertyNames))
+	{
+		ArIsObjectReferenceCollector = true;
+		ArIgnoreOuterRef = true;
+		ArIgnoreClassRef = true;
+		ArIgnoreArchetypeRef = true;
+		SetIsPersistent(true);
+	}
+	void FLPrefabDuplicateReferenceCollector::DoSerialize(UObject* Object)
+	{
+		SkipMemberProperties = FLPrefabSkipPropertyCache::GetSkipMemberProperties(Object->GetClass(), SkipNameSetId);
+		Object->Serialize(*this);
+		SkipMemberProperties = nullptr;
+	}
+	bool FLPrefabDuplicateReferenceCollector::ShouldSkipProperty(const FProperty* InProperty) const
+	{
+		if (LPrefab_ShouldSkipPropertyForDuplicate(InProperty))
+		{
+			return true;
+		}
+		if (IsSkipMemberProperty(InProperty))
+		{
+			return true;
+		}
+
+		return false;
+	}
+	FArchive& FLPrefabDuplicateReferenceCollector::operator<<(UObject*& Res)
+	{
+		if (Res != nullptr)
+		{
+			FGuid guid;
+			Serializer.CollectObjectToSerailize(Res, guid);
+		}
+		return *this;
+	}
+	FString FLPrefabDuplicateReferenceCollector::GetArchiveName() const
+	{
+		return TEXT("FLPrefabDuplicateReferenceCollector");
+	}
 }
@@ -170,7 +170,7 @@ namespace LPrefabSystem
 			*this << FunctionNameId;
 			auto OuterClass = Serializer.FindClassFromListByIndex(OuterClasstId);
 			auto FunctionName = Serializer.FindNameFromListByIndex(FunctionNameId);
-			Object = OuterClass->FindFunctionByName(FunctionName);
+			Object = FLPrefabFunctionReferenceCache::FindFunction(OuterClass, FunctionName);
 			return true;
 		}
 		break;
@@ -186,12 +186,7 @@ namespace LPrefabSystem
 				if (OuterObject != nullptr)
 				{
 					auto NodeName = Serializer.FindNameFromListByIndex(NodeNameId);
-					ForEachObjectWithOuter(OuterObject, [&NodeName, &Object](UObject* ItemObject) {
-						if (NodeName == ItemObject->GetFName())
-						{
-							Object = ItemObject;
-						}
-						});
+					Object = FLPrefabFunctionReferenceCache::FindK2Node(OuterObject, NodeName);
 					return true;
 				}
 			}
@@ -0,0 +1,222 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabSystem/LPrefabHierarchyIndex.h"
+#include "PrefabSystem/LPrefabManager.h"
+#include "GameFramework/Actor.h"
+#include "Components/ActorComponent.h"
+#include "Engine/World.h"
+#include "Algo/BinarySearch.h"
+#include "LPrefabModule.h"
+
+DECLARE_CYCLE_STAT(TEXT("LPrefab RebuildHierarchyIndex"), STAT_RebuildHierarchyIndex, STATGROUP_LexPrefab);
+
+void FLPrefabHierarchyIndex::Enable(AActor* InRootActor)
+{
+	if (!IsValid(InRootActor) || InRootActor->GetWorld() == nullptr)
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d InRootActor is not valid!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+		return;
+	}
+	if (auto PrefabManager = ULPrefabWorldSubsystem::GetInstance(InRootActor->GetWorld()))
+	{
+		PrefabManager->EnableHierarchyIndex(InRootActor);
+	}
+}
+void FLPrefabHierarchyIndex::Disable(AActor* InRootActor)
+{
+	if (InRootActor == nullptr || InRootActor->GetWorld() == nullptr)return;
+	if (auto PrefabManager = ULPrefabWorldSubsystem::GetInstance(InRootActor->GetWorld()))
+	{
+		PrefabManager->DisableHierarchyIndex(InRootActor);
+	}
+}
+void FLPrefabHierarchyIndex::MarkDirty(AActor* InActor)
+{
+	//no fast path with HierarchyIndexCount, scheduled sequence players also use this notification
+	if (InActor == nullptr || InActor->GetWorld() == nullptr)return;
+	if (auto PrefabManager = ULPrefabWorldSubsystem::GetInstance(InActor->GetWorld()))
+	{
+		PrefabManager->MarkHierarchyIndexDirty(InActor);
+	}
+}
+FLPrefabHierarchyIndex* FLPrefabHierarchyIndex::Find(AActor* InActor)
+{
+	if (ULPrefabWorldSubsystem::HierarchyIndexCount == 0)return nullptr;//fast path if no one use index
+	if (InActor == nullptr)return nullptr;
+	auto World = InActor->GetWorld();
+	if (World == nullptr)return nullptr;
+	if (auto PrefabManager = ULPrefabWorldSubsystem::GetInstance(World))
+	{
+		return PrefabManager->FindHierarchyIndex(InActor);
+	}
+	return nullptr;
+}
+
+FLPrefabHierarchyIndex::FLPrefabHierarchyIndex(AActor* InRootActor)
+	: RootActor(InRootActor)
+{
+
+}
+void FLPrefabHierarchyIndex::Rebuild()
+{
+	SCOPE_CYCLE_COUNTER(STAT_RebuildHierarchyIndex);
+	bDirty = false;
+	Nodes.Reset();
+	Components.Reset();
+	MapActorToNode.Reset();
+	MapClassToComponents.Reset();
+	if (auto Root = RootActor.Get())
+	{
+		AddNodeRecursive(Root, INDEX_NONE);
+	}
+}
+void FLPrefabHierarchyIndex::AddNodeRecursive(AActor* InActor, int32 InParentIndex)
+{
+	const int32 NodeIndex = Nodes.AddDefaulted();
+	MapActorToNode.Add(InActor, NodeIndex);
+	{
+		auto& Node = Nodes[NodeIndex];
+		Node.Actor = InActor;
+		Node.ParentIndex = InParentIndex;
+		Node.ComponentStart = Components.Num();
+	}
+	for (UActorComponent* Comp : InActor->GetComponents())
+	{
+		if (IsValid(Comp))
+		{
+			Components.Add({ Comp, NodeIndex });
+		}
+	}
+	Nodes[NodeIndex].ComponentEnd = Components.Num();
+
+	TArray<AActor*> ChildrenActors;
+	InActor->GetAttachedActors(ChildrenActors);
+	for (auto ChildActor : ChildrenActors)
+	{
+		if (IsValid(ChildActor) && !MapActorToNode.Contains(ChildActor))
+		{
+			AddNodeRecursive(ChildActor, NodeIndex);
+		}
+	}
+	Nodes[NodeIndex].SubtreeEnd = Nodes.Num();
+}
+const TArray<int32>& FLPrefabHierarchyIndex::GetComponentsOfClass(UClass* InClass)
+{
+	auto Key = FObjectKey(InClass);
+	if (auto ExistingPtr = MapClassToComponents.Find(Key))
+	{
+		return *ExistingPtr;
+	}
+	auto& Result = MapClassToComponents.Add(Key);
+	for (int i = 0; i < Components.Num(); i++)
+	{
+		auto Comp = Components[i].Component.Get();
+		if (Comp != nullptr && Comp->IsA(InClass))
+		{
+			Result.Add(i);
+		}
+	}
+	return Result;
+}
+int32 FLPrefabHierarchyIndex::GetSubtreeComponentEnd(int32 InNodeIndex)const
+{
+	const int32 SubtreeEnd = Nodes[InNodeIndex].SubtreeEnd;
+	return SubtreeEnd < Nodes.Num() ? Nodes[SubtreeEnd].ComponentStart : Components.Num();
+}
+UActorComponent* FLPrefabHierarchyIndex::FindFirstValid(const TArray<int32>& InClassComponents, int32 InComponentStart, int32 InComponentEnd)const
+{
+	for (int i = Algo::LowerBound(InClassComponents, InComponentStart); i < InClassComponents.Num() && InClassComponents[i] < InComponentEnd; i++)
+	{
+		auto Comp = Components[InClassComponents[i]].Component.Get();
+		if (IsValid(Comp))
+		{
+			return Comp;
+		}
+	}
+	return nullptr;
+}
+
+bool FLPrefabHierarchyIndex::GetComponentsInChildren(AActor* InActor, UClass* InClass, bool bIncludeSelf, const TSet<AActor*>& InExcludeNode, TArray<UActorComponent*>& OutComponents)
+{
+	auto NodeIndexPtr = MapActorToNode.Find(InActor);
+	if (NodeIndexPtr == nullptr)return false;
+	const int32 NodeIndex = *NodeIndexPtr;
+	if (bIncludeSelf && InExcludeNode.Contains(InActor))return true;
+
+	const int32 ComponentStart = bIncludeSelf ? Nodes[NodeIndex].ComponentStart : Nodes[NodeIndex].ComponentEnd;
+	const int32 ComponentEnd = GetSubtreeComponentEnd(NodeIndex);
+	//excluded subtree is also a range of nodes
+	TArray<TPair<int32, int32>, TInlineAllocator<8>> ExcludeNodeRanges;
+	for (auto ExcludeActor : InExcludeNode)
+	{
+		if (auto ExcludeNodeIndexPtr = MapActorToNode.Find(ExcludeActor))
+		{
+			const int32 ExcludeNodeIndex = *ExcludeNodeIndexPtr;
+			if (ExcludeNodeIndex > NodeIndex && ExcludeNodeIndex < Nodes[NodeIndex].SubtreeEnd)
+			{
+				ExcludeNodeRanges.Add(TPair<int32, int32>(ExcludeNodeIndex, Nodes[ExcludeNodeIndex].SubtreeEnd));
+			}
+		}
+	}
+
+	const auto& ClassComponents = GetComponentsOfClass(InClass);
+	for (int i = Algo::LowerBound(ClassComponents, ComponentStart); i < ClassComponents.Num() && ClassComponents[i] < ComponentEnd; i++)
+	{
+		const auto& Entry = Components[ClassComponents[i]];
+		bool bExcluded = false;
+		for (auto& Range : ExcludeNodeRanges)
+		{
+			if (Entry.NodeIndex >= Range.Key && Entry.NodeIndex < Range.Value)
+			{
+				bExcluded = true;
+				break;
+			}
+		}
+		if (bExcluded)continue;
+		auto Comp = Entry.Component.Get();
+		if (IsValid(Comp))
+		{
+			OutComponents.Add(Comp);
+		}
+	}
+	return true;
+}
+bool FLPrefabHierarchyIndex::GetComponentInChildren(AActor* InActor, UClass* InClass, bool bIncludeSelf, const TSet<AActor*>& InExcludeNode, UActorComponent*& OutComponent)
+{
+	OutComponent = nullptr;
+	if (InExcludeNode.Num() > 0)
+	{
+		TArray<UActorComponent*> Result;
+		if (!GetComponentsInChildren(InActor, InClass, bIncludeSelf, InExcludeNode, Result))return false;
+		OutComponent = Result.Num() > 0 ? Result[0] : nullptr;
+		return true;
+	}
+	auto NodeIndexPtr = MapActorToNode.Find(InActor);
+	if (NodeIndexPtr == nullptr)return false;
+	const int32 NodeIndex = *NodeIndexPtr;
+	const int32 ComponentStart = bIncludeSelf ? Nodes[NodeIndex].ComponentStart : Nodes[NodeIndex].ComponentEnd;
+	OutComponent = FindFirstValid(GetComponentsOfClass(InClass), ComponentStart, GetSubtreeComponentEnd(NodeIndex));
+	return true;
+}
+bool FLPrefabHierarchyIndex::GetComponentInParent(AActor* InActor, UClass* InClass, bool bIncludeSelf, AActor* InStopNode, UActorComponent*& OutComponent, bool& bOutReachRoot)
+{
+	OutComponent = nullptr;
+	bOutReachRoot = false;
+	auto NodeIndexPtr = MapActorToNode.Find(InActor);
+	if (NodeIndexPtr == nullptr)return false;
+	int32 NodeIndex = bIncludeSelf ? *NodeIndexPtr : Nodes[*NodeIndexPtr].ParentIndex;
+	const auto& ClassComponents = GetComponentsOfClass(InClass);
+	while (NodeIndex != INDEX_NONE)
+	{
+		const auto& Node = Nodes[NodeIndex];
+		if (InStopNode != nullptr && Node.Actor.Get() == InStopNode)return true;
+		if (auto Comp = FindFirstValid(ClassComponents, Node.ComponentStart, Node.ComponentEnd))
+		{
+			OutComponent = Comp;
+			return true;
+		}
+		NodeIndex = Node.ParentIndex;
+	}
+	bOutReachRoot = true;
+	return true;
+}
@@ -0,0 +1,72 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabSystem/LPrefabInstanceCluster.h"
+#include "GameFramework/Actor.h"
+#include "Components/SceneComponent.h"
+#include "UObject/UObjectArray.h"
+#include "LPrefabModule.h"
+
+bool ULPrefabInstanceCluster::CreateInstanceCluster(const TArray<AActor*>& InActors)
+{
+	check(!bClusterCreated);
+	for (auto& Actor : InActors)
+	{
+		if (!IsValid(Actor) || !Actor->CanBeInCluster())continue;
+		ClusterObjects.Add(Actor);
+
+		FActorState ActorState;
+		ActorState.Actor = Actor;
+		ActorState.ComponentCount = Actor->GetComponents().Num();
+		ActorStates.Add(ActorState);
+		for (auto& Comp : Actor->GetComponents())
+		{
+			if (auto SceneComp = Cast<USceneComponent>(Comp))
+			{
+				FSceneComponentState CompState;
+				CompState.Component = SceneComp;
+				CompState.AttachParent = SceneComp->GetAttachParent();
+				CompState.AttachChildrenCount = SceneComp->GetAttachChildren().Num();
+				SceneComponentStates.Add(CompState);
+			}
+		}
+	}
+	if (ClusterObjects.Num() == 0)return false;
+
+	CreateCluster();
+	bClusterCreated = true;
+	return true;
+}
+
+bool ULPrefabInstanceCluster::IsInstanceUnchanged()const
+{
+	for (auto& Item : ActorStates)
+	{
+		auto Actor = Item.Actor.Get();
+		if (!IsValid(Actor) || Actor->IsActorBeingDestroyed())return false;
+		if (Actor->GetComponents().Num() != Item.ComponentCount)return false;
+	}
+	for (auto& Item : SceneComponentStates)
+	{
+		auto SceneComp = Item.Component.Get();
+		if (!IsValid(SceneComp))return false;
+		if (SceneComp->GetAttachParent() != Item.AttachParent.Get())return false;
+		if (SceneComp->GetAttachChildren().Num() != Item.AttachChildrenCount)return false;
+	}
+	return true;
+}
+
+bool ULPrefabInstanceCluster::ContainsActor(const AActor* InActor)const
+{
+	return ActorStates.ContainsByPredicate([InActor](const FActorState& Item) { return Item.Actor.Get() == InActor; });
+}
+void ULPrefabInstanceCluster::DissolveInstanceCluster()
+{
+	if (bClusterCreated)
+	{
+		bClusterCreated = false;
+		GUObjectClusters.DissolveCluster(this);
+	}
+	ClusterObjects.Empty();
+	ActorStates.Empty();
+	SceneComponentStates.Empty();
+}
@@ -0,0 +1,137 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabSystem/LPrefabInstanceHandle.h"
+#include "GameFramework/Actor.h"
+#include "Components/ActorComponent.h"
+#include "LPrefabUtils.h"
+#include "LPrefabModule.h"
+
+UObject* FLPrefabInstanceHandle::FindObjectByGuid(const FGuid& InGuid)const
+{
+	if (auto IndexPtr = MapGuidToObjectIndex.Find(InGuid))
+	{
+		return Objects[*IndexPtr].Get();
+	}
+	return nullptr;
+}
+UObject* FLPrefabInstanceHandle::FindObjectByName(FName InName)const
+{
+	if (auto IndexPtr = MapNameToObjectIndex.Find(InName))
+	{
+		if (*IndexPtr == INDEX_NONE)
+		{
+			UE_LOG(LPrefab, Warning, TEXT("[%s].%d Multiple objects have name: '%s', use FindObjectByName with actor instead."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *InName.ToString());
+			return nullptr;
+		}
+		return Objects[*IndexPtr].Get();
+	}
+	return nullptr;
+}
+UObject* FLPrefabInstanceHandle::FindObjectByName(const AActor* InActor, FName InName)const
+{
+	if (auto IndexPtr = MapActorAndNameToObjectIndex.Find(TPair<FObjectKey, FName>(FObjectKey(InActor), InName)))
+	{
+		return Objects[*IndexPtr].Get();
+	}
+	return nullptr;
+}
+void FLPrefabInstanceHandle::AddObjectName(UObject* InObject, int32 InIndex)
+{
+	auto Name = InObject->GetFName();
+	if (auto IndexPtr = MapNameToObjectIndex.Find(Name))
+	{
+		*IndexPtr = INDEX_NONE;
+	}
+	else
+	{
+		MapNameToObjectIndex.Add(Name, InIndex);
+	}
+	MapActorAndNameToObjectIndex.Add(TPair<FObjectKey, FName>(FObjectKey(InObject->GetTypedOuter<AActor>()), Name), InIndex);
+}
+
+void FLPrefabInstanceHandle::Reset()
+{
+	RootActor.Reset();
+	Actors.Reset();
+	Components.Reset();
+	Objects.Reset();
+	MapGuidToObjectIndex.Reset();
+	MapNameToObjectIndex.Reset();
+	MapActorAndNameToObjectIndex.Reset();
+	ObjectDataCRC.Reset();
+	ReferenceTableCRC = 0;
+}
+void FLPrefabInstanceHandle::Init(AActor* InRootActor, const TArray<AActor*>& InActors, const TArray<UActorComponent*>& InComponents, const TMap<FGuid, TObjectPtr<UObject>>& InMapGuidToObject)
+{
+	Reset();
+	RootActor = InRootActor;
+	Actors.Reserve(InActors.Num() + 1);
+	Actors.Add(InRootActor);
+	for (auto& Actor : InActors)
+	{
+		if (Actor != InRootActor)
+		{
+			Actors.Add(Actor);
+		}
+	}
+	Components.Reserve(InComponents.Num());
+	for (auto& Comp : InComponents)
+	{
+		Components.Add(Comp);
+	}
+
+	Objects.Reserve(InMapGuidToObject.Num());
+	MapGuidToObjectIndex.Reserve(InMapGuidToObject.Num());
+	for (auto& KeyValue : InMapGuidToObject)
+	{
+		auto Object = KeyValue.Value.Get();
+		if (Object == nullptr)continue;
+		auto Index = Objects.Add(Object);
+		MapGuidToObjectIndex.Add(KeyValue.Key, Index);
+		if (!Object->IsA<AActor>())
+		{
+			AddObjectName(Object, Index);
+		}
+	}
+}
+void FLPrefabInstanceHandle::SetDataCRC(TMap<FGuid, uint32>&& InObjectDataCRC, uint32 InReferenceTableCRC)
+{
+	ObjectDataCRC = MoveTemp(InObjectDataCRC);
+	ReferenceTableCRC = InReferenceTableCRC;
+}
+void FLPrefabInstanceHandle::GetMapGuidToObject(TMap<FGuid, TObjectPtr<UObject>>& OutMapGuidToObject)const
+{
+	OutMapGuidToObject.Reserve(MapGuidToObjectIndex.Num());
+	for (auto& KeyValue : MapGuidToObjectIndex)
+	{
+		if (auto Object = Objects[KeyValue.Value].Get())
+		{
+			OutMapGuidToObject.Add(KeyValue.Key, Object);
+		}
+	}
+}
+void FLPrefabInstanceHandle::ForEachGuidObject(TFunctionRef<void(const FGuid&, UObject*)> InFunction)const
+{
+	for (auto& KeyValue : MapGuidToObjectIndex)
+	{
+		InFunction(KeyValue.Key, Objects[KeyValue.Value].Get());
+	}
+}
+void FLPrefabInstanceHandle::InitFromHierarchy(AActor* InRootActor)
+{
+	Reset();
+	if (InRootActor == nullptr)return;
+	RootActor = InRootActor;
+	TArray<AActor*> AllActors;
+	LPrefabUtils::CollectChildrenActors(InRootActor, AllActors);
+	Actors.Reserve(AllActors.Num());
+	for (auto& Actor : AllActors)
+	{
+		Actors.Add(Actor);
+		for (auto& Comp : Actor->GetComponents())
+		{
+			Components.Add(Comp);
+			AddObjectName(Comp, Objects.Add(Comp));
+		}
+	}
+}
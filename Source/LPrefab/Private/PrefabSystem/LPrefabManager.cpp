@@ -4,17 +4,28 @@
 #include "LPrefabModule.h"
 #include "Engine/World.h"
 #include "Engine/Engine.h"
+#include "PrefabSystem/LPrefabInstanceCluster.h"
+#include "PrefabSystem/LPrefabHierarchyIndex.h"
+#include "PrefabSystem/LPrefabSettings.h"
+#include "PrefabSystem/LPrefab.h"
+#include "PrefabAnimation/LPrefabSequencePlayer.h"
+#include "Components/PrimitiveComponent.h"
+#include "UObject/UObjectGlobals.h"
 #if WITH_EDITOR
 #include "Editor.h"
 #include "DrawDebugHelpers.h"
 #include "Engine/Selection.h"
 #include "EditorViewportClient.h"
-#include "PrefabSystem/LPrefab.h"
+#include "PrefabSystem/LPrefabObjectReaderAndWriter.h"
 #include "EngineUtils.h"
 #endif
 
 #define LOCTEXT_NAMESPACE "LPrefabManagerObject"
 
+DECLARE_CYCLE_STAT(TEXT("LPrefab DeferredDestroy"), STAT_DeferredDestroy, STATGROUP_LexPrefab);
+DECLARE_CYCLE_STAT(TEXT("LPrefab ScheduleSequencePlayers"), STAT_ScheduleSequencePlayers, STATGROUP_LexPrefab);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("LPrefab Skipped Sequence Player Updates"), STAT_SkippedSequencePlayerUpdates, STATGROUP_LexPrefab);
+
 #if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
 PRAGMA_DISABLE_OPTIMIZATION
 #endif
@@ -217,10 +228,14 @@ bool ULPrefabManagerObject::InitCheck()
 void ULPrefabManagerObject::OnBlueprintPreCompile(UBlueprint* InBlueprint)
 {
 	bIsBlueprintCompiling = true;
+	LPrefabSystem::FLPrefabSkipPropertyCache::Flush();
+	LPrefabSystem::FLPrefabFunctionReferenceCache::Flush();
 }
 void ULPrefabManagerObject::OnBlueprintCompiled()
 {
 	bIsBlueprintCompiling = true;
+	LPrefabSystem::FLPrefabSkipPropertyCache::Flush();
+	LPrefabSystem::FLPrefabFunctionReferenceCache::Flush();
 	AddOneShotTickFunction([this] {
 		bIsBlueprintCompiling = false; 
 		}, 2);
@@ -341,6 +356,152 @@ ULPrefabWorldSubsystem* ULPrefabWorldSubsystem::GetInstance(UWorld* World)
 {
 	return World->GetSubsystem<ULPrefabWorldSubsystem>();
 }
+void ULPrefabWorldSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	PreGarbageCollectDelegateHandle = FCoreUObjectDelegates::GetPreGarbageCollectDelegate().AddUObject(this, &ULPrefabWorldSubsystem::OnPreGarbageCollect);
+	PostGarbageCollectDelegateHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddUObject(this, &ULPrefabWorldSubsystem::OnPostGarbageCollect);
+	ActorDestroyedDelegateHandle = GetWorld()->AddOnActorDestroyedHandler(FOnActorDestroyed::FDelegate::CreateUObject(this, &ULPrefabWorldSubsystem::OnActorDestroyed));
+}
+void ULPrefabWorldSubsystem::Deinitialize()
+{
+	FCoreUObjectDelegates::GetPreGarbageCollectDelegate().Remove(PreGarbageCollectDelegateHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGarbageCollectDelegateHandle);
+	for (auto& Item : InstanceClusters)
+	{
+		if (Item != nullptr)
+		{
+			Item->DissolveInstanceCluster();
+		}
+	}
+	InstanceClusters.Empty();
+	for (auto& Item : PrefabsWithSharedSequence)
+	{
+		if (auto Prefab = Item.Get())
+		{
+			Prefab->SharedSequenceMovieScenes.Empty();
+		}
+	}
+	PrefabsWithSharedSequence.Empty();
+	DeferredDestroyQueue.Empty();
+	GetWorld()->RemoveOnActorDestroyededHandler(ActorDestroyedDelegateHandle);
+	HierarchyIndexCount -= HierarchyIndices.Num();
+	HierarchyIndices.Empty();
+	MapActorToHierarchyIndex.Empty();
+	MapPrefabToInstances.Empty();
+	MapRootActorToPrefabInstance.Empty();
+	ScheduledSequencePlayers.Empty();
+	Super::Deinitialize();
+}
+TStatId ULPrefabWorldSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULPrefabWorldSubsystem, STATGROUP_LexPrefab);
+}
+void ULPrefabWorldSubsystem::Tick(float DeltaTime)
+{
+	if (DeferredDestroyQueue.Num() > 0)
+	{
+		ProcessDeferredDestroy(ULPrefabSettings::GetDeferredDestroyTimeBudget() * 0.001);
+	}
+	if (bPrefabInstanceNeedCleanup)
+	{
+		CleanupPrefabInstances();
+	}
+}
+
+void ULPrefabWorldSubsystem::DestroyActorsDeferred(const TArray<AActor*>& InActors)
+{
+	DeferredDestroyQueue.Reserve(DeferredDestroyQueue.Num() + InActors.Num());
+	//reverse order, so children are destroyed before parent
+	for (int i = InActors.Num() - 1; i >= 0; i--)
+	{
+		auto Actor = InActors[i];
+		if (!IsValid(Actor) || Actor->IsActorBeingDestroyed())continue;
+		Actor->SetActorHiddenInGame(true);
+		Actor->SetActorEnableCollision(false);
+		Actor->SetActorTickEnabled(false);
+		MarkHierarchyIndexDirty(Actor);//hierarchy will change in later frames, outer index may not be notified when destroyed
+		FDeferredDestroyItem Item;
+		Item.Actor = Actor;
+		DeferredDestroyQueue.Add(Item);
+	}
+}
+void ULPrefabWorldSubsystem::FlushDeferredDestroy()
+{
+	ProcessDeferredDestroy(-1);
+}
+void ULPrefabWorldSubsystem::ProcessDeferredDestroy(double InTimeBudget)
+{
+	SCOPE_CYCLE_COUNTER(STAT_DeferredDestroy);
+	auto StartTime = FPlatformTime::Seconds();
+	int32 ProcessedCount = 0;
+	for (; ProcessedCount < DeferredDestroyQueue.Num(); ProcessedCount++)
+	{
+		auto& Item = DeferredDestroyQueue[ProcessedCount];
+		if (auto Actor = Item.Actor.Get())
+		{
+			if (!Actor->IsActorBeingDestroyed())
+			{
+				//unregister and destroy in separate steps, so an actor with heavy components can spread to two frames
+				if (!Item.bComponentsUnregistered)
+				{
+					Item.bComponentsUnregistered = true;
+					Actor->UnregisterAllComponents();
+					if (InTimeBudget >= 0 && FPlatformTime::Seconds() - StartTime > InTimeBudget)break;
+				}
+				Actor->Destroy();
+			}
+		}
+		if (InTimeBudget >= 0 && FPlatformTime::Seconds() - StartTime > InTimeBudget)
+		{
+			ProcessedCount++;
+			break;
+		}
+	}
+	DeferredDestroyQueue.RemoveAt(0, ProcessedCount);
+}
+void ULPrefabWorldSubsystem::OnPreGarbageCollect()
+{
+	//dissolve changed instance, then cluster root is not referenced and will be collected
+	for (int i = InstanceClusters.Num() - 1; i >= 0; i--)
+	{
+		auto& Item = InstanceClusters[i];
+		if (Item == nullptr || !Item->IsInstanceUnchanged())
+		{
+			if (Item != nullptr)
+			{
+				Item->DissolveInstanceCluster();
+			}
+			InstanceClusters.RemoveAtSwap(i);
+		}
+	}
+}
+void ULPrefabWorldSubsystem::CreateInstanceCluster(const TArray<AActor*>& InActors)
+{
+	if (GIsEditor || !FPlatformProperties::RequiresCookedData())return;//same as level cluster, only for cooked game
+	if (InActors.Num() == 0 || !IsValid(InActors[0]))return;
+	auto ClusterRoot = NewObject<ULPrefabInstanceCluster>(InActors[0]->GetLevel());//same outer (package) as actors
+	if (ClusterRoot->CreateInstanceCluster(InActors))
+	{
+		InstanceClusters.Add(ClusterRoot);
+	}
+}
+void ULPrefabWorldSubsystem::DissolveInstanceClusterOfActor(AActor* InActor)
+{
+	for (int i = InstanceClusters.Num() - 1; i >= 0; i--)
+	{
+		auto& Item = InstanceClusters[i];
+		if (Item != nullptr && Item->ContainsActor(InActor))
+		{
+			Item->DissolveInstanceCluster();
+			InstanceClusters.RemoveAt(i);
+		}
+	}
+}
+void ULPrefabWorldSubsystem::AddPrefabWithSharedSequence(ULPrefab* InPrefab)
+{
+	PrefabsWithSharedSequence.AddUnique(InPrefab);
+}
 void ULPrefabWorldSubsystem::BeginPrefabSystemProcessingActor(const FGuid& InSessionId)
 {
 	OnBeginDeserializeSession.Broadcast(InSessionId);
@@ -381,6 +542,421 @@ bool ULPrefabWorldSubsystem::IsPrefabSystemProcessingActor(AActor* InActor)
 {
 	return AllActors_PrefabSystemProcessing.Contains(InActor);
 }
+
+int32 ULPrefabWorldSubsystem::HierarchyIndexCount = 0;
+void ULPrefabWorldSubsystem::EnableHierarchyIndex(AActor* InRootActor)
+{
+	if (auto ExistingIndexPtr = MapActorToHierarchyIndex.Find(InRootActor))
+	{
+		if ((*ExistingIndexPtr)->GetRootActor() == InRootActor)return;//already enabled
+		//actor is inside other index, it's own index will take it
+		(*ExistingIndexPtr)->SetDirty();
+	}
+	auto Index = MakeShared<FLPrefabHierarchyIndex>(InRootActor);
+	HierarchyIndices.Add(Index);
+	HierarchyIndexCount++;
+	RebuildHierarchyIndex(Index.Get());
+}
+void ULPrefabWorldSubsystem::DisableHierarchyIndex(AActor* InRootActor)
+{
+	for (auto& Index : HierarchyIndices)
+	{
+		if (Index->GetRootActor() == InRootActor)
+		{
+			RemoveHierarchyIndex(Index.Get());
+			return;
+		}
+	}
+}
+void ULPrefabWorldSubsystem::MarkHierarchyIndexDirty(AActor* InActor)
+{
+	MarkSequencePlayerPrimitivesDirty(InActor);
+	if (!MapActorToHierarchyIndex.Contains(InActor))return;
+	//map only store the nested one, outer index also contains the actor
+	for (auto& Index : HierarchyIndices)
+	{
+		if (Index->GetMapActorToNode().Contains(InActor))
+		{
+			Index->SetDirty();
+		}
+	}
+}
+FLPrefabHierarchyIndex* ULPrefabWorldSubsystem::FindHierarchyIndex(AActor* InActor)
+{
+	auto IndexPtr = MapActorToHierarchyIndex.Find(InActor);
+	if (IndexPtr == nullptr)return nullptr;
+	auto Index = *IndexPtr;
+	if (Index->IsDirty())
+	{
+		if (Index->GetRootActor() == nullptr)
+		{
+			RemoveHierarchyIndex(Index);
+			return nullptr;
+		}
+		RebuildHierarchyIndex(Index);
+		//actor could be detached from this hierarchy
+		IndexPtr = MapActorToHierarchyIndex.Find(InActor);
+		if (IndexPtr == nullptr || *IndexPtr != Index)return nullptr;
+	}
+	return Index;
+}
+void ULPrefabWorldSubsystem::RebuildHierarchyIndex(FLPrefabHierarchyIndex* InIndex)
+{
+	for (auto& KeyValue : InIndex->GetMapActorToNode())
+	{
+		if (auto IndexPtr = MapActorToHierarchyIndex.Find(KeyValue.Key))
+		{
+			if (*IndexPtr == InIndex)
+			{
+				MapActorToHierarchyIndex.Remove(KeyValue.Key);
+			}
+		}
+	}
+	InIndex->Rebuild();
+	for (auto& KeyValue : InIndex->GetMapActorToNode())
+	{
+		auto& IndexInMap = MapActorToHierarchyIndex.FindOrAdd(KeyValue.Key);
+		//nested index take priority, so query inside it will not need to rebuild parent index
+		if (IndexInMap == nullptr || IndexInMap->GetRootActor() == nullptr || IndexInMap->GetMapActorToNode().Num() > InIndex->GetMapActorToNode().Num())
+		{
+			IndexInMap = InIndex;
+		}
+	}
+}
+void ULPrefabWorldSubsystem::RemoveHierarchyIndex(FLPrefabHierarchyIndex* InIndex)
+{
+	for (auto& KeyValue : InIndex->GetMapActorToNode())
+	{
+		if (auto IndexPtr = MapActorToHierarchyIndex.Find(KeyValue.Key))
+		{
+			if (*IndexPtr == InIndex)
+			{
+				MapActorToHierarchyIndex.Remove(KeyValue.Key);
+			}
+		}
+	}
+	//actors could also be inside other index (nested), map them back
+	for (auto& OtherIndex : HierarchyIndices)
+	{
+		if (OtherIndex.Get() == InIndex)continue;
+		for (auto& KeyValue : InIndex->GetMapActorToNode())
+		{
+			if (!MapActorToHierarchyIndex.Contains(KeyValue.Key) && OtherIndex->GetMapActorToNode().Contains(KeyValue.Key))
+			{
+				MapActorToHierarchyIndex.Add(KeyValue.Key, OtherIndex.Get());
+			}
+		}
+	}
+	const int32 RemovedCount = HierarchyIndices.RemoveAll([InIndex](const TSharedPtr<FLPrefabHierarchyIndex>& Item) { return Item.Get() == InIndex; });
+	HierarchyIndexCount -= RemovedCount;
+}
+void ULPrefabWorldSubsystem::OnActorDestroyed(AActor* InActor)
+{
+	UnregisterPrefabInstance(InActor);
+	if (HierarchyIndices.Num() == 0)return;
+	if (auto IndexPtr = MapActorToHierarchyIndex.Find(InActor))
+	{
+		auto Index = *IndexPtr;
+		if (Index->GetRootActor() == InActor)
+		{
+			RemoveHierarchyIndex(Index);
+		}
+		else
+		{
+			MarkHierarchyIndexDirty(InActor);
+			//actor's pointer could be reused, so remove it now
+			MapActorToHierarchyIndex.Remove(InActor);
+		}
+	}
+}
+void ULPrefabWorldSubsystem::OnPostGarbageCollect()
+{
+	//actor could be collected without destroy, eg. level unload
+	if (MapRootActorToPrefabInstance.Num() > 0)
+	{
+		bPrefabInstanceNeedCleanup = true;
+	}
+}
+void ULPrefabWorldSubsystem::RegisterPrefabInstance(ULPrefab* InPrefab, AActor* InRootActor)
+{
+	if (InPrefab == nullptr || InRootActor == nullptr)return;
+	auto PrefabKey = FObjectKey(InPrefab);
+	if (auto ExistingPtr = MapRootActorToPrefabInstance.Find(InRootActor))
+	{
+		if (ExistingPtr->Key == PrefabKey)return;//eg. ApplyPrefabToInstance load to the same actor
+		UnregisterPrefabInstance(InRootActor);
+	}
+	auto& InstanceList = MapPrefabToInstances.FindOrAdd(PrefabKey);
+	InstanceList.Prefab = InPrefab;
+	auto Index = InstanceList.RootActors.Add(InRootActor);
+	InstanceList.LiveCount++;
+	MapRootActorToPrefabInstance.Add(InRootActor, TPair<FObjectKey, int32>(PrefabKey, Index));
+}
+void ULPrefabWorldSubsystem::UnregisterPrefabInstance(AActor* InRootActor)
+{
+	if (auto EntryPtr = MapRootActorToPrefabInstance.Find(InRootActor))
+	{
+		if (auto InstanceListPtr = MapPrefabToInstances.Find(EntryPtr->Key))
+		{
+			if (InstanceListPtr->RootActors.IsValidIndex(EntryPtr->Value))
+			{
+				InstanceListPtr->RootActors[EntryPtr->Value].Reset();
+				InstanceListPtr->LiveCount--;
+			}
+		}
+		MapRootActorToPrefabInstance.Remove(InRootActor);
+		bPrefabInstanceNeedCleanup = true;
+	}
+}
+void ULPrefabWorldSubsystem::CleanupPrefabInstances()
+{
+	bPrefabInstanceNeedCleanup = false;
+	//remove entry of actor that is collected without destroy
+	for (auto It = MapRootActorToPrefabInstance.CreateIterator(); It; ++It)
+	{
+		auto InstanceListPtr = MapPrefabToInstances.Find(It.Value().Key);
+		if (InstanceListPtr == nullptr
+			|| !InstanceListPtr->RootActors.IsValidIndex(It.Value().Value)
+			|| InstanceListPtr->RootActors[It.Value().Value].Get() != It.Key())
+		{
+			It.RemoveCurrent();
+		}
+	}
+	//compact arrays
+	for (auto It = MapPrefabToInstances.CreateIterator(); It; ++It)
+	{
+		auto& InstanceList = It.Value();
+		int32 WriteIndex = 0;
+		for (int32 ReadIndex = 0; ReadIndex < InstanceList.RootActors.Num(); ReadIndex++)
+		{
+			auto Actor = InstanceList.RootActors[ReadIndex].Get();
+			if (Actor == nullptr)continue;
+			if (WriteIndex != ReadIndex)
+			{
+				InstanceList.RootActors[WriteIndex] = InstanceList.RootActors[ReadIndex];
+				if (auto EntryPtr = MapRootActorToPrefabInstance.Find(Actor))
+				{
+					EntryPtr->Value = WriteIndex;
+				}
+			}
+			WriteIndex++;
+		}
+		InstanceList.RootActors.SetNum(WriteIndex, false);
+		InstanceList.LiveCount = WriteIndex;
+		if (WriteIndex == 0)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+int32 ULPrefabWorldSubsystem::GetPrefabInstanceCount(ULPrefab* InPrefab)const
+{
+	if (auto InstanceListPtr = MapPrefabToInstances.Find(FObjectKey(InPrefab)))
+	{
+		return InstanceListPtr->LiveCount;
+	}
+	return 0;
+}
+void ULPrefabWorldSubsystem::ForEachPrefabInstance(ULPrefab* InPrefab, TFunctionRef<void(AActor*)> InFunction)const
+{
+	if (auto InstanceListPtr = MapPrefabToInstances.Find(FObjectKey(InPrefab)))
+	{
+		for (auto& Item : InstanceListPtr->RootActors)
+		{
+			auto Actor = Item.Get();
+			if (IsValid(Actor))
+			{
+				InFunction(Actor);
+			}
+		}
+	}
+}
+ULPrefab* ULPrefabWorldSubsystem::GetPrefabOfInstance(AActor* InRootActor)const
+{
+	if (auto EntryPtr = MapRootActorToPrefabInstance.Find(InRootActor))
+	{
+		if (auto InstanceListPtr = MapPrefabToInstances.Find(EntryPtr->Key))
+		{
+			return InstanceListPtr->Prefab.Get();
+		}
+	}
+	return nullptr;
+}
+TArray<AActor*> ULPrefabWorldSubsystem::GetPrefabInstances(UObject* WorldContextObject, ULPrefab* InPrefab)
+{
+	TArray<AActor*> Result;
+	auto World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	if (World == nullptr)return Result;
+	if (auto PrefabManager = ULPrefabWorldSubsystem::GetInstance(World))
+	{
+		Result.Reserve(PrefabManager->GetPrefabInstanceCount(InPrefab));
+		PrefabManager->ForEachPrefabInstance(InPrefab, [&Result](AActor* Actor) {
+			Result.Add(Actor);
+			});
+	}
+	return Result;
+}
+int32 ULPrefabWorldSubsystem::GetPrefabInstanceNum(UObject* WorldContextObject, ULPrefab* InPrefab)
+{
+	auto World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+	if (World == nullptr)return 0;
+	if (auto PrefabManager = ULPrefabWorldSubsystem::GetInstance(World))
+	{
+		return PrefabManager->GetPrefabInstanceCount(InPrefab);
+	}
+	return 0;
+}
+
+/** Playback context of sequence player, the actor that own sequence component. */
+static AActor* LPrefab_GetSequencePlayerContextActor(ULPrefabSequencePlayer* InPlayer)
+{
+	return InPlayer != nullptr ? InPlayer->GetTypedOuter<AActor>() : nullptr;
+}
+bool ULPrefabWorldSubsystem::ShouldUpdateSequencePlayer(ULPrefabSequencePlayer* InPlayer, float InDeltaSeconds, float& OutDeltaSeconds)
+{
+	OutDeltaSeconds = InDeltaSeconds;
+	if (SequencePlayerScheduleFrame != GFrameCounter)//first player tick in this frame
+	{
+		SequencePlayerScheduleFrame = GFrameCounter;
+		ScheduleSequencePlayers();
+	}
+	const double Now = GetWorld()->GetRealTimeSeconds();
+	auto& Item = ScheduledSequencePlayers.FindOrAdd(FObjectKey(InPlayer));
+	if (Item.Player.Get() != InPlayer)//new player, or old one with same key is destroyed
+	{
+		Item = FScheduledSequencePlayer();
+		Item.Player = InPlayer;
+		CollectSequencePlayerPrimitives(Item);
+		Item.LastUpdateTime = Now;
+		Item.LastTickFrame = GFrameCounter;
+		return true;
+	}
+	Item.LastTickFrame = GFrameCounter;
+	if (!InPlayer->IsPlaying())//nothing to skip, and time should not accumulate when paused or stopped
+	{
+		Item.PendingDeltaSeconds = 0;
+		Item.LastUpdateTime = Now;
+		return true;
+	}
+	if (!Item.bUpdateThisFrame)
+	{
+		Item.PendingDeltaSeconds += InDeltaSeconds;
+		INC_DWORD_STAT(STAT_SkippedSequencePlayerUpdates);
+		return false;
+	}
+	OutDeltaSeconds = Item.PendingDeltaSeconds + InDeltaSeconds;
+	Item.PendingDeltaSeconds = 0;
+	Item.LastUpdateTime = Now;
+	Item.bUpdateThisFrame = false;
+	return true;
+}
+
+void ULPrefabWorldSubsystem::ScheduleSequencePlayers()
+{
+	SCOPE_CYCLE_COUNTER(STAT_ScheduleSequencePlayers);
+	const double Now = GetWorld()->GetRealTimeSeconds();
+	const float OffscreenInterval = ULPrefabSettings::GetOffscreenSequencePlayerUpdateInterval();
+	struct FCandidate
+	{
+		FScheduledSequencePlayer* Item;
+		bool bRecentlyRendered;
+		double WaitTime;
+	};
+	TArray<FCandidate> Candidates;
+	Candidates.Reserve(ScheduledSequencePlayers.Num());
+	for (auto It = ScheduledSequencePlayers.CreateIterator(); It; ++It)
+	{
+		auto& Item = It.Value();
+		Item.bUpdateThisFrame = false;
+		if (!Item.Player.IsValid())
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+		if (SequencePlayerHierarchyChangedActors.Num() > 0 && SequencePlayerHierarchyChangedActors.Contains(FObjectKey(LPrefab_GetSequencePlayerContextActor(Item.Player.Get()))))
+		{
+			Item.bPrimitivesDirty = true;
+		}
+		//player that not tick in last frame could be paused with world or not ticking for now, keep it (and it's pending time) but not take budget
+		if (Item.LastTickFrame + 1 < GFrameCounter)continue;
+		//paused or stopped player always update in ShouldUpdateSequencePlayer, should not take budget
+		if (!Item.Player->IsPlaying())continue;
+		const bool bRecentlyRendered = IsSequencePlayerRecentlyRendered(Item);
+		const double WaitTime = Now - Item.LastUpdateTime;
+		if (!bRecentlyRendered && WaitTime < OffscreenInterval)continue;
+		Candidates.Add({ &Item, bRecentlyRendered, WaitTime });
+	}
+	//recently rendered first, then the one that wait longest, so players that become visible catch up first
+	Candidates.Sort([](const FCandidate& A, const FCandidate& B) {
+		if (A.bRecentlyRendered != B.bRecentlyRendered)return A.bRecentlyRendered;
+		return A.WaitTime > B.WaitTime;
+		});
+	SequencePlayerHierarchyChangedActors.Reset();
+	const int32 Budget = ULPrefabSettings::GetSequencePlayerUpdateBudget();
+	const int32 UpdateCount = Budget > 0 ? FMath::Min(Budget, Candidates.Num()) : Candidates.Num();
+	for (int32 i = 0; i < UpdateCount; i++)
+	{
+		Candidates[i].Item->bUpdateThisFrame = true;
+	}
+}
+
+void ULPrefabWorldSubsystem::MarkSequencePlayerPrimitivesDirty(AActor* InActor)
+{
+	if (ScheduledSequencePlayers.Num() == 0)return;
+	//primitives are collected from context actor and it's attached actors, so the actor and all it's parents are affected
+	for (auto Actor = InActor; Actor != nullptr; Actor = Actor->GetAttachParentActor())
+	{
+		SequencePlayerHierarchyChangedActors.Add(FObjectKey(Actor));
+	}
+}
+
+bool ULPrefabWorldSubsystem::IsSequencePlayerRecentlyRendered(FScheduledSequencePlayer& InItem)const
+{
+	if (InItem.bPrimitivesDirty)
+	{
+		CollectSequencePlayerPrimitives(InItem);
+	}
+	if (InItem.Primitives.Num() == 0)return true;//could be rendered by other system, we can't tell
+	//same tolerance as AActor::WasRecentlyRendered
+	const float Tolerance = 0.2f;
+	const double WorldTime = GetWorld()->GetTimeSeconds();
+	bool bAnyValid = false;
+	for (auto& Primitive : InItem.Primitives)
+	{
+		if (auto PrimitivePtr = Primitive.Get())
+		{
+			bAnyValid = true;
+			if (WorldTime - PrimitivePtr->GetLastRenderTimeOnScreen() <= Tolerance)
+			{
+				return true;
+			}
+		}
+	}
+	if (!bAnyValid)//primitives are destroyed, collect again
+	{
+		CollectSequencePlayerPrimitives(InItem);
+		return InItem.Primitives.Num() == 0;
+	}
+	return false;
+}
+
+void ULPrefabWorldSubsystem::CollectSequencePlayerPrimitives(FScheduledSequencePlayer& InOutItem)const
+{
+	auto& OutPrimitives = InOutItem.Primitives;
+	OutPrimitives.Reset();
+	InOutItem.bPrimitivesDirty = false;
+	auto ContextActor = LPrefab_GetSequencePlayerContextActor(InOutItem.Player.Get());
+	if (ContextActor == nullptr)return;
+	TArray<AActor*> Actors;
+	ContextActor->GetAttachedActors(Actors, true, true);
+	Actors.Add(ContextActor);
+	for (auto& Actor : Actors)
+	{
+		Actor->ForEachComponent<UPrimitiveComponent>(false, [&OutPrimitives](UPrimitiveComponent* Primitive) {
+			OutPrimitives.Add(Primitive);
+			});
+	}
+}
 #if LEXPREFAB_CAN_DISABLE_OPTIMIZATION
 PRAGMA_ENABLE_OPTIMIZATION
 #endif
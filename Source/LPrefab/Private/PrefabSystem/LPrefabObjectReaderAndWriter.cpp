@@ -8,6 +8,12 @@
 #include "Engine/Blueprint.h"
 #include "GameFramework/Actor.h"
 #include "LPrefabModule.h"
+#include "UObject/ObjectKey.h"
+#if WITH_EDITOR
+#include "PrefabSystem/LPrefabManager.h"
+#endif
+
+DECLARE_CYCLE_STAT(TEXT("Serialize Object Properties"), STAT_SerializeObjectProperties, STATGROUP_LexPrefab);
 
 namespace LPrefabSystem
 {
@@ -19,11 +25,167 @@ namespace LPrefabSystem
 			|| InProperty->IsA<FDelegateProperty>()
 			;
 	}
+	bool LPrefab_ShouldSkipPropertyForDuplicate(const FProperty* InProperty)
+	{
+		return
+			InProperty->HasAnyPropertyFlags(CPF_Transient | CPF_DuplicateTransient | CPF_NonPIEDuplicateTransient | CPF_DisableEditOnInstance | CPF_Deprecated | CPF_SkipSerialization)
+			|| InProperty->IsA<FMulticastDelegateProperty>()
+			|| InProperty->IsA<FDelegateProperty>()
+			;
+	}
+
+	struct FLPrefabSkipPropertyCacheData
+	{
+		/** id = index + 1 */
+		TArray<TSet<FName>> SkipNameSets;
+		/** Order-independent hash of name set to id, so GetSkipNameSetId only compare with sets of the same hash. Different sets may have same hash, so still compare content. */
+		TMultiMap<uint32, int32> MapHashToSkipNameSetId;
+		TMap<TPair<FObjectKey, int32>, TSet<const FProperty*>> MapStructToSkipProperties;
+		bool bFlushDelegateRegistered = false;
+
+		static FLPrefabSkipPropertyCacheData& Get()
+		{
+			static FLPrefabSkipPropertyCacheData Instance;
+			return Instance;
+		}
+		void CheckFlushDelegate()
+		{
+#if WITH_EDITOR
+			if (!bFlushDelegateRegistered)
+			{
+				bFlushDelegateRegistered = true;
+				ULPrefabManagerObject::GetInstance(true);//manager will flush this cache when blueprint compile
+			}
+#endif
+		}
+	};
+	int32 FLPrefabSkipPropertyCache::GetSkipNameSetId(const TSet<FName>& InSkipPropertyNames)
+	{
+		if (InSkipPropertyNames.Num() == 0)return 0;
+		auto& Data = FLPrefabSkipPropertyCacheData::Get();
+		//set is not ordered, so combine name hashes with an order-independent operation
+		uint32 Hash = InSkipPropertyNames.Num();
+		for (auto& Name : InSkipPropertyNames)
+		{
+			Hash += GetTypeHash(Name) * 0x9E3779B1u;
+		}
+		TArray<int32, TInlineAllocator<4>> Candidates;
+		Data.MapHashToSkipNameSetId.MultiFind(Hash, Candidates);
+		for (auto& Id : Candidates)
+		{
+			auto& Item = Data.SkipNameSets[Id - 1];
+			if (Item.Num() == InSkipPropertyNames.Num() && Item.Includes(InSkipPropertyNames))
+			{
+				return Id;
+			}
+		}
+		Data.SkipNameSets.Add(InSkipPropertyNames);
+		auto Id = Data.SkipNameSets.Num();
+		Data.MapHashToSkipNameSetId.Add(Hash, Id);
+		return Id;
+	}
+	const TSet<const FProperty*>* FLPrefabSkipPropertyCache::GetSkipMemberProperties(const UStruct* InStruct, int32 InSkipNameSetId)
+	{
+		if (InSkipNameSetId <= 0 || InStruct == nullptr)return nullptr;
+		auto& Data = FLPrefabSkipPropertyCacheData::Get();
+		auto Key = TPair<FObjectKey, int32>(FObjectKey(InStruct), InSkipNameSetId);
+		if (auto FoundPtr = Data.MapStructToSkipProperties.Find(Key))
+		{
+			return FoundPtr->Num() > 0 ? FoundPtr : nullptr;
+		}
+		Data.CheckFlushDelegate();
+		auto& SkipNames = Data.SkipNameSets[InSkipNameSetId - 1];
+		auto& Result = Data.MapStructToSkipProperties.Add(Key);
+		for (TFieldIterator<FProperty> PropertyItr(InStruct, EFieldIteratorFlags::IncludeSuper); PropertyItr; ++PropertyItr)
+		{
+			if (SkipNames.Contains(PropertyItr->GetFName()))
+			{
+				Result.Add(*PropertyItr);
+			}
+		}
+		return Result.Num() > 0 ? &Result : nullptr;
+	}
+	void FLPrefabSkipPropertyCache::Flush()
+	{
+		FLPrefabSkipPropertyCacheData::Get().MapStructToSkipProperties.Empty();
+	}
+
+	struct FLPrefabFunctionReferenceCacheData
+	{
+		TMap<TPair<FObjectKey, FName>, TWeakObjectPtr<UFunction>> MapClassAndNameToFunction;
+		/** Blueprint to all K2Nodes inside it, collected once for each blueprint */
+		TMap<FObjectKey, TMap<FName, TWeakObjectPtr<UObject>>> MapBlueprintToK2Nodes;
+		bool bFlushDelegateRegistered = false;
+
+		static FLPrefabFunctionReferenceCacheData& Get()
+		{
+			static FLPrefabFunctionReferenceCacheData Instance;
+			return Instance;
+		}
+		void CheckFlushDelegate()
+		{
+#if WITH_EDITOR
+			if (!bFlushDelegateRegistered)
+			{
+				bFlushDelegateRegistered = true;
+				ULPrefabManagerObject::GetInstance(true);//manager will flush this cache when blueprint compile
+			}
+#endif
+		}
+	};
+	UFunction* FLPrefabFunctionReferenceCache::FindFunction(UClass* InClass, const FName& InFunctionName)
+	{
+		if (InClass == nullptr)return nullptr;
+		auto& Data = FLPrefabFunctionReferenceCacheData::Get();
+		auto Key = TPair<FObjectKey, FName>(FObjectKey(InClass), InFunctionName);
+		if (auto FoundPtr = Data.MapClassAndNameToFunction.Find(Key))
+		{
+			if (auto Function = FoundPtr->Get())
+			{
+				return Function;
+			}
+		}
+		auto Function = InClass->FindFunctionByName(InFunctionName);
+		if (Function != nullptr)
+		{
+			Data.CheckFlushDelegate();
+			Data.MapClassAndNameToFunction.Add(Key, Function);
+		}
+		return Function;
+	}
+	UObject* FLPrefabFunctionReferenceCache::FindK2Node(UObject* InBlueprint, const FName& InNodeName)
+	{
+		if (InBlueprint == nullptr)return nullptr;
+		auto& Data = FLPrefabFunctionReferenceCacheData::Get();
+		auto NodesPtr = Data.MapBlueprintToK2Nodes.Find(FObjectKey(InBlueprint));
+		if (NodesPtr == nullptr)
+		{
+			Data.CheckFlushDelegate();
+			NodesPtr = &Data.MapBlueprintToK2Nodes.Add(FObjectKey(InBlueprint));
+			ForEachObjectWithOuter(InBlueprint, [NodesPtr](UObject* ItemObject) {
+				if (ItemObject->GetName().StartsWith(TEXT("K2Node_")))//K2Node is editor only, so we just check the name, same as writer
+				{
+					NodesPtr->Add(ItemObject->GetFName(), ItemObject);
+				}
+				});
+		}
+		if (auto FoundPtr = NodesPtr->Find(InNodeName))
+		{
+			return FoundPtr->Get();
+		}
+		return nullptr;
+	}
+	void FLPrefabFunctionReferenceCache::Flush()
+	{
+		auto& Data = FLPrefabFunctionReferenceCacheData::Get();
+		Data.MapClassAndNameToFunction.Empty();
+		Data.MapBlueprintToK2Nodes.Empty();
+	}
 
-	FLPrefabObjectWriter::FLPrefabObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames)
+	FLPrefabObjectWriter::FLPrefabObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames)
 		: FObjectWriter(Bytes)
 		, Serializer(InSerializer)
-		, SkipPropertyNames(InSkipPropertyNames)
+		, SkipNameSetId(FLPrefabSkipPropertyCache::GetSkipNameSetId(InSkipPropertyNames))
 	{
 		SetIsLoading(false);
 		SetIsSaving(true);
@@ -32,7 +194,10 @@ namespace LPrefabSystem
 	}
 	void FLPrefabObjectWriter::DoSerialize(UObject* Object)
 	{
+		SCOPE_CYCLE_COUNTER(STAT_SerializeObjectProperties);
+		SkipMemberProperties = FLPrefabSkipPropertyCache::GetSkipMemberProperties(Object->GetClass(), SkipNameSetId);
 		Object->Serialize(*this);
+		SkipMemberProperties = nullptr;
 	}
 	bool FLPrefabObjectWriter::ShouldSkipProperty(const FProperty* InProperty) const
 	{
@@ -40,9 +205,7 @@ namespace LPrefabSystem
 		{
 			return true;
 		}
-		if (SkipPropertyNames.Contains(InProperty->GetFName())
-			&& CurrentIsMemberProperty(*this)//Skip property only support UObject's member property
-			)
+		if (IsSkipMemberProperty(InProperty))//Skip property only support UObject's member property, and cached member properties are exactly what we need
 		{
 			return true;
 		}
@@ -221,10 +384,10 @@ namespace LPrefabSystem
 	}
 
 
-	FLPrefabObjectReader::FLPrefabObjectReader(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames)
+	FLPrefabObjectReader::FLPrefabObjectReader(const TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames)
 		: FObjectReader(Bytes)
 		, Serializer(InSerializer)
-		, SkipPropertyNames(InSkipPropertyNames)
+		, SkipNameSetId(FLPrefabSkipPropertyCache::GetSkipNameSetId(InSkipPropertyNames))
 	{
 		SetIsLoading(true);
 		SetIsSaving(false);
@@ -233,7 +396,10 @@ namespace LPrefabSystem
 	}
 	void FLPrefabObjectReader::DoSerialize(UObject* Object)
 	{
+		SCOPE_CYCLE_COUNTER(STAT_SerializeObjectProperties);
+		SkipMemberProperties = FLPrefabSkipPropertyCache::GetSkipMemberProperties(Object->GetClass(), SkipNameSetId);
 		Object->Serialize(*this);
+		SkipMemberProperties = nullptr;
 	}
 	bool FLPrefabObjectReader::ShouldSkipProperty(const FProperty* InProperty) const
 	{
@@ -241,9 +407,7 @@ namespace LPrefabSystem
 		{
 			return true;
 		}
-		if (SkipPropertyNames.Contains(InProperty->GetFName())
-			&& CurrentIsMemberProperty(*this)//Skip property only support UObject's member property
-			)
+		if (IsSkipMemberProperty(InProperty))//Skip property only support UObject's member property, and cached member properties are exactly what we need
 		{
 			return true;
 		}
@@ -292,7 +456,7 @@ namespace LPrefabSystem
 			*this << FunctionNameId;
 			auto OuterClass = Serializer.FindClassFromListByIndex(OuterClasstId);
 			auto FunctionName = Serializer.FindNameFromListByIndex(FunctionNameId);
-			Object = OuterClass->FindFunctionByName(FunctionName);
+			Object = FLPrefabFunctionReferenceCache::FindFunction(OuterClass, FunctionName);
 			return true;
 		}
 		break;
@@ -308,12 +472,7 @@ namespace LPrefabSystem
 				if (OuterObject != nullptr)
 				{
 					auto NodeName = Serializer.FindNameFromListByIndex(NodeNameId);
-					ForEachObjectWithOuter(OuterObject, [&NodeName, &Object](UObject* ItemObject) {
-						if (NodeName == ItemObject->GetFName())
-						{
-							Object = ItemObject;
-						}
-						});
+					Object = FLPrefabFunctionReferenceCache::FindK2Node(OuterObject, NodeName);
 					return true;
 				}
 			}
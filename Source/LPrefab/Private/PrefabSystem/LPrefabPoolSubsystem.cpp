@@ -0,0 +1,525 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabSystem/LPrefabPoolSubsystem.h"
+#include "PrefabSystem/LPrefab.h"
+#include "PrefabSystem/LPrefabSettings.h"
+#include "PrefabSystem/ILPrefabInterface.h"
+#include "PrefabSystem/ActorSerializer8.h"
+#include "LPrefabUtils.h"
+#include "PrefabSystem/LPrefabHierarchyIndex.h"
+#include "LPrefabModule.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "Components/SceneComponent.h"
+#include "Engine/AssetManager.h"
+#include "UObject/UObjectGlobals.h"
+
+DECLARE_CYCLE_STAT(TEXT("LPrefab AcquireInstance"), STAT_AcquirePrefabInstance, STATGROUP_LexPrefab);
+
+bool ULPrefabPoolSubsystem::FPooledInstance::IsValid()const
+{
+	if (!RootActor.IsValid() || !Snapshot.IsValid())return false;
+	for (auto& Actor : Actors)
+	{
+		if (!Actor.IsValid() || Actor->IsActorBeingDestroyed())return false;
+	}
+	return true;
+}
+
+bool ULPrefabPoolSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+void ULPrefabPoolSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	ActorDestroyedDelegateHandle = GetWorld()->AddOnActorDestroyedHandler(FOnActorDestroyed::FDelegate::CreateUObject(this, &ULPrefabPoolSubsystem::OnActorDestroyed));
+	PostGarbageCollectDelegateHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddUObject(this, &ULPrefabPoolSubsystem::OnPostGarbageCollect);
+}
+void ULPrefabPoolSubsystem::Deinitialize()
+{
+	GetWorld()->RemoveOnActorDestroyededHandler(ActorDestroyedDelegateHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(PostGarbageCollectDelegateHandle);
+	Pools.Empty();
+	ActiveInstances.Empty();
+	PrefabSnapshots.Empty();
+	MaxPoolSizeMap.Empty();
+	MinPoolSizeMap.Empty();
+	PrewarmTasks.Empty();
+	PrewarmPrefabs.Empty();
+	if (PrewarmLoadHandle.IsValid())
+	{
+		PrewarmLoadHandle->ReleaseHandle();
+		PrewarmLoadHandle.Reset();
+	}
+	Super::Deinitialize();
+}
+void ULPrefabPoolSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+	auto WorldPackageName = UWorld::RemovePIEPrefix(InWorld.GetOutermost()->GetName());
+	TArray<FSoftObjectPath> PrefabPaths;
+	for (auto& Item : ULPrefabSettings::GetPrefabPoolPrewarmList())
+	{
+		if (Item.Prefab.IsNull() || Item.Count <= 0)continue;
+		if (!Item.Map.IsNull() && Item.Map.GetLongPackageName() != WorldPackageName)continue;
+		FPrewarmTask Task;
+		Task.Prefab = Item.Prefab;
+		Task.RequestedCount = Item.Count;
+		Task.RemainCount = Item.Count;
+		PrewarmTasks.Add(Task);
+		PrewarmTotalCount += Item.Count;
+		PrefabPaths.AddUnique(Item.Prefab.ToSoftObjectPath());
+	}
+	if (PrefabPaths.Num() > 0)
+	{
+		PrewarmLoadHandle = UAssetManager::GetStreamableManager().RequestAsyncLoad(PrefabPaths, FStreamableDelegate(), FStreamableManager::AsyncLoadHighPriority);
+	}
+}
+TStatId ULPrefabPoolSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULPrefabPoolSubsystem, STATGROUP_LexPrefab);
+}
+ULPrefabPoolSubsystem* ULPrefabPoolSubsystem::GetInstance(UWorld* World)
+{
+	return World != nullptr ? World->GetSubsystem<ULPrefabPoolSubsystem>() : nullptr;
+}
+
+void ULPrefabPoolSubsystem::OnActorDestroyed(AActor* InActor)
+{
+	if (ActiveInstances.Num() == 0)return;
+	ActiveInstances.Remove(InActor);
+}
+void ULPrefabPoolSubsystem::OnPostGarbageCollect()
+{
+	if (ActiveInstances.Num() > 0)
+	{
+		bActiveInstancesNeedCleanup = true;
+	}
+}
+
+void ULPrefabPoolSubsystem::Tick(float DeltaTime)
+{
+	if (bActiveInstancesNeedCleanup)
+	{
+		bActiveInstancesNeedCleanup = false;
+		for (auto It = ActiveInstances.CreateIterator(); It; ++It)
+		{
+			if (It.Key().ResolveObjectPtr() == nullptr)
+			{
+				It.RemoveCurrent();
+			}
+		}
+	}
+	if (PrewarmTasks.Num() > 0)
+	{
+		ProcessPrewarm(ULPrefabSettings::GetPrefabPoolPrewarmTimeBudget() * 0.001);
+	}
+
+	auto IdleTimeToTrim = ULPrefabSettings::GetPrefabPoolIdleTimeToTrim();
+	if (IdleTimeToTrim <= 0)return;
+	auto CurrentTime = GetWorld()->GetTimeSeconds();
+	for (auto It = Pools.CreateIterator(); It; ++It)
+	{
+		auto& Pool = It.Value();
+		//oldest released instance is at index 0, only destroy one per frame to spread the cost
+		if (Pool.Num() > GetMinPoolSize(It.Key().ResolveObjectPtr()) && CurrentTime - Pool[0].ReleaseTime > IdleTimeToTrim)
+		{
+			DestroyInstance(Pool[0]);
+			Pool.RemoveAt(0);
+		}
+		if (Pool.Num() == 0)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+AActor* ULPrefabPoolSubsystem::AcquireInstance(ULPrefab* InPrefab, USceneComponent* InParent, FVector Location, FRotator Rotation, FVector Scale)
+{
+	return AcquireInstance(InPrefab, InParent, Location, Rotation.Quaternion(), Scale);
+}
+AActor* ULPrefabPoolSubsystem::AcquireInstance(ULPrefab* InPrefab, USceneComponent* InParent, const FVector& Location, const FQuat& Rotation, const FVector& Scale)
+{
+	if (!IsValid(InPrefab))
+	{
+		UE_LOG(LPrefab, Error, TEXT("[%s].%d InPrefab is null!"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__);
+		return nullptr;
+	}
+	SCOPE_CYCLE_COUNTER(STAT_AcquirePrefabInstance);
+	auto StartTime = FDateTime::Now();
+
+	if (auto PoolPtr = Pools.Find(InPrefab))
+	{
+		while (PoolPtr->Num() > 0)
+		{
+			auto Instance = PoolPtr->Pop(false);
+			if (!Instance.IsValid())
+			{
+				DestroyInstance(Instance);
+				continue;
+			}
+			//activate before restore, so property values in snapshot are not overridden by states
+			ActivateInstance(Instance);
+			if (!LPrefabSystem8::ActorSerializer::RestoreActorWithPreparedData(*Instance.Snapshot))
+			{
+				DestroyInstance(Instance);
+				continue;
+			}
+			auto RootActor = Instance.RootActor.Get();
+			if (auto RootComp = RootActor->GetRootComponent())
+			{
+				if (InParent != nullptr)
+				{
+					RootComp->AttachToComponent(InParent, FAttachmentTransformRules::KeepRelativeTransform);
+					FLPrefabHierarchyIndex::MarkDirty(InParent->GetOwner());
+				}
+				RootComp->SetRelativeLocationAndRotation(Location, Rotation);
+				RootComp->SetRelativeScale3D(Scale);
+			}
+			BroadcastPoolEvent(Instance, true);
+			ActiveInstances.Add(RootActor, MoveTemp(Instance));
+			if (ULPrefabSettings::GetLogPrefabLoadTime())
+			{
+				auto TimeSpan = FDateTime::Now() - StartTime;
+				UE_LOG(LPrefab, Log, TEXT("Acquire prefab from pool: '%s', total time: %fms"), *InPrefab->GetName(), TimeSpan.GetTotalMilliseconds());
+			}
+			return RootActor;
+		}
+	}
+
+	FPooledInstance Instance;
+	auto RootActor = LoadNewInstance(InPrefab, InParent, Location, Rotation, Scale, Instance);
+	if (RootActor != nullptr && Instance.Snapshot.IsValid())
+	{
+		ActiveInstances.Add(RootActor, MoveTemp(Instance));
+	}
+	return RootActor;
+}
+AActor* ULPrefabPoolSubsystem::LoadNewInstance(ULPrefab* InPrefab, USceneComponent* InParent, const FVector& Location, const FQuat& Rotation, const FVector& Scale, FPooledInstance& OutInstance)
+{
+	auto& Instance = OutInstance;
+	Instance.Prefab = InPrefab;
+	auto RootActor = InPrefab->LoadPrefabWithTransform(GetWorld(), InParent, Location, Rotation, Scale, [this, InPrefab, &Instance](AActor* LoadedRootActor) {
+		//take snapshot before Awake, so properties changed in Awake and gameplay can be reverted
+		auto Snapshot = MakeShared<LPrefabSystem8::FDuplicateActorDataContainer>();
+		auto SharedSnapshotPtr = PrefabSnapshots.Find(InPrefab);
+		if (SharedSnapshotPtr != nullptr && SharedSnapshotPtr->IsValid()
+			&& LPrefabSystem8::ActorSerializer::PrepareDataForRestore(LoadedRootActor, SharedSnapshotPtr->ToSharedRef(), *Snapshot))
+		{
+			Instance.Snapshot = Snapshot;
+		}
+		else if (LPrefabSystem8::ActorSerializer::PrepareDataForRestore(LoadedRootActor, *Snapshot))
+		{
+			Instance.Snapshot = Snapshot;
+			if (SharedSnapshotPtr == nullptr)
+			{
+				PrefabSnapshots.Add(InPrefab, Snapshot->Template);
+			}
+		}
+		TArray<AActor*> AllActors;
+		LPrefabUtils::CollectChildrenActors(LoadedRootActor, AllActors);
+		Instance.Actors.Reserve(AllActors.Num());
+		Instance.ActorCollisionEnabled.Reserve(AllActors.Num());
+		Instance.ActorHiddenInGame.Reserve(AllActors.Num());
+		for (auto& Actor : AllActors)
+		{
+			Instance.Actors.Add(Actor);
+			Instance.ActorCollisionEnabled.Add(Actor->GetActorEnableCollision());
+			Instance.ActorHiddenInGame.Add(Actor->IsHidden());
+		}
+		});
+	if (RootActor != nullptr)
+	{
+		Instance.RootActor = RootActor;
+		if (!Instance.Snapshot.IsValid())
+		{
+			UE_LOG(LPrefab, Warning, TEXT("[%s].%d Prepare data for prefab: '%s' fail, this instance will not be pooled."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *InPrefab->GetName());
+		}
+		//tick states after BeginPlay
+		Instance.ActorTickEnabled.Init(false, Instance.Actors.Num());
+		for (int i = 0; i < Instance.Actors.Num(); i++)
+		{
+			auto Actor = Instance.Actors[i].Get();
+			if (Actor == nullptr)continue;
+			Instance.ActorTickEnabled[i] = Actor->IsActorTickEnabled();
+			for (auto& Comp : Actor->GetComponents())
+			{
+				Instance.ComponentTickEnabled.Add(Comp, Comp->IsComponentTickEnabled());
+			}
+		}
+	}
+	return RootActor;
+}
+
+void ULPrefabPoolSubsystem::ReleaseInstance(AActor* InRootActor)
+{
+	if (!IsValid(InRootActor))return;
+	FPooledInstance Instance;
+	if (!ActiveInstances.RemoveAndCopyValue(InRootActor, Instance)
+		|| !Instance.IsValid()
+		|| !Instance.Prefab.IsValid()
+		)
+	{
+		LPrefabUtils::DestroyActorWithHierarchy(InRootActor, true);
+		return;
+	}
+	auto Prefab = Instance.Prefab.Get();
+	auto& Pool = Pools.FindOrAdd(Prefab);
+	if (Pool.Num() >= GetMaxPoolSize(Prefab))
+	{
+		DestroyInstance(Instance);
+		return;
+	}
+	BroadcastPoolEvent(Instance, false);
+	if (!Instance.IsValid())//destroyed in OnReleaseToPool
+	{
+		DestroyInstance(Instance);
+		return;
+	}
+	DeactivateInstance(Instance);
+	if (auto RootComp = InRootActor->GetRootComponent())
+	{
+		if (RootComp->GetAttachParent() != nullptr)
+		{
+			FLPrefabHierarchyIndex::MarkDirty(InRootActor);//mark before detach, so index that contains the old parent is found
+			RootComp->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+		}
+	}
+	Instance.ReleaseTime = GetWorld()->GetTimeSeconds();
+	Pool.Add(MoveTemp(Instance));
+}
+
+void ULPrefabPoolSubsystem::SetMaxPoolSize(ULPrefab* InPrefab, int32 InMaxSize)
+{
+	if (InPrefab == nullptr)return;
+	MaxPoolSizeMap.Add(InPrefab, FMath::Max(InMaxSize, 0));
+	if (auto PoolPtr = Pools.Find(InPrefab))
+	{
+		auto MaxSize = GetMaxPoolSize(InPrefab);
+		while (PoolPtr->Num() > MaxSize)
+		{
+			DestroyInstance((*PoolPtr)[0]);
+			PoolPtr->RemoveAt(0);
+		}
+	}
+}
+int32 ULPrefabPoolSubsystem::GetMaxPoolSize(ULPrefab* InPrefab)const
+{
+	int32 Result = ULPrefabSettings::GetPrefabPoolDefaultMaxSize();
+	if (auto SizePtr = MaxPoolSizeMap.Find(InPrefab))
+	{
+		Result = *SizePtr;
+	}
+	return FMath::Max(Result, GetMinPoolSize(InPrefab));
+}
+int32 ULPrefabPoolSubsystem::GetMinPoolSize(ULPrefab* InPrefab)const
+{
+	if (auto SizePtr = MinPoolSizeMap.Find(InPrefab))
+	{
+		return *SizePtr;
+	}
+	return 0;
+}
+int32 ULPrefabPoolSubsystem::GetPooledCount(ULPrefab* InPrefab)const
+{
+	if (auto PoolPtr = Pools.Find(InPrefab))
+	{
+		return PoolPtr->Num();
+	}
+	return 0;
+}
+void ULPrefabPoolSubsystem::ClearPool(ULPrefab* InPrefab)
+{
+	if (InPrefab == nullptr)
+	{
+		for (auto& KeyValue : Pools)
+		{
+			for (auto& Instance : KeyValue.Value)
+			{
+				DestroyInstance(Instance);
+			}
+		}
+		Pools.Empty();
+		PrefabSnapshots.Empty();
+		MinPoolSizeMap.Empty();
+	}
+	else
+	{
+		PrefabSnapshots.Remove(InPrefab);
+		MinPoolSizeMap.Remove(InPrefab);
+		TArray<FPooledInstance> Pool;
+		if (Pools.RemoveAndCopyValue(InPrefab, Pool))
+		{
+			for (auto& Item : Pool)
+			{
+				DestroyInstance(Item);
+			}
+		}
+	}
+}
+
+void ULPrefabPoolSubsystem::PrewarmPrefab(ULPrefab* InPrefab, int32 InCount)
+{
+	if (!IsValid(InPrefab) || InCount <= 0)return;
+	FPrewarmTask Task;
+	Task.Prefab = InPrefab;
+	Task.RequestedCount = InCount;
+	Task.RemainCount = InCount;
+	PrewarmTasks.Add(Task);
+	PrewarmTotalCount += InCount;
+	PrewarmPrefabs.AddUnique(InPrefab);
+}
+void ULPrefabPoolSubsystem::FlushPrewarm()
+{
+	if (PrewarmTasks.Num() == 0)return;
+	if (PrewarmLoadHandle.IsValid())
+	{
+		PrewarmLoadHandle->WaitUntilComplete();
+	}
+	ProcessPrewarm(-1);
+}
+float ULPrefabPoolSubsystem::GetPrewarmProgress()const
+{
+	if (PrewarmTotalCount <= 0)return 1.0f;
+	return FMath::Clamp((float)PrewarmCreatedCount / PrewarmTotalCount, 0.0f, 1.0f);
+}
+void ULPrefabPoolSubsystem::ProcessPrewarm(double InTimeBudget)
+{
+	if (PrewarmLoadHandle.IsValid() && PrewarmLoadHandle->IsLoadingInProgress())return;
+
+	auto StartTime = FPlatformTime::Seconds();
+	while (PrewarmTasks.Num() > 0)
+	{
+		auto& Task = PrewarmTasks[0];
+		auto Prefab = Task.Prefab.Get();
+		if (Prefab == nullptr)
+		{
+			UE_LOG(LPrefab, Warning, TEXT("[%s].%d Prewarm prefab: '%s' is not loaded, skip it."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, *Task.Prefab.ToString());
+			PrewarmCreatedCount += Task.RemainCount;
+			PrewarmTasks.RemoveAt(0);
+			continue;
+		}
+		auto& MinPoolSize = MinPoolSizeMap.FindOrAdd(Prefab);
+		MinPoolSize = FMath::Max(MinPoolSize, Task.RequestedCount);
+		PrewarmInstance(Prefab);
+		PrewarmCreatedCount++;
+		if (--Task.RemainCount <= 0)
+		{
+			PrewarmTasks.RemoveAt(0);
+		}
+		if (InTimeBudget >= 0 && FPlatformTime::Seconds() - StartTime > InTimeBudget)break;
+	}
+	OnPrewarmProgress.Broadcast(GetPrewarmProgress());
+	if (PrewarmTasks.Num() == 0)
+	{
+		PrewarmTotalCount = 0;
+		PrewarmCreatedCount = 0;
+		PrewarmPrefabs.Empty();
+	}
+}
+void ULPrefabPoolSubsystem::PrewarmInstance(ULPrefab* InPrefab)
+{
+	if (GetPooledCount(InPrefab) >= GetMaxPoolSize(InPrefab))return;
+	FPooledInstance Instance;
+	auto RootActor = LoadNewInstance(InPrefab, nullptr, FVector::ZeroVector, FQuat::Identity, FVector::OneVector, Instance);
+	if (RootActor == nullptr)return;
+	if (!Instance.Snapshot.IsValid())
+	{
+		DestroyInstance(Instance);
+		return;
+	}
+	DeactivateInstance(Instance);
+	Instance.ReleaseTime = GetWorld()->GetTimeSeconds();
+	Pools.FindOrAdd(InPrefab).Add(MoveTemp(Instance));
+}
+
+void ULPrefabPoolSubsystem::DestroyInstance(FPooledInstance& InInstance)
+{
+	if (InInstance.RootActor.IsValid())
+	{
+		LPrefabUtils::DestroyActorWithHierarchy(InInstance.RootActor.Get(), true);
+	}
+	InInstance.Snapshot.Reset();
+}
+void ULPrefabPoolSubsystem::DeactivateInstance(FPooledInstance& InInstance)
+{
+	for (int i = 0; i < InInstance.Actors.Num(); i++)
+	{
+		auto Actor = InInstance.Actors[i].Get();
+		Actor->SetActorTickEnabled(false);
+		Actor->SetActorEnableCollision(false);
+		Actor->SetActorHiddenInGame(true);
+		for (auto& Comp : Actor->GetComponents())
+		{
+			Comp->SetComponentTickEnabled(false);
+		}
+	}
+}
+void ULPrefabPoolSubsystem::ActivateInstance(FPooledInstance& InInstance)
+{
+	//components that added after loaded are not in snapshot, destroy them so the instance is same as newly loaded
+	TArray<UActorComponent*> ComponentsToDestroy;
+	for (auto& ActorPtr : InInstance.Actors)
+	{
+		for (auto& Comp : ActorPtr->GetComponents())
+		{
+			if (!InInstance.ComponentTickEnabled.Contains(Comp))
+			{
+				ComponentsToDestroy.Add(Comp);
+			}
+		}
+	}
+	for (auto& Comp : ComponentsToDestroy)
+	{
+		Comp->DestroyComponent();
+	}
+	if (ComponentsToDestroy.Num() > 0)
+	{
+		FLPrefabHierarchyIndex::MarkDirty(InInstance.RootActor.Get());
+	}
+	//snapshot only write property values, so use setter to apply states that need to notify components
+	for (int i = 0; i < InInstance.Actors.Num(); i++)
+	{
+		auto Actor = InInstance.Actors[i].Get();
+		if (InInstance.ActorTickEnabled.IsValidIndex(i))
+		{
+			Actor->SetActorTickEnabled(InInstance.ActorTickEnabled[i]);
+		}
+		if (InInstance.ActorCollisionEnabled.IsValidIndex(i))
+		{
+			Actor->SetActorEnableCollision(InInstance.ActorCollisionEnabled[i]);
+		}
+		if (InInstance.ActorHiddenInGame.IsValidIndex(i))
+		{
+			Actor->SetActorHiddenInGame(InInstance.ActorHiddenInGame[i]);
+		}
+	}
+	for (auto& Item : InInstance.ComponentTickEnabled)
+	{
+		if (Item.Key.IsValid())
+		{
+			Item.Key->SetComponentTickEnabled(Item.Value);
+		}
+	}
+}
+void ULPrefabPoolSubsystem::BroadcastPoolEvent(FPooledInstance& InInstance, bool bAcquire)
+{
+	for (auto& ActorPtr : InInstance.Actors)
+	{
+		auto Actor = ActorPtr.Get();
+		if (Actor == nullptr)continue;
+		if (Actor->GetClass()->ImplementsInterface(ULPrefabInterface::StaticClass()))
+		{
+			bAcquire ? ILPrefabInterface::Execute_OnAcquireFromPool(Actor) : ILPrefabInterface::Execute_OnReleaseToPool(Actor);
+		}
+		auto Components = Actor->GetComponents();
+		for (auto& Comp : Components)
+		{
+			if (Comp->GetClass()->ImplementsInterface(ULPrefabInterface::StaticClass()))
+			{
+				bAcquire ? ILPrefabInterface::Execute_OnAcquireFromPool(Comp) : ILPrefabInterface::Execute_OnReleaseToPool(Comp);
+			}
+		}
+	}
+}
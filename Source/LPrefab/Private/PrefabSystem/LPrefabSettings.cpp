@@ -2,6 +2,7 @@
 
 #include "PrefabSystem/LPrefabSettings.h"
 #include "LPrefabModule.h"
+#include "PrefabSystem/LPrefabSharedReferenceTable.h"
 
 #if WITH_EDITOR
 void ULPrefabSettings::PostEditChangeProperty(struct FPropertyChangedEvent& PropertyChangedEvent)
@@ -39,3 +40,60 @@ bool ULPrefabSettings::GetLogPrefabLoadTime()
 {
 	return GetDefault<ULPrefabSettings>()->bLogPrefabLoadTime;
 }
+bool ULPrefabSettings::GetBatchComponentRegistration()
+{
+	return GetDefault<ULPrefabSettings>()->bBatchComponentRegistration;
+}
+bool ULPrefabSettings::GetCreateGCClusterForPrefabInstance()
+{
+	return GetDefault<ULPrefabSettings>()->bCreateGCClusterForPrefabInstance;
+}
+bool ULPrefabSettings::GetShareSequenceAcrossInstances()
+{
+	return GetDefault<ULPrefabSettings>()->bShareSequenceAcrossInstances;
+}
+bool ULPrefabSettings::GetBakeSimpleSequenceWhenCook()
+{
+	return GetDefault<ULPrefabSettings>()->bBakeSimpleSequenceWhenCook;
+}
+float ULPrefabSettings::GetDeferredDestroyTimeBudget()
+{
+	return GetDefault<ULPrefabSettings>()->DeferredDestroyTimeBudget;
+}
+int32 ULPrefabSettings::GetPrefabPoolDefaultMaxSize()
+{
+	return GetDefault<ULPrefabSettings>()->PrefabPoolDefaultMaxSize;
+}
+float ULPrefabSettings::GetPrefabPoolIdleTimeToTrim()
+{
+	return GetDefault<ULPrefabSettings>()->PrefabPoolIdleTimeToTrim;
+}
+const TArray<FLPrefabPoolPrewarmItem>& ULPrefabSettings::GetPrefabPoolPrewarmList()
+{
+	return GetDefault<ULPrefabSettings>()->PrefabPoolPrewarmList;
+}
+float ULPrefabSettings::GetPrefabPoolPrewarmTimeBudget()
+{
+	return GetDefault<ULPrefabSettings>()->PrefabPoolPrewarmTimeBudget;
+}
+bool ULPrefabSettings::GetScheduleSequencePlayerUpdate()
+{
+	return GetDefault<ULPrefabSettings>()->bScheduleSequencePlayerUpdate;
+}
+int32 ULPrefabSettings::GetSequencePlayerUpdateBudget()
+{
+	return GetDefault<ULPrefabSettings>()->SequencePlayerUpdateBudget;
+}
+float ULPrefabSettings::GetOffscreenSequencePlayerUpdateInterval()
+{
+	return GetDefault<ULPrefabSettings>()->OffscreenSequencePlayerUpdateInterval;
+}
+
+#if WITH_EDITOR
+ULPrefabSharedReferenceTable* ULPrefabSettings::GetSharedReferenceTableForCook()
+{
+	auto& TablePtr = GetDefault<ULPrefabSettings>()->SharedReferenceTable;
+	if (TablePtr.IsNull())return nullptr;
+	return TablePtr.LoadSynchronous();
+}
+#endif
@@ -0,0 +1,128 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "PrefabSystem/LPrefabSharedReferenceTable.h"
+#include "PrefabSystem/LPrefab.h"
+#include "LPrefabModule.h"
+#if WITH_EDITOR
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Misc/ScopedSlowTask.h"
+#endif
+
+#define LOCTEXT_NAMESPACE "LPrefabSharedReferenceTable"
+
+#if WITH_EDITOR
+void ULPrefabSharedReferenceTable::PostLoad()
+{
+	Super::PostLoad();
+	bLookupMapDirty = true;
+}
+
+void ULPrefabSharedReferenceTable::RebuildLookupMap()const
+{
+	if (!bLookupMapDirty)return;
+	bLookupMapDirty = false;
+	MapAssetToIndex.Reset();
+	MapClassToIndex.Reset();
+	MapNameToIndex.Reset();
+	for (int i = 0; i < AssetList.Num(); i++)
+	{
+		MapAssetToIndex.Add(AssetList[i], i);
+	}
+	for (int i = 0; i < ClassList.Num(); i++)
+	{
+		MapClassToIndex.Add(ClassList[i], i);
+	}
+	for (int i = 0; i < NameList.Num(); i++)
+	{
+		MapNameToIndex.Add(NameList[i], i);
+	}
+}
+
+int32 ULPrefabSharedReferenceTable::FindAsset(UObject* InAsset)const
+{
+	RebuildLookupMap();
+	auto IndexPtr = MapAssetToIndex.Find(InAsset);
+	return IndexPtr != nullptr ? *IndexPtr : INDEX_NONE;
+}
+int32 ULPrefabSharedReferenceTable::FindClass(UClass* InClass)const
+{
+	RebuildLookupMap();
+	auto IndexPtr = MapClassToIndex.Find(InClass);
+	return IndexPtr != nullptr ? *IndexPtr : INDEX_NONE;
+}
+int32 ULPrefabSharedReferenceTable::FindName(const FName& InName)const
+{
+	RebuildLookupMap();
+	auto IndexPtr = MapNameToIndex.Find(InName);
+	return IndexPtr != nullptr ? *IndexPtr : INDEX_NONE;
+}
+
+void ULPrefabSharedReferenceTable::RebuildFromAllPrefabs()
+{
+	auto& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>("AssetRegistry").Get();
+	TArray<FAssetData> PrefabAssetDataArray;
+	AssetRegistry.GetAssetsByClass(ULPrefab::StaticClass()->GetClassPathName(), PrefabAssetDataArray, true);
+
+	TMap<UObject*, int32> AssetCount;
+	TMap<UClass*, int32> ClassCount;
+	TMap<FName, int32> NameCount;
+	int32 PrefabCount = 0;
+	{
+		FScopedSlowTask SlowTask(PrefabAssetDataArray.Num(), LOCTEXT("CollectPrefabReference", "Collecting prefab references..."));
+		SlowTask.MakeDialog();
+		for (auto& AssetData : PrefabAssetDataArray)
+		{
+			SlowTask.EnterProgressFrame(1);
+			auto Prefab = Cast<ULPrefab>(AssetData.GetAsset());
+			if (Prefab == nullptr || Prefab->IsEditorOnly())continue;
+			PrefabCount++;
+			//each prefab only count once for an entry
+			for (auto& Item : TSet<TObjectPtr<UObject>>(Prefab->ReferenceAssetList))
+			{
+				if (Item == nullptr || Item->IsA<ULPrefab>())continue;//sub prefab is not shared, or all prefabs will be loaded with this table
+				AssetCount.FindOrAdd(Item)++;
+			}
+			for (auto& Item : TSet<TObjectPtr<UClass>>(Prefab->ReferenceClassList))
+			{
+				if (Item == nullptr)continue;
+				if (!bIncludeBlueprintClass && Item->HasAnyClassFlags(CLASS_CompiledFromBlueprint))continue;
+				ClassCount.FindOrAdd(Item)++;
+			}
+			for (auto& Item : TSet<FName>(Prefab->ReferenceNameList))
+			{
+				if (Item.IsNone())continue;
+				NameCount.FindOrAdd(Item)++;
+			}
+		}
+	}
+
+	RebuildLookupMap();
+	int32 AddedCount = 0;
+	//append only, existing entries must keep index because cooked prefab use it
+	auto AppendEntries = [this, &AddedCount]<typename T, typename TList>(TMap<T, int32>& CountMap, TList& List, TMap<T, int32>& LookupMap) {
+		CountMap.ValueSort([](const int32& A, const int32& B) { return A > B; });
+		for (auto& KeyValue : CountMap)
+		{
+			if (KeyValue.Value < MinReferencedPrefabCount)break;
+			if (LookupMap.Contains(KeyValue.Key))continue;
+			LookupMap.Add(KeyValue.Key, List.Add(KeyValue.Key));
+			AddedCount++;
+		}
+	};
+	if (bIncludeAsset)
+	{
+		AppendEntries(AssetCount, AssetList, MapAssetToIndex);
+	}
+	AppendEntries(ClassCount, ClassList, MapClassToIndex);
+	AppendEntries(NameCount, NameList, MapNameToIndex);
+
+	UE_LOG(LPrefab, Log, TEXT("[%s].%d Collected %d prefabs, added %d new entries. Table now has %d assets, %d classes, %d names."), ANSI_TO_TCHAR(__FUNCTION__), __LINE__
+		, PrefabCount, AddedCount, AssetList.Num(), ClassList.Num(), NameList.Num());
+	if (AddedCount > 0)
+	{
+		this->MarkPackageDirty();
+	}
+}
+#endif
+
+#undef LOCTEXT_NAMESPACE
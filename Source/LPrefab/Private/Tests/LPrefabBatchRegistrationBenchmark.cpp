@@ -0,0 +1,85 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "LPrefabTestWorld.h"
+#include "PrefabSystem/LPrefab.h"
+#include "PrefabSystem/LPrefabSettings.h"
+#include "LPrefabModule.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/CollisionProfile.h"
+#include "HAL/PlatformTime.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLPrefabBatchRegistrationBenchmark, "LPrefab.Performance.BatchComponentRegistration", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::PerfFilter)
+
+bool FLPrefabBatchRegistrationBenchmark::RunTest(const FString& Parameters)
+{
+	auto CubeMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (!TestNotNull(TEXT("Cube mesh"), CubeMesh))return false;
+
+	FLPrefabTestWorld TestWorld;
+	auto World = TestWorld.Get();
+	auto Settings = GetMutableDefault<ULPrefabSettings>();
+	const bool bPrevBatchComponentRegistration = Settings->bBatchComponentRegistration;
+
+	const int32 MeshCounts[] = { 100, 250, 500 };
+	const int32 LoadCount = 5;
+	for (auto MeshCount : MeshCounts)
+	{
+		//source hierarchy: one actor with many colliding meshes
+		auto SourceActor = World->SpawnActor<AActor>();
+		auto RootComp = NewObject<USceneComponent>(SourceActor, TEXT("Root"));
+		SourceActor->SetRootComponent(RootComp);
+		RootComp->RegisterComponent();
+		for (int32 i = 0; i < MeshCount; i++)
+		{
+			auto MeshComp = NewObject<UStaticMeshComponent>(SourceActor);
+			MeshComp->SetStaticMesh(CubeMesh);
+			MeshComp->SetCollisionProfileName(i % 2 == 0 ? UCollisionProfile::BlockAll_ProfileName : UCollisionProfile::BlockAllDynamic_ProfileName);
+			MeshComp->SetRelativeLocation(FVector((i % 32) * 120.0f, (i / 32) * 120.0f, 0));
+			MeshComp->SetupAttachment(RootComp);
+			MeshComp->RegisterComponent();
+		}
+		auto Prefab = ULPrefab::CreateTransientFromActor(SourceActor);
+		SourceActor->Destroy();
+		if (!TestNotNull(TEXT("Captured prefab"), Prefab))break;
+
+		double TimeCost[2] = { 0, 0 };
+		for (int32 Mode = 0; Mode < 2; Mode++)
+		{
+			Settings->bBatchComponentRegistration = Mode == 1;
+			//first load is warm-up
+			for (int32 LoadIndex = 0; LoadIndex <= LoadCount; LoadIndex++)
+			{
+				const double StartTime = FPlatformTime::Seconds();
+				auto LoadedActor = Prefab->LoadPrefab(World, nullptr);
+				const double Duration = FPlatformTime::Seconds() - StartTime;
+				if (!TestNotNull(TEXT("Loaded actor"), LoadedActor))break;
+				if (LoadIndex > 0)
+				{
+					TimeCost[Mode] += Duration;
+				}
+				int32 BodyCount = 0;
+				LoadedActor->ForEachComponent<UStaticMeshComponent>(false, [&BodyCount](UStaticMeshComponent* MeshComp) {
+					if (MeshComp->IsPhysicsStateCreated() && MeshComp->BodyInstance.IsValidBodyInstance())
+					{
+						BodyCount++;
+					}
+					});
+				TestEqual(FString::Printf(TEXT("Physics bodies of %d meshes, batch: %d"), MeshCount, Mode), BodyCount, MeshCount);
+				LoadedActor->Destroy();
+			}
+		}
+		const double NormalTime = TimeCost[0] * 1000 / LoadCount;
+		const double BatchTime = TimeCost[1] * 1000 / LoadCount;
+		AddInfo(FString::Printf(TEXT("%d colliding meshes, LoadPrefab average: %fms, with bBatchComponentRegistration: %fms"), MeshCount, NormalTime, BatchTime));
+		UE_LOG(LPrefab, Log, TEXT("[%s].%d %d colliding meshes, LoadPrefab average: %fms, with bBatchComponentRegistration: %fms"), ANSI_TO_TCHAR(__FUNCTION__), __LINE__, MeshCount, NormalTime, BatchTime);
+	}
+	Settings->bBatchComponentRegistration = bPrevBatchComponentRegistration;
+	return true;
+}
+
+#endif
@@ -0,0 +1,147 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "LPrefabTestWorld.h"
+#include "PrefabSystem/ActorSerializer8.h"
+#include "PrefabSystem/LPrefabObjectReaderAndWriter.h"
+#include "LPrefabUtils.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/CollisionProfile.h"
+#include "Serialization/ArchiveUObject.h"
+#include "HAL/PlatformTime.h"
+
+/** Replace object references inside one property value, so references in hierarchy of one copy can compare with another copy. */
+class FLPrefabTestRemapArchive : public FArchiveUObject
+{
+public:
+	FLPrefabTestRemapArchive(const TMap<UObject*, UObject*>& InReplaceMap) :ReplaceMap(InReplaceMap)
+	{
+		ArIsObjectReferenceCollector = true;
+		ArIsModifyingWeakAndStrongReferences = true;
+		ArIgnoreOuterRef = true;
+		ArIgnoreArchetypeRef = true;
+		ArIgnoreClassRef = true;
+	}
+	virtual FArchive& operator<<(UObject*& Obj) override
+	{
+		if (auto FoundPtr = Obj != nullptr ? ReplaceMap.Find(Obj) : nullptr)
+		{
+			Obj = *FoundPtr;
+		}
+		return *this;
+	}
+	virtual FString GetArchiveName() const override { return TEXT("FLPrefabTestRemapArchive"); }
+private:
+	const TMap<UObject*, UObject*>& ReplaceMap;
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLPrefabDuplicateActorDirectTest, "LPrefab.DuplicateActorDirect", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::EngineFilter)
+
+/** DuplicateActorDirect copy property values with its own code, so compare its result with DuplicateActor property by property. */
+bool FLPrefabDuplicateActorDirectTest::RunTest(const FString& Parameters)
+{
+	auto CubeMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (!TestNotNull(TEXT("Cube mesh"), CubeMesh))return false;
+
+	FLPrefabTestWorld TestWorld;
+	auto World = TestWorld.Get();
+	//source hierarchy: root actor with meshes, and a child actor attached to one of the meshes
+	auto SourceActor = World->SpawnActor<AActor>();
+	auto RootComp = NewObject<USceneComponent>(SourceActor, TEXT("Root"));
+	SourceActor->SetRootComponent(RootComp);
+	RootComp->RegisterComponent();
+	USceneComponent* AttachTarget = nullptr;
+	for (int32 i = 0; i < 4; i++)
+	{
+		auto MeshComp = NewObject<UStaticMeshComponent>(SourceActor, *FString::Printf(TEXT("Mesh%d"), i));
+		MeshComp->SetStaticMesh(CubeMesh);
+		MeshComp->SetCollisionProfileName(UCollisionProfile::BlockAllDynamic_ProfileName);
+		MeshComp->SetRelativeLocation(FVector(i * 120.0f, 0, 0));
+		MeshComp->SetupAttachment(RootComp);
+		MeshComp->RegisterComponent();
+		AttachTarget = MeshComp;
+	}
+	auto ChildActor = World->SpawnActor<AActor>();
+	auto ChildRootComp = NewObject<USceneComponent>(ChildActor, TEXT("Root"));
+	ChildActor->SetRootComponent(ChildRootComp);
+	ChildRootComp->RegisterComponent();
+	ChildRootComp->AttachToComponent(AttachTarget, FAttachmentTransformRules::KeepRelativeTransform);
+	ChildRootComp->SetRelativeLocation(FVector(0, 0, 200.0f));
+
+	const int32 Count = 10;
+	TArray<AActor*> SerializedCopies, DirectCopies;
+	auto Measure = [&](bool bDirect, TArray<AActor*>& OutCreated) {
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 i = 0; i < Count; i++)
+		{
+			OutCreated.Add(bDirect ? LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::DuplicateActorDirect(SourceActor, nullptr) : LPREFAB_SERIALIZER_NEWEST_NAMESPACE::ActorSerializer::DuplicateActor(SourceActor, nullptr));
+		}
+		return (FPlatformTime::Seconds() - StartTime) * 1000.0 / Count;
+	};
+	const double SerializeTime = Measure(false, SerializedCopies);
+	const double DirectTime = Measure(true, DirectCopies);
+	AddInfo(FString::Printf(TEXT("DuplicateActor: %fms, DuplicateActorDirect: %fms"), SerializeTime, DirectTime));
+
+	if (TestNotNull(TEXT("DuplicateActor result"), SerializedCopies[0]) && TestNotNull(TEXT("DuplicateActorDirect result"), DirectCopies[0]))
+	{
+		TArray<AActor*> SerializedActors, DirectActors;
+		LPrefabUtils::CollectChildrenActors(SerializedCopies[0], SerializedActors);
+		LPrefabUtils::CollectChildrenActors(DirectCopies[0], DirectActors);
+		TestEqual(TEXT("Actor count"), DirectActors.Num(), SerializedActors.Num());
+		//match objects by order of actor and name of component
+		TArray<TPair<UObject*, UObject*>> ObjectPairs;
+		TMap<UObject*, UObject*> MapSerializedToDirect;
+		for (int32 i = 0; i < FMath::Min(SerializedActors.Num(), DirectActors.Num()); i++)
+		{
+			ObjectPairs.Add(TPair<UObject*, UObject*>(SerializedActors[i], DirectActors[i]));
+			MapSerializedToDirect.Add(SerializedActors[i], DirectActors[i]);
+			for (auto& Comp : SerializedActors[i]->GetComponents())
+			{
+				auto DirectComp = FindObjectFast<UActorComponent>(DirectActors[i], Comp->GetFName());
+				if (!TestNotNull(FString::Printf(TEXT("Component '%s' in DuplicateActorDirect result"), *Comp->GetName()), DirectComp))continue;
+				ObjectPairs.Add(TPair<UObject*, UObject*>(Comp, DirectComp));
+				MapSerializedToDirect.Add(Comp, DirectComp);
+			}
+		}
+		for (auto& Pair : ObjectPairs)
+		{
+			for (TFieldIterator<FProperty> PropertyItr(Pair.Key->GetClass(), EFieldIteratorFlags::IncludeSuper); PropertyItr; ++PropertyItr)
+			{
+				auto Property = *PropertyItr;
+				if (LPrefabSystem::LPrefab_ShouldSkipPropertyForDuplicate(Property))continue;
+				for (int32 i = 0; i < Property->ArrayDim; i++)
+				{
+					//remap a copy of serialized value to direct result's hierarchy, then compare
+					void* TempValue = FMemory::Malloc(Property->GetSize(), Property->GetMinAlignment());
+					Property->InitializeValue(TempValue);
+					Property->CopySingleValue(TempValue, Property->ContainerPtrToValuePtr<void>(Pair.Key, i));
+					{
+						FLPrefabTestRemapArchive Remap(MapSerializedToDirect);
+						Property->SerializeItem(FStructuredArchiveFromArchive(Remap).GetSlot(), TempValue);
+					}
+					TestTrue(FString::Printf(TEXT("Property '%s' of '%s'"), *Property->GetName(), *Pair.Key->GetName())
+						, Property->Identical(TempValue, Property->ContainerPtrToValuePtr<void>(Pair.Value, i), PPF_None));
+					Property->DestroyValue(TempValue);
+					FMemory::Free(TempValue);
+				}
+			}
+		}
+	}
+
+	for (auto& Actor : SerializedCopies)
+	{
+		if (Actor != nullptr)LPrefabUtils::DestroyActorWithHierarchy(Actor, true);
+	}
+	for (auto& Actor : DirectCopies)
+	{
+		if (Actor != nullptr)LPrefabUtils::DestroyActorWithHierarchy(Actor, true);
+	}
+	LPrefabUtils::DestroyActorWithHierarchy(SourceActor, true);
+	return true;
+}
+
+#endif
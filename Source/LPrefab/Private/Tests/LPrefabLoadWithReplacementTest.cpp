@@ -0,0 +1,47 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "LPrefabTestWorld.h"
+#include "PrefabSystem/LPrefab.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLPrefabLoadWithReplacementTest, "LPrefab.LoadPrefabWithReplacement", EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::EngineFilter)
+
+bool FLPrefabLoadWithReplacementTest::RunTest(const FString& Parameters)
+{
+	auto CubeMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	auto SphereMesh = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Sphere.Sphere"));
+	if (!TestNotNull(TEXT("Cube mesh"), CubeMesh) || !TestNotNull(TEXT("Sphere mesh"), SphereMesh))return false;
+
+	FLPrefabTestWorld TestWorld;
+	auto World = TestWorld.Get();
+	auto SourceActor = World->SpawnActor<AActor>();
+	auto MeshComp = NewObject<UStaticMeshComponent>(SourceActor, TEXT("Mesh"));
+	MeshComp->SetStaticMesh(CubeMesh);
+	SourceActor->SetRootComponent(MeshComp);
+	MeshComp->RegisterComponent();
+	auto Prefab = ULPrefab::CreateTransientFromActor(SourceActor);
+	SourceActor->Destroy();
+	if (!TestNotNull(TEXT("Captured prefab"), Prefab))return false;
+
+	auto GetMesh = [](AActor* InActor) {
+		auto Comp = InActor != nullptr ? InActor->FindComponentByClass<UStaticMeshComponent>() : nullptr;
+		return Comp != nullptr ? Comp->GetStaticMesh().Get() : nullptr;
+	};
+	TMap<UObject*, UObject*> ReplaceAssetMap;
+	ReplaceAssetMap.Add(CubeMesh, SphereMesh);
+	auto ReplacedActor = Prefab->LoadPrefabWithReplacement(World, nullptr, ReplaceAssetMap, {}, FLPrefab_LoadPrefabCallback());
+	TestTrue(TEXT("Replaced asset is used"), GetMesh(ReplacedActor) == SphereMesh);
+	//prefab must not keep the replaced reference
+	auto NormalActor = Prefab->LoadPrefab(World, nullptr);
+	TestTrue(TEXT("Prefab is not changed by replacement"), GetMesh(NormalActor) == CubeMesh);
+	if (ReplacedActor != nullptr)ReplacedActor->Destroy();
+	if (NormalActor != nullptr)NormalActor->Destroy();
+	return true;
+}
+
+#endif
@@ -0,0 +1,33 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+/** Game world for automation tests, with physics scene and subsystems, destroyed when out of scope. */
+struct FLPrefabTestWorld
+{
+	FLPrefabTestWorld()
+	{
+		World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("LPrefabTestWorld"));
+		auto& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+		WorldContext.SetCurrentWorld(World);
+		World->InitializeActorsForPlay(FURL());
+		World->BeginPlay();
+	}
+	~FLPrefabTestWorld()
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+	UWorld* Get()const { return World; }
+private:
+	UWorld* World = nullptr;
+};
+
+#endif
@@ -33,6 +33,9 @@ public:
 	/** Delete actor and all it's children actors */
 	UFUNCTION(BlueprintCallable, meta = (AdvancedDisplay = "WithHierarchy", UnsafeDuringActorConstruction = "true"), Category = LPrefab)
 		static void DestroyActorWithHierarchy(AActor* Target, bool WithHierarchy = true);
+	/** Hide actor and all it's children actors now, and destroy them in later frames, so destroy a large hierarchy will not hitch. */
+	UFUNCTION(BlueprintCallable, meta = (AdvancedDisplay = "WithHierarchy", UnsafeDuringActorConstruction = "true"), Category = LPrefab)
+		static void DestroyActorWithHierarchyDeferred(AActor* Target, bool WithHierarchy = true);
 
 	/**
 	 * LoadPrefab to create actor.
@@ -55,6 +58,24 @@ public:
 	UFUNCTION(BlueprintCallable, meta = (AdvancedDisplay = "", UnsafeDuringActorConstruction = "true", WorldContext = "WorldContextObject", AutoCreateRefTerm = "InCallbackBeforeAwake"), Category = LPrefab)
 		static AActor* LoadPrefabWithTransform(UObject* WorldContextObject, ULPrefab* InPrefab, USceneComponent* InParent, FVector Location, FRotator Rotation, FVector Scale, const FLPrefab_LoadPrefabCallback& InCallbackBeforeAwake);
 	static AActor* LoadPrefabWithTransform(UObject* WorldContextObject, ULPrefab* InPrefab, USceneComponent* InParent, FVector Location, FQuat Rotation, FVector Scale, const TFunction<void(AActor*)>& InCallbackBeforeAwake = nullptr);
+	/**
+	 * LoadPrefab to create actor, and output a handle that can find created actors/components by guid or name directly, without search in hierarchy.
+	 * @param InParent Parent scene component that the created root actor will be attached to. Can be null so the created root actor will not attach to anyone.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (AdvancedDisplay = "Scale", UnsafeDuringActorConstruction = "true", WorldContext = "WorldContextObject"), Category = LPrefab)
+		static AActor* LoadPrefabWithHandle(UObject* WorldContextObject, ULPrefab* InPrefab, USceneComponent* InParent, FVector Location, FRotator Rotation, FVector Scale, FLPrefabInstanceHandle& OutHandle);
+	/** Find actor/component/object in loaded prefab instance by guid in prefab. */
+	UFUNCTION(BlueprintPure, Category = LPrefab, meta = (ObjectClass = "Object", DeterminesOutputType = "ObjectClass"))
+		static UObject* FindObjectInInstanceHandleByGuid(const FLPrefabInstanceHandle& InHandle, const FGuid& InGuid, TSubclassOf<UObject> ObjectClass);
+	/** Find component/object in loaded prefab instance by object name, return null if objects in different actors have same name, then use FindObjectInInstanceHandleByActorAndName. */
+	UFUNCTION(BlueprintPure, Category = LPrefab, meta = (ObjectClass = "Object", DeterminesOutputType = "ObjectClass"))
+		static UObject* FindObjectInInstanceHandleByName(const FLPrefabInstanceHandle& InHandle, FName InName, TSubclassOf<UObject> ObjectClass);
+	/** Find component/object of the actor in loaded prefab instance by object name. */
+	UFUNCTION(BlueprintPure, Category = LPrefab, meta = (ObjectClass = "Object", DeterminesOutputType = "ObjectClass"))
+		static UObject* FindObjectInInstanceHandleByActorAndName(const FLPrefabInstanceHandle& InHandle, AActor* InActor, FName InName, TSubclassOf<UObject> ObjectClass);
+	/** All actors in loaded prefab instance, root actor is the first one. */
+	UFUNCTION(BlueprintPure, Category = LPrefab)
+		static TArray<AActor*> GetActorsInInstanceHandle(const FLPrefabInstanceHandle& InHandle);
 	/**
 	 * LoadPrefab to create actor.
 	 * Awake function in LGUILifeCycleBehaviour and LPrefabInterface will be called right after LoadPrefab is done.
@@ -72,6 +93,12 @@ public:
 	 */
 	UFUNCTION(BlueprintCallable, meta = (DeterminesOutputType = "Target", UnsafeDuringActorConstruction = "true", ToolTip = "Duplicate actor with hierarchy"), Category = LPrefab)
 		static AActor* DuplicateActor(AActor* Target, USceneComponent* Parent);
+	/**
+	 * Faster version of DuplicateActor, copy property value directly without serialize to bytes.
+	 * Data that is not property (custom data in native Serialize function) is not copied, use DuplicateActor if your actor or component need it.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (DeterminesOutputType = "Target", UnsafeDuringActorConstruction = "true"), Category = LPrefab)
+		static AActor* DuplicateActorDirect(AActor* Target, USceneComponent* Parent);
 	/**
 	 * Optimized version of DuplicateActor node when you need to duplicate same actor for multiple times. Use the result data in DuplicateActorWithPreparedData node.
 	 */
@@ -82,6 +109,14 @@ public:
 	 */
 	UFUNCTION(BlueprintCallable, meta = (DeterminesOutputType = "Target", UnsafeDuringActorConstruction = "true"), Category = LPrefab)
 		static AActor* DuplicateActorWithPreparedData(UPARAM(Ref) FLPrefabDuplicateDataContainer& Data, USceneComponent* Parent);
+	/**
+	 * Use this with PrepareDuplicateData node, create multiple copies in one call. Awake is called after all copies are created.
+	 * All or nothing: if any copy fail, no copy is kept and return empty array.
+	 * @param Count	Number of copies, ignored if Transforms is not empty.
+	 * @param Transforms	If not empty, create one copy for each transform, as relative transform to Parent.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (UnsafeDuringActorConstruction = "true", AutoCreateRefTerm = "Transforms"), Category = LPrefab)
+		static TArray<AActor*> DuplicateActorWithPreparedDataBatch(UPARAM(Ref) FLPrefabDuplicateDataContainer& Data, USceneComponent* Parent, int32 Count, const TArray<FTransform>& Transforms);
 	template<class T>
 	static T* DuplicateActorT(T* Target, USceneComponent* Parent)
 	{
@@ -93,6 +128,7 @@ public:
 	 * Find the first component in parent and up parent hierarchy with type.
 	 * @param IncludeSelf	Include actor self.
 	 * @param InStopNode	If parent is InStopNode then break the search chain. Can be null to ignore it.
+	 * If hierarchy index is enabled (EnableHierarchyIndex) for this actor, result comes from the index, which is stale until MarkHierarchyIndexDirty is called after hierarchy change in user code.
 	 */
 	UFUNCTION(BlueprintPure, Category = LPrefab, meta = (ComponentClass = "ActorComponent", DeterminesOutputType = "ComponentClass"))
 	static UActorComponent* GetComponentInParent(AActor* InActor, TSubclassOf<UActorComponent> ComponentClass, bool IncludeSelf = true, AActor* InStopNode = nullptr);
@@ -102,6 +138,7 @@ public:
 	 * @param ComponentClass The component type that need to search.
 	 * @param IncludeSelf true- also search component at InActor.
 	 * @param InExcludeNode If any child actor is included in this InExcludeNode, will skip that child actor and all it's children.
+	 * If hierarchy index is enabled (EnableHierarchyIndex) for this actor, result comes from the index, which is stale until MarkHierarchyIndexDirty is called after hierarchy change in user code.
 	 */
 	UFUNCTION(BlueprintPure, Category = LPrefab, meta = (ComponentClass = "ActorComponent", DeterminesOutputType = "ComponentClass", AutoCreateRefTerm = "InExcludeNode"))
 	static TArray<UActorComponent*> GetComponentsInChildren(AActor* InActor, TSubclassOf<UActorComponent> ComponentClass, bool IncludeSelf, const TSet<AActor*>& InExcludeNode);
@@ -111,7 +148,21 @@ public:
 	 * @param ComponentClass The component type that need to search.
 	 * @param IncludeSelf true- also search component at InActor.
 	 * @param InExcludeNode If any child actor is included in this InExcludeNode, will skip that child actor and all it's children.
+	 * If hierarchy index is enabled (EnableHierarchyIndex) for this actor, result comes from the index, which is stale until MarkHierarchyIndexDirty is called after hierarchy change in user code.
 	 */
 	UFUNCTION(BlueprintPure, Category = LPrefab, meta = (ComponentClass = "ActorComponent", DeterminesOutputType = "ComponentClass", AutoCreateRefTerm = "InExcludeNode"))
 	static UActorComponent* GetComponentInChildren(AActor* InActor, TSubclassOf<UActorComponent> ComponentClass, bool IncludeSelf, const TSet<AActor*>& InExcludeNode);
+
+	/**
+	 * Create cached index for actor and all it's children actors, then GetComponentInParent/GetComponentsInChildren/GetComponentInChildren will use the index instead of traverse hierarchy.
+	 * Use it for large hierarchy that is queried frequently. Call MarkHierarchyIndexDirty after attach/detach actor or create component in the hierarchy.
+	 * Index is not validated when query, so without MarkHierarchyIndexDirty these functions silently return stale result. Prefab system already mark it for it's own changes (load/duplicate under indexed parent, ApplyPrefabToInstance, pool acquire/release, destroy).
+	 */
+	UFUNCTION(BlueprintCallable, Category = LPrefab)
+	static void EnableHierarchyIndex(AActor* InRootActor);
+	UFUNCTION(BlueprintCallable, Category = LPrefab)
+	static void DisableHierarchyIndex(AActor* InRootActor);
+	/** Index that contains the actor will rebuild at next query. Required after attach/detach actor or create component in user code, see EnableHierarchyIndex. For attach, pass the new parent actor; for detach, call it before detach. */
+	UFUNCTION(BlueprintCallable, Category = LPrefab)
+	static void MarkHierarchyIndexDirty(AActor* InActor);
 };
@@ -6,6 +6,11 @@
 #include "PrefabSystem/LPrefabLevelManagerActor.h"
 #include "PrefabSystem/LPrefabManager.h"
 #include "PrefabSystem/LPrefabSettings.h"
+#include "PrefabSystem/LPrefabSharedReferenceTable.h"
+#include "PrefabSystem/LPrefabBundle.h"
+#include "PrefabSystem/LPrefabInstanceCluster.h"
+#include "PrefabSystem/LPrefabPoolSubsystem.h"
+#include "PrefabSystem/LPrefabInstanceHandle.h"
 #include "PrefabSystem/LPrefabHelperObject.h"
 #include "PrefabSystem/ILPrefabInterface.h"
 
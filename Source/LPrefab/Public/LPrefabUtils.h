@@ -6,6 +6,7 @@
 #include "GameFramework/Actor.h"
 #include "Components/ActorComponent.h"
 #include "UObject/Package.h"
+#include "PrefabSystem/LPrefabHierarchyIndex.h"
 
 class UTexture2D;
 
@@ -14,6 +15,11 @@ class LPREFAB_API LPrefabUtils
 public:	
 	/** Destroy actor and all it's hierarchy children */
 	static void DestroyActorWithHierarchy(AActor* Target, bool WithHierarchy = true);
+	/**
+	 * Hide and disable collision of actor and all it's hierarchy children now, then unregister components and destroy them in later frames, within ULPrefabSettings::DeferredDestroyTimeBudget per frame.
+	 * Only work in game world, in editor world it is same as DestroyActorWithHierarchy.
+	 */
+	static void DestroyActorWithHierarchyDeferred(AActor* Target, bool WithHierarchy = true);
 	//Find first component of type T from InActor, if not found go up hierarchy until found
 	template<class T>
 	static T* GetComponentInParent(AActor* InActor, bool IncludeUnregisteredComponent = true)
@@ -21,6 +27,21 @@ public:
 		static_assert(TPointerIsConvertibleFromTo<T, const UActorComponent>::Value, "'T' template parameter to GetComponentInParent must be derived from UActorComponent");
 		T* resultComp = nullptr;
 		AActor* parentActor = InActor;
+		if (IncludeUnregisteredComponent && IsValid(InActor))
+		{
+			if (auto HierarchyIndex = FLPrefabHierarchyIndex::Find(InActor))
+			{
+				UActorComponent* indexedComp = nullptr;
+				bool bReachRoot = false;
+				HierarchyIndex->GetComponentInParent(InActor, T::StaticClass(), true, nullptr, indexedComp, bReachRoot);
+				if (!bReachRoot)
+				{
+					return (T*)indexedComp;
+				}
+				//continue search above the indexed hierarchy
+				parentActor = HierarchyIndex->GetRootActor()->GetAttachParentActor();
+			}
+		}
 		while (IsValid(parentActor))
 		{
 			resultComp = parentActor->FindComponentByClass<T>();
@@ -53,6 +74,17 @@ public:
 			UE_LOG(LogTemp, Error, TEXT("[LPrefabUtils::GetComponentsInChildren]InActor is not valid!"));
 			return result;
 		}
+		if (auto HierarchyIndex = FLPrefabHierarchyIndex::Find(InActor))
+		{
+			TArray<UActorComponent*> indexedComps;
+			HierarchyIndex->GetComponentsInChildren(InActor, T::StaticClass(), IncludeSelf, TSet<AActor*>(), indexedComps);
+			result.Reserve(indexedComps.Num());
+			for (auto comp : indexedComps)
+			{
+				result.Add((T*)comp);
+			}
+			return result;
+		}
 		if (IncludeSelf)
 		{
 			CollectComponentsInChildrenRecursive(InActor, result);
@@ -80,6 +112,12 @@ public:
 			UE_LOG(LogTemp, Error, TEXT("[LPrefabUtils::GetComponentsInChildren]InActor is not valid!"));
 			return nullptr;
 		}
+		if (auto HierarchyIndex = FLPrefabHierarchyIndex::Find(InActor))
+		{
+			UActorComponent* indexedComp = nullptr;
+			HierarchyIndex->GetComponentInChildren(InActor, T::StaticClass(), IncludeSelf, TSet<AActor*>(), indexedComp);
+			return (T*)indexedComp;
+		}
 		if (IncludeSelf)
 		{
 			return GetComponentInChildrenRecursive<T>(InActor);
@@ -0,0 +1,135 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "MovieSceneSequencePlaybackSettings.h"
+#include "LPrefabBakedSequence.generated.h"
+
+class ULPrefabSequence;
+class UMovieScene;
+
+UENUM()
+enum class ELPrefabBakedTrackType : uint8
+{
+	/** 9 channels: location xyz, rotation xyz (roll, pitch, yaw), scale xyz. */
+	Transform,
+	Float,
+	Double,
+	/** 4 channels: rgba. Property could be FLinearColor or FColor. */
+	Color,
+};
+
+USTRUCT()
+struct LPREFAB_API FLPrefabBakedSequenceTrack
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+		FGuid BindingId;
+	UPROPERTY()
+		ELPrefabBakedTrackType TrackType = ELPrefabBakedTrackType::Transform;
+	/** Property path from bound object, eg. "LightColor" or "Struct.Member". Not used by transform track. */
+	UPROPERTY()
+		FString PropertyPath;
+	/** Index of first channel of this track in a sample row. */
+	UPROPERTY()
+		int32 ChannelOffset = 0;
+};
+
+/**
+ * Movie scene baked to uniformly sampled keyframes, so simple animation can play without MovieScene runtime (compiled template, entity system and player object).
+ * Samples are stored row by row, each row contains all channels of a sample time and is padded to multiple of 4, so two rows can be interpolated with SIMD.
+ */
+USTRUCT()
+struct LPREFAB_API FLPrefabBakedSequence
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+		TArray<FLPrefabBakedSequenceTrack> Tracks;
+	/** SampleCount * ChannelStride values. */
+	UPROPERTY()
+		TArray<float> Samples;
+	/** Channel count of a sample row, multiple of 4. */
+	UPROPERTY()
+		int32 ChannelStride = 0;
+	UPROPERTY()
+		int32 SampleCount = 0;
+	/** Samples per second. Equal to (SampleCount - 1) / Duration if Duration > 0, so the last sample is at Duration. */
+	UPROPERTY()
+		float SampleRate = 0;
+	/** Length of playback range in seconds. */
+	UPROPERTY()
+		float Duration = 0;
+
+	bool IsValid()const { return SampleCount > 0 && ChannelStride > 0 && Samples.Num() == SampleCount * ChannelStride; }
+	/** Interpolate samples at time (in seconds, from playback start), write ChannelStride values to OutValues. */
+	void Sample(float InTime, float* OutValues)const;
+	/**
+	 * Find property of track on class, nested struct member has multiple entries in OutPropertyChain. Setter function (eg. SetIntensity) is found same as sequencer, could be null.
+	 * @return false if property not found or not match track type.
+	 */
+	static bool ResolveProperty(UStruct* InClass, const FString& InPropertyPath, ELPrefabBakedTrackType InTrackType, TArray<FProperty*>& OutPropertyChain, UFunction*& OutSetterFunction);
+#if WITH_EDITOR
+	/**
+	 * Bake movie scene if all tracks are transform, float, double or color tracks on possessable objects, with single absolute section that cover playback range and no easing.
+	 * Key with constant interpolation is not eligible. Sample rate start from display rate, and is raised (up to 8 times) until linear interpolation between samples match the curve.
+	 * @return false if movie scene is not eligible, OutBakedData is empty.
+	 */
+	static bool Bake(UMovieScene* InMovieScene, FLPrefabBakedSequence& OutBakedData);
+#endif
+};
+
+/**
+ * Minimal player for baked sequence, sample baked data and apply to bound objects. Ticked by ULPrefabSequenceComponent.
+ * Support PlayRate (positive only), LoopCount, StartTime and bPauseAtEnd of playback settings. No event is broadcasted.
+ */
+class LPREFAB_API FLPrefabBakedSequencePlayer
+{
+public:
+	/** Resolve bound objects of sequence. Return false if sequence has no baked data. */
+	bool Initialize(ULPrefabSequence* InSequence, const FMovieSceneSequencePlaybackSettings& InSettings);
+	bool IsInitializedWith(const ULPrefabSequence* InSequence)const { return Sequence.Get() == InSequence; }
+
+	void Play();
+	void Pause();
+	/** Stop and go to start, values on bound objects are not changed. */
+	void Stop();
+	bool IsPlaying()const { return bPlaying; }
+	/** Not playing and at start time, nothing to continue. */
+	bool IsStopped()const { return !bPlaying && Time == StartTime && CurrentLoop == 0; }
+	/** Current time in seconds, from playback start. */
+	float GetTime()const { return Time; }
+	/**
+	 * Advance time and apply values to bound objects.
+	 * @return true if finish playing in this tick.
+	 */
+	bool Tick(float DeltaSeconds);
+private:
+	void Evaluate();
+
+	struct FTarget
+	{
+		TWeakObjectPtr<UObject> Object;
+		int32 TrackIndex = 0;
+		TArray<FProperty*> PropertyChain;
+		UFunction* SetterFunction = nullptr;
+	};
+	void ApplyPropertyValue(UObject* InObject, const FTarget& InTarget, const void* InValue)const;
+
+	TWeakObjectPtr<ULPrefabSequence> Sequence;
+	/** Shared with the prefab and other instances. */
+	TSharedPtr<const FLPrefabBakedSequence> BakedData;
+	TArray<FTarget> Targets;
+	/** Sampled values of current time. */
+	TArray<float> Values;
+	float PlayRate = 1.0f;
+	float StartTime = 0.0f;
+	int32 LoopCount = 0;
+	bool bPauseAtEnd = false;
+
+	float Time = 0.0f;
+	int32 CurrentLoop = 0;
+	bool bPlaying = false;
+};
@@ -5,6 +5,7 @@
 #include "MovieSceneSequence.h"
 #include "MovieScene.h"
 #include "LPrefabSequenceObjectReference.h"
+#include "LPrefabBakedSequence.h"
 #include "LPrefabSequence.generated.h"
 
 /**
@@ -39,6 +40,22 @@ public:
 	
 	void SetDisplayNameString(const FString& Value) { DisplayNameString = Value; }
 	const FString& GetDisplayNameString()const { return DisplayNameString; }
+
+	/**
+	 * Runtime only. Use a movie scene that is shared by all instances of the same prefab, instead of the one owned by this sequence. Null to use own movie scene.
+	 * Bindings are still stored in this sequence, so they are resolved for each instance. See ULPrefabSettings::bShareSequenceAcrossInstances.
+	 */
+	void SetSharedMovieScene(UMovieScene* InMovieScene) { SharedMovieScene = InMovieScene; }
+	bool IsMovieSceneShared()const { return SharedMovieScene != nullptr; }
+	/** Replace own movie scene with a copy of the shared one and stop using the shared one, eg. before this sequence is serialized to a new prefab. */
+	void UnshareMovieScene();
+	/** Movie scene owned by this sequence, ignore the shared one. */
+	UMovieScene* GetOwnMovieScene()const { return MovieScene; }
+
+	/** Keyframes baked when cook, null if not baked or not eligible. Data is stored in prefab and referenced by all instances, see ULPrefab::FindBakedSequence and ULPrefabSettings::bBakeSimpleSequenceWhenCook. */
+	const TSharedPtr<const FLPrefabBakedSequence>& GetBakedData()const { return BakedData; }
+	/** Runtime only, set by prefab system when load or duplicate. */
+	void SetBakedData(const TSharedPtr<const FLPrefabBakedSequence>& InBakedData) { BakedData = InBakedData; }
 private:
 
 	//~ UObject interface
@@ -50,6 +67,10 @@ private:
 	UPROPERTY(Instanced)
 	TObjectPtr<UMovieScene> MovieScene;
 
+	/** Movie scene shared by instances of the same prefab, if valid then use it instead of MovieScene. */
+	UPROPERTY(Transient)
+	TObjectPtr<UMovieScene> SharedMovieScene;
+
 	/** Collection of object references. */
 	UPROPERTY()
 	FLPrefabSequenceObjectReferenceMap ObjectReferences;
@@ -57,6 +78,8 @@ private:
 	UPROPERTY()
 	FString DisplayNameString;
 
+	TSharedPtr<const FLPrefabBakedSequence> BakedData;
+
 #if WITH_EDITOR
 public:
 
@@ -11,6 +11,7 @@
 
 class ULPrefabSequence;
 class ULPrefabSequencePlayer;
+class FLPrefabBakedSequencePlayer;
 
 /**
  * Movie scene animation embedded within LPrefab.
@@ -33,7 +34,7 @@ public:
 		ULPrefabSequence* GetSequenceByIndex(int32 InIndex) const;
 	UFUNCTION(BlueprintCallable, Category = LPrefab)
 		const TArray<ULPrefabSequence*>& GetSequenceArray() const { return SequenceArray; }
-	/** Init SequencePlayer with current sequence. */
+	/** Init SequencePlayer with current sequence. Create SequencePlayer if not created yet. */
 	UFUNCTION(BlueprintCallable, Category = LPrefab)
 		void InitSequencePlayer();
 	/** Find animation in SequenceArray by Index, then set it to SequencePlayer. */
@@ -50,8 +51,24 @@ public:
 
 	UFUNCTION(BlueprintCallable, Category = LPrefab)
 		ULPrefabSequence* GetCurrentSequence() const { return GetSequenceByIndex(CurrentSequenceIndex); }
+	/** SequencePlayer is created and initialized with current sequence when first requested. If the sequence is played by baked player, SequencePlayer continue from its time and playing state. */
+	UFUNCTION(BlueprintPure, Category = LPrefab)
+		ULPrefabSequencePlayer* GetSequencePlayer();
+	/** Return SequencePlayer only if it is already created, will not create it. */
+	ULPrefabSequencePlayer* GetSequencePlayerIfCreated() const { return SequencePlayer; }
+
+	/**
+	 * Play current sequence. If the sequence is baked when cook (see ULPrefabSettings::bBakeSimpleSequenceWhenCook), it is played by a lightweight player without creating SequencePlayer.
+	 * Otherwise, or if SequencePlayer is already created, same as GetSequencePlayer()->Play().
+	 */
+	UFUNCTION(BlueprintCallable, Category = LPrefab)
+		void Play();
+	UFUNCTION(BlueprintCallable, Category = LPrefab)
+		void Pause();
 	UFUNCTION(BlueprintCallable, Category = LPrefab)
-		ULPrefabSequencePlayer* GetSequencePlayer() const { return SequencePlayer; }
+		void Stop();
+	UFUNCTION(BlueprintCallable, Category = LPrefab)
+		bool IsPlaying() const;
 
 	ULPrefabSequence* AddNewAnimation();
 	bool DeleteAnimationByIndex(int32 InIndex);
@@ -62,6 +79,7 @@ public:
 	virtual void Awake_Implementation()override;
 	// End ILPrefabInterface
 	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 #if WITH_EDITOR
 	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
 	virtual void PreDuplicate(FObjectDuplicationParameters& DupParams)override;
@@ -87,6 +105,16 @@ protected:
 		TArray<TObjectPtr<ULPrefabSequence>> SequenceArray;
 	UPROPERTY(EditAnywhere, Category = Playback)
 		int32 CurrentSequenceIndex = 0;
+	/** Tear down SequencePlayer when it finish playing, it will be created again when requested. Save memory for instances that play only once. */
+	UPROPERTY(EditAnywhere, Category = Playback)
+		bool bTearDownPlayerWhenFinished = false;
+	/**
+	 * Players with same group name that play the same animation at the same time are evaluated only once, and the result is copied to other players' bound objects. None means not use group.
+	 * Useful for many instances that play same animation in lockstep, eg. idle animation on list items.
+	 * Only work if all tracks are transform or common property tracks on possessable objects, and PlaybackSettings.bRestoreState is false. Otherwise the player evaluate by itself.
+	 */
+	UPROPERTY(EditAnywhere, Category = Playback)
+		FName SharedEvaluationGroup;
 	/**
 	 * Use a Blueprint component to handle callback for event track.
 	 * Not working: Add event in prefab the event can work no problem, but if close editor and open again, the event not fire at all.
@@ -96,4 +124,13 @@ protected:
 
 	UPROPERTY(transient)
 		TObjectPtr<ULPrefabSequencePlayer> SequencePlayer;
+private:
+	UFUNCTION()
+		void OnSequencePlayerFinished();
+	void TearDownIdleSequencePlayer();
+	/** Play with baked player if current sequence is baked. Return false if can not. */
+	bool TryPlayBaked();
+	void StopBakedPlayer();
+	/** Player for baked sequence, only component tick when it is playing. */
+	TSharedPtr<FLPrefabBakedSequencePlayer> BakedPlayer;
 };
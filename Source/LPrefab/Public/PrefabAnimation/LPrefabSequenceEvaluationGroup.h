@@ -0,0 +1,62 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Evaluation/MovieScenePlayback.h"
+#include "MovieSceneFwd.h"
+
+class ULPrefabSequence;
+class ULPrefabSequencePlayer;
+class UMovieScene;
+class UMovieSceneTrack;
+
+/**
+ * Players in same group that play the same animation at the same time are evaluated only once, the result is copied to other players' bound objects.
+ * A player only follow another player's evaluation when evaluation range and status are exactly same, so a player that is paused, jumped or has different play rate will evaluate by itself.
+ * Group is only created if all tracks can be copied (transform and common property tracks on possessables, with absolute sections only), see ULPrefabSequenceComponent::SharedEvaluationGroup.
+ */
+class LPREFAB_API FLPrefabSequenceEvaluationGroup
+{
+public:
+	/** Find or create group for sequence. Return null if sequence can not be evaluated in group. */
+	static TSharedPtr<FLPrefabSequenceEvaluationGroup> FindOrCreate(UWorld* InWorld, FName InGroupName, ULPrefabSequence* InSequence);
+
+	/**
+	 * Called before player evaluate.
+	 * @return true if same evaluation is done by other player in this group, then player should skip evaluate, result will be copied to it.
+	 */
+	bool TryFollowEvaluation(ULPrefabSequencePlayer* InPlayer, const FMovieSceneEvaluationRange& InRange, EMovieScenePlayerStatus::Type InStatus);
+	/** Called after player evaluated, copy result to players that follow this evaluation. */
+	void OnPlayerEvaluated(ULPrefabSequencePlayer* InPlayer);
+private:
+	struct FTrackToCopy
+	{
+		FGuid BindingId;
+		bool bIsTransform = false;
+		/** For transform track, EMovieSceneTransformChannel bits that are enabled by section mask and animated, other channels are not copied. */
+		uint32 TransformChannels = 0;
+		/** Property chain from bound object to animated property, nested struct member has multiple entries. */
+		TArray<FProperty*> PropertyChain;
+		/** Setter function on bound object's class, eg. SetIntensity. Could be null. */
+		UFunction* SetterFunction = nullptr;
+	};
+	TArray<FTrackToCopy> TracksToCopy;
+
+	struct FEvaluation
+	{
+		uint64 FrameCounter = 0;
+		TRange<FFrameTime> Range;
+		EPlayDirection Direction = EPlayDirection::Forwards;
+		EMovieScenePlayerStatus::Type Status = EMovieScenePlayerStatus::Stopped;
+		TWeakObjectPtr<ULPrefabSequencePlayer> Evaluator;
+		TArray<TWeakObjectPtr<ULPrefabSequencePlayer>> Followers;
+		bool bEvaluated = false;
+	};
+	/** Evaluations of current frame. */
+	TArray<FEvaluation> Evaluations;
+
+	static bool CollectTrackToCopy(UMovieScene* InMovieScene, const FGuid& InBindingId, UMovieSceneTrack* InTrack, TArray<FTrackToCopy>& OutTracks);
+	void CopyEvaluationResult(ULPrefabSequencePlayer* InFrom, ULPrefabSequencePlayer* InTo)const;
+	void CopyTrackValue(const FTrackToCopy& InTrack, UObject* InFrom, UObject* InTo)const;
+};
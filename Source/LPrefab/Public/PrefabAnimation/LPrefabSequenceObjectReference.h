@@ -3,6 +3,7 @@
 #pragma once
 
 #include "UObject/LazyObjectPtr.h"
+#include "UObject/ObjectKey.h"
 #include "LPrefabSequenceObjectReference.generated.h"
 
 class UActorComponent;
@@ -56,6 +57,9 @@ private:
 
 	UPROPERTY(Transient)
 	mutable TObjectPtr<UObject> Object = nullptr;
+	/** Last searched HelperActor and its component count. If search fail, no need to search again until component is added or removed. */
+	mutable FObjectKey SearchedHelperActor;
+	mutable int32 SearchedComponentCount = INDEX_NONE;
 
 	/** for direct reference actor. */
 	UPROPERTY()
@@ -120,6 +124,8 @@ struct FLPrefabSequenceObjectReferenceMap
 	 */
 	void ResolveBinding(const FGuid& ObjectId, TArray<UObject*, TInlineAllocator<1>>& OutObjects) const;
 
+	void PostSerialize(const FArchive& Ar);
+
 #if WITH_EDITOR
 	bool IsObjectReferencesGood(AActor* InContextActor)const;
 	bool IsEditorHelpersGood(AActor* InContextActor)const;
@@ -135,4 +141,18 @@ private:
 
 	UPROPERTY()
 	TArray<FLPrefabSequenceObjectReferences> References;
+
+	/** Find index in BindingIds, rebuild BindingIdToIndex if dirty. */
+	int32 FindBindingIndex(const FGuid& ObjectId) const;
+	mutable TMap<FGuid, int32> BindingIdToIndex;
+	mutable bool bBindingIdToIndexDirty = true;
+};
+
+template<>
+struct TStructOpsTypeTraits<FLPrefabSequenceObjectReferenceMap> : public TStructOpsTypeTraitsBase2<FLPrefabSequenceObjectReferenceMap>
+{
+	enum
+	{
+		WithPostSerialize = true,
+	};
 };
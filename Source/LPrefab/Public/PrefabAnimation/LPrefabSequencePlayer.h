@@ -7,6 +7,8 @@
 #include "MovieSceneSequencePlayer.h"
 #include "LPrefabSequencePlayer.generated.h"
 
+class FLPrefabSequenceEvaluationGroup;
+
 /**
  * ULPrefabSequencePlayer is used to actually "play" an actor sequence asset at runtime.
  */
@@ -17,10 +19,24 @@ class LPREFAB_API ULPrefabSequencePlayer
 public:
 	GENERATED_BODY()
 
+public:
+	/** Evaluate in group with other players, see ULPrefabSequenceComponent::SharedEvaluationGroup. None to evaluate by itself. Call it after Initialize. */
+	void SetSharedEvaluationGroup(FName InGroupName);
+
 protected:
+	friend class FLPrefabSequenceEvaluationGroup;
 
 	//~ IMovieScenePlayer interface
 	virtual UObject* GetPlaybackContext() const override;
 	virtual TArray<UObject*> GetEventContexts() const override;
+
+	virtual void UpdateMovieSceneInstance(FMovieSceneEvaluationRange InRange, EMovieScenePlayerStatus::Type PlayerStatus, const FMovieSceneUpdateArgs& Args) override;
+	/** Ask ULPrefabWorldSubsystem if should update in this frame, see ULPrefabSettings::bScheduleSequencePlayerUpdate. */
+	virtual void TickFromSequenceTickManager(float DeltaSeconds, FMovieSceneEntitySystemRunner* Runner) override;
+	virtual void BeginDestroy() override;
+private:
+	void HandleSequenceUpdated(const UMovieSceneSequencePlayer& Player, FFrameTime CurrentTime, FFrameTime PreviousTime);
+	TSharedPtr<FLPrefabSequenceEvaluationGroup> EvaluationGroup;
+	FDelegateHandle SequenceUpdatedHandle;
 };
 
@@ -9,6 +9,11 @@
 #include "Serialization/BufferArchive.h"
 #include "Serialization/ObjectWriter.h"
 #include "Serialization/ObjectReader.h"
+#include "UObject/GCObject.h"
+#include "MovieScene.h"
+
+class ULPrefabSequence;
+struct FLPrefabBakedSequence;
 
 namespace LPrefabSystem8
 {
@@ -197,7 +202,79 @@ namespace LPrefabSystem8
 		}
 	};
 
+	/** Object that is created on instance after load (eg. component added at runtime). */
+	struct FLPrefabInstanceDeltaCreatedObject
+	{
+	public:
+		FGuid ObjectGuid;
+		FGuid OuterObjectGuid;
+		/** Only valid for SceneComponent */
+		FGuid SceneComponentParentGuid;
+		int32 ObjectClass = -1;
+		uint32 ObjectFlags = 0;
+		FName ObjectName;
+		TArray<uint8> ObjectData;
+
+		friend FArchive& operator<<(FArchive& Ar, FLPrefabInstanceDeltaCreatedObject& Data)
+		{
+			Ar << Data.ObjectGuid;
+			Ar << Data.OuterObjectGuid;
+			Ar << Data.SceneComponentParentGuid;
+			Ar << Data.ObjectClass;
+			Ar << Data.ObjectFlags;
+			Ar << Data.ObjectName;
+			Ar << Data.ObjectData;
+			return Ar;
+		}
+	};
+
+	/**
+	 * Difference between a prefab instance and the prefab's data, see ActorSerializer::SaveInstanceDelta.
+	 * Object data use it's own reference lists, and the lists are stored as path, so delta is still valid if prefab's reference table changed.
+	 */
+	struct FLPrefabInstanceDeltaData
+	{
+	public:
+		static constexpr int32 DeltaVersion_Initial = 1;
+		int32 DeltaVersion = DeltaVersion_Initial;
+		TArray<FString> ReferenceAssetPaths;
+		TArray<FString> ReferenceClassPaths;
+		TArray<FName> ReferenceNames;
+		/** Objects in prefab that are destroyed on instance. */
+		TArray<FGuid> DestroyedObjects;
+		/** Outer object stay at lower index. */
+		TArray<FLPrefabInstanceDeltaCreatedObject> CreatedObjects;
+		/** Only store changed member properties. */
+		TMap<FGuid, FLPrefabOverrideParameterSaveData> ChangedObjects;
+		/** Objects that have no data in this prefab (eg. object of sub prefab), store all properties. */
+		TMap<FGuid, TArray<uint8>> FullDataObjects;
+		/** SceneComponent that attached to different parent. Key as child, value as parent. */
+		TMap<FGuid, FGuid> MapSceneComponentToParent;
+
+		friend FArchive& operator<<(FArchive& Ar, FLPrefabInstanceDeltaData& Data)
+		{
+			Ar << Data.DeltaVersion;
+			Ar << Data.ReferenceAssetPaths;
+			Ar << Data.ReferenceClassPaths;
+			Ar << Data.ReferenceNames;
+			Ar << Data.DestroyedObjects;
+			Ar << Data.CreatedObjects;
+			Ar << Data.ChangedObjects;
+			Ar << Data.FullDataObjects;
+			Ar << Data.MapSceneComponentToParent;
+			return Ar;
+		}
+	};
+
 	struct FDuplicateActorDataContainer;
+	struct FDuplicateActorTemplate;
+
+	/** Data of LPrefabSequence that is not serialized: shared movie scene is transient, and baked data is stored in prefab. */
+	struct FLPrefabSequenceRuntimeData
+	{
+		TObjectPtr<UMovieScene> SharedMovieScene = nullptr;
+		TSharedPtr<const FLPrefabBakedSequence> BakedData;
+	};
 
 	/*
 	 * serialize/deserialize actor with hierarchy.
@@ -211,8 +288,32 @@ namespace LPrefabSystem8
 		static AActor* LoadPrefab(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, bool SetRelativeTransformToIdentity = true, TFunction<void(AActor*)> CallbackBeforeAwake = nullptr);
 		/**
 		 * @param CallbackBeforeAwake	This callback function will execute before Awake event, parameter "Actor" is the loaded root actor.
+		 * @param OutInstanceHandle		Optional, fill with created objects.
+		 */
+		static AActor* LoadPrefab(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, FVector RelativeLocation, FQuat RelativeRotation, FVector RelativeScale, TFunction<void(AActor*)> CallbackBeforeAwake = nullptr, FLPrefabInstanceHandle* OutInstanceHandle = nullptr);
+		/**
+		 * LoadPrefab with assets and classes replaced, replacement is only applied to reference lists of this load (see ActorSerializerBase::ApplyReferenceReplacement), prefab and shared table are not changed.
+		 * @param CallbackBeforeAwake	This callback function will execute before Awake event, parameter "Actor" is the loaded root actor.
+		 */
+		static AActor* LoadPrefabWithReplacement(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, const TMap<UObject*, UObject*>& InReplaceAssetMap, const TMap<UClass*, UClass*>& InReplaceClassMap, TFunction<void(AActor*)> CallbackBeforeAwake = nullptr);
+		/**
+		 * Apply prefab data to an instance that is loaded before (eg. prefab is updated by hot-patch), objects are reused by guid in the handle.
+		 * Only objects whose data is changed are deserialized again, objects that not exist in new data are destroyed, new objects are created and Awake is called on them.
+		 * @return	Root actor, null if fail.
+		 */
+		static AActor* ApplyPrefabToInstance(ULPrefab* InPrefab, FLPrefabInstanceHandle& InOutHandle);
+		/**
+		 * Save difference between the instance and prefab's data: changed properties, created objects and destroyed objects. Objects are matched by guid in the handle.
+		 * Actors that created after load are not included.
+		 * @param	InHandle	Handle of the instance, must be created by LoadPrefab with OutInstanceHandle.
+		 * @return	false if fail.
+		 */
+		static bool SaveInstanceDelta(ULPrefab* InPrefab, const FLPrefabInstanceHandle& InHandle, TArray<uint8>& OutDelta);
+		/**
+		 * LoadPrefab and apply delta that saved by SaveInstanceDelta before Awake.
+		 * @param	OutInstanceHandle	Optional, fill with objects that created by prefab.
 		 */
-		static AActor* LoadPrefab(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, FVector RelativeLocation, FQuat RelativeRotation, FVector RelativeScale, TFunction<void(AActor*)> CallbackBeforeAwake = nullptr);
+		static AActor* RestoreInstanceDelta(UWorld* InWorld, ULPrefab* InPrefab, USceneComponent* Parent, FVector RelativeLocation, FQuat RelativeRotation, FVector RelativeScale, const TArray<uint8>& InDelta, FLPrefabInstanceHandle* OutInstanceHandle = nullptr);
 		/**
 		 * LoadPrefab and keep reference of objects.
 		 */
@@ -230,9 +331,41 @@ namespace LPrefabSystem8
 		 * Duplicate actor with hierarchy
 		 */
 		static AActor* DuplicateActor(AActor* OriginRootActor, USceneComponent* Parent);
+		/**
+		 * Duplicate actor with hierarchy, by copy property value from origin object to created object directly, then replace references to objects in hierarchy. No byte data is written or read, so it is faster than DuplicateActor.
+		 * Struct with native serializer (eg. FBodyInstance) is copied by serialize, because it may contains runtime data which is not safe to copy.
+		 * Data that is not property (eg. custom data in UObject::Serialize) is not copied, use DuplicateActor if need it.
+		 */
+		static AActor* DuplicateActorDirect(AActor* OriginRootActor, USceneComponent* Parent);
+		/**
+		 * Prepare template for duplicate. Template is never changed after prepared, so it can be shared by multiple spawners and kept across frames.
+		 * Each duplicate from template use it's own serializer, so duplicate again inside Awake of created actor is safe.
+		 */
+		static TSharedPtr<const FDuplicateActorTemplate, ESPMode::ThreadSafe> PrepareDuplicateTemplate(AActor* RootActor);
+		/** @param	InParent	Can be null. If not null, it must be in the world that template is prepared from, otherwise fail. */
+		static AActor* DuplicateActorWithTemplate(const TSharedRef<const FDuplicateActorTemplate, ESPMode::ThreadSafe>& InTemplate, USceneComponent* InParent);
 		/** Prepare one data and duplicate multiple times */
 		static bool PrepareDataForDuplicate(AActor* RootActor, FDuplicateActorDataContainer& OutData);
 		static AActor* DuplicateActorWithPreparedData(FDuplicateActorDataContainer& InData, USceneComponent* InParent);
+		/**
+		 * Duplicate multiple times with prepared data in one call. All copies share one serializer and one deserialize session, Awake is called on all copies after they are all created.
+		 * All or nothing: if any copy fail, copies that already created are destroyed (before Awake), and OutActors is not changed.
+		 * @param	InCount		Number of copies, ignored if InTransforms is not empty.
+		 * @param	InTransforms	If not empty, create one copy for each transform, and set as root actor's relative transform.
+		 * @param	OutActors	Created root actors.
+		 * @return	false if fail.
+		 */
+		static bool DuplicateActorWithPreparedDataBatch(FDuplicateActorDataContainer& InData, USceneComponent* InParent, int32 InCount, const TArray<FTransform>& InTransforms, TArray<AActor*>& OutActors);
+		/** Prepare data of actor hierarchy, so properties can be restored to the same objects later. Used by prefab pool. */
+		static bool PrepareDataForRestore(AActor* RootActor, FDuplicateActorDataContainer& OutData);
+		/**
+		 * Prepare data for restore with a template that is already prepared from another instance of the same prefab, only objects of this hierarchy are collected and no property data is written.
+		 * Objects outside of the hierarchy that are referenced by the template are the same for all instances, so only use it for instances that are loaded from the same prefab.
+		 * @return	false if hierarchy is not same as the template (eg. actor or component is added after loaded) or not in the template's world, then use the other PrepareDataForRestore.
+		 */
+		static bool PrepareDataForRestore(AActor* RootActor, const TSharedRef<const FDuplicateActorTemplate, ESPMode::ThreadSafe>& InTemplate, FDuplicateActorDataContainer& OutData);
+		/** Restore properties to the objects that PrepareDataForRestore is taken from. Return false if any object is not valid anymore. */
+		static bool RestoreActorWithPreparedData(FDuplicateActorDataContainer& InData);
 		/**
 		 * Editor version, duplicate actor with hierarchy, will also concern sub prefab.
 		 */
@@ -248,14 +381,23 @@ namespace LPrefabSystem8
 			, const FGuid& InParentDeserializationSessionId
 			, TMap<FGuid, TObjectPtr<UObject>>& InMapGuidToObject
 			, const TFunction<void(AActor*, const TMap<FGuid, TObjectPtr<UObject>>&, const TMap<TObjectPtr<UObject>, FGuid>&, const TArray<AActor*>&, const TArray<UActorComponent*>&)>& InOnSubPrefabFinishDeserializeFunction
+			, ActorSerializer* InParentSerializer = nullptr, uint32 InSequenceShareOverrideHash = 0
 		);
 
 		static void PostSetPropertiesOnActor(UActorComponent* InComp);
 	private:
+		/** Same as PostSetPropertiesOnActor for all components, but unregister all first and register them together with one register-context, physics bodies are created together after register. See ULPrefabSettings::bBatchComponentRegistration */
+		void PostSetPropertiesOnComponentsBatched(const TArray<UActorComponent*>& InComps);
+		/** Apply delta to the instance that is being loaded by this serializer, after properties are deserialized and before components are registered. */
+		void ApplyInstanceDelta(FLPrefabInstanceDeltaData& InDeltaData);
+		/** If not null, ApplyInstanceDelta with it before components are registered. */
+		FLPrefabInstanceDeltaData* InstanceDeltaToApply = nullptr;
 		struct FComponentDataStruct
 		{
 			UActorComponent* Component = nullptr;
 			FGuid SceneComponentParentGuid;
+			/** Parent from instance delta, use it instead of SceneComponentParentGuid if not null. */
+			USceneComponent* DeltaAttachParent = nullptr;
 		};
 		TArray<FComponentDataStruct> ComponentsInThisPrefab;
 		//include components in sub-prefab and sub-prefab's sub-prefab...
@@ -270,6 +412,8 @@ namespace LPrefabSystem8
 		TArray<AActor*> TrySerializeActorArray;
 		//origin guid mean the object guid in it's origin prefab, not sub prefab
 		TMap<TObjectPtr<UObject>, FGuid> MapObjectToOriginGuid;
+		/** AddGuidToObject, and record origin guid. Origin guid is only used by sub-prefab, so skip it when bUseSequentialGuid (duplicate). */
+		void AddCreatedObject(const FGuid& InGuid, UObject* InObject);
 
 		void CollectActorRecursive(AActor* Actor);
 
@@ -287,16 +431,53 @@ namespace LPrefabSystem8
 		void SerializeObjectArray(TMap<FGuid, FLGUIObjectSaveData>& ObjectSaveDataArray, TMap<FGuid, TArray<uint8>>& SavedObjectData, TMap<FGuid, FGuid>& MapSceneComponentToParent);
 		void SerializeActorToData(AActor* RootActor, FLPrefabSaveData& OutData);
 		//deserialize actor
+		void LoadSaveDataFromPrefab(ULPrefab* InPrefab, FLPrefabSaveData& OutSaveData);
 		AActor* DeserializeActor(USceneComponent* Parent, ULPrefab* InPrefab, const TFunction<void()>& InCallbackBeforeDeserialize, bool ReplaceTransform = false, FVector InLocation = FVector::ZeroVector, FQuat InRotation = FQuat::Identity, FVector InScale = FVector::OneVector);
-		AActor* DeserializeActorFromData(FLPrefabSaveData& SaveData, USceneComponent* Parent, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale);
-		AActor* GenerateActorArray(TArray<FLGUIActorSaveData>& SavedActors, TMap<FGuid, FLGUIObjectSaveData>& InSavedObjects, TMap<FGuid, FGuid>& MapSceneComponentToParent, FGuid ParentGuid);
-		void GenerateObjectArray(TMap<FGuid, FLGUIObjectSaveData>& SavedObjects, TMap<FGuid, FGuid>& MapSceneComponentToParent);
+		AActor* DeserializeActorFromData(const FLPrefabSaveData& SaveData, USceneComponent* Parent, bool ReplaceTransform, FVector InLocation, FQuat InRotation, FVector InScale);
+		/** Clear data of last deserialize, so prepared data can deserialize again. Containers keep their allocation. */
+		void ResetForDeserializePreparedData();
+		/** Remove actors from prefab system processing, end deserialize session and call Awake. Each element is actors of one created instance. */
+		void FinishDeserialize(TConstArrayView<TArray<AActor*>> InInstanceActors);
+		/** If not null, DeserializeActorFromData add actors of created instance here instead of FinishDeserialize, so batch can finish all copies together. */
+		TArray<TArray<AActor*>>* BatchInstanceActors = nullptr;
+		static TSharedPtr<const FDuplicateActorTemplate, ESPMode::ThreadSafe> CreateDuplicateTemplate(AActor* OriginRootActor, TMap<FGuid, TWeakObjectPtr<UObject>>* OutMapGuidToObject);
+		bool SetupForDuplicateTemplate(const FDuplicateActorTemplate& InTemplate, USceneComponent* InParent);
+		AActor* GenerateActorArray(const TArray<FLGUIActorSaveData>& SavedActors, const TMap<FGuid, FLGUIObjectSaveData>& InSavedObjects, const TMap<FGuid, FGuid>& MapSceneComponentToParent, FGuid ParentGuid);
+		void GenerateObjectArray(const TMap<FGuid, FLGUIObjectSaveData>& SavedObjects, const TMap<FGuid, FGuid>& MapSceneComponentToParent);
 
 		/** Mark of this deserialization session. If nested prefab, this is still the root prefab's value. */
 		FGuid DeserializationSessionId = FGuid();
 		bool bIsSubPrefab = false;
 		/** A temperary string for log if is loading or saving prefab (not duplicate). */
 		FString PrefabAssetPath;
+		/** Prefab that is loading (not duplicate), created root actor will be registered as instance of it. */
+		ULPrefab* LoadingPrefab = nullptr;
+		/** Use movie scene of LPrefabSequence that is shared by other instances of LoadingPrefab, see ULPrefabSettings::bShareSequenceAcrossInstances. */
+		bool bShareSequenceMovieScene = false;
+		/** Referenced assets or classes are replaced for this load, so data is different from other instances and can't share movie scene. */
+		bool bReferenceReplaced = false;
+		/** Objects that are replaced by shared object, these objects are not created and their properties are not deserialized. */
+		TSet<FGuid> SharedObjectGuids;
+		struct FSequenceToShare
+		{
+			ULPrefab* Prefab = nullptr;
+			/** Key in ULPrefab::SharedSequenceMovieScenes */
+			FGuid Key;
+			ULPrefabSequence* Sequence = nullptr;
+		};
+		/** Sequences that have no shared movie scene yet, their movie scene will be shared after properties and override parameters of parent prefab are deserialized. */
+		TArray<FSequenceToShare> SequencesToShare;
+		/** Hash of override parameters that parent prefabs apply to this sub-prefab, combined into key of shared movie scene, so instances with different override parameters will not share the same movie scene. */
+		uint32 SequenceShareOverrideHash = 0;
+		/** Serializer of parent prefab if this is sub-prefab. Parent apply override parameters after this sub-prefab is loaded, so SequencesToShare is passed to parent. */
+		ActorSerializer* ParentSerializer = nullptr;
+		void ShareSequenceMovieScene(ULPrefabSequence* InSequence, const FGuid& InSequenceGuid, const FLGUICommonObjectSaveData& InObjectData);
+		/** Baked data of sequence in LoadingPrefab, see ULPrefab::FindBakedSequence. */
+		TSharedPtr<const FLPrefabBakedSequence> FindBakedSequence(const FGuid& InSequenceGuid)const;
+		/** Runtime data of sequences in duplicate source, key is sequence's guid. They are not in data, so set them to created sequence after properties are deserialized. */
+		TMap<FGuid, FLPrefabSequenceRuntimeData> SequenceRuntimeDataForDuplicate;
+		/** Call after SerializeActorToData, fill SequenceRuntimeDataForDuplicate. */
+		void CollectSequenceRuntimeDataForDuplicate();
 		
 		struct FSubPrefabObjectOverideData
 		{
@@ -308,6 +489,21 @@ namespace LPrefabSystem8
 		TArray<FSubPrefabObjectOverideData> SubPrefabObjectOverrideData;
 
 		TFunction<void(AActor*)> CallbackBeforeAwake = nullptr;
+		/** If not null, fill with created objects before Awake. */
+		FLPrefabInstanceHandle* InstanceHandle = nullptr;
+		/** Data CRC of objects, for InstanceHandle or ApplyPrefabToInstance. */
+		TMap<FGuid, uint32> ObjectDataCRC;
+		/** Data is only comparable if reference table is same, because object data store index to it. */
+		uint32 CalculateReferenceTableCRC()const;
+
+		/** Is ApplyPrefabToInstance */
+		bool bApplyToExistingInstance = false;
+		/** For ApplyPrefabToInstance, objects that exist before apply and their data CRC when loaded. */
+		TSet<UObject*> ExistingObjectsForApply;
+		TMap<FGuid, uint32> ExistingObjectDataCRC;
+		uint32 ExistingReferenceTableCRC = 0;
+		/** For ApplyPrefabToInstance, existing objects that deserialized again. */
+		TSet<UObject*> ObjectsChangedByApply;
 
 		/**
 		 * @param	AActor*		SubPrefab's root actor
@@ -317,12 +513,19 @@ namespace LPrefabSystem8
 		TFunction<void(AActor*, const TMap<FGuid, TObjectPtr<UObject>>&, const TMap<TObjectPtr<UObject>, FGuid>&, const TArray<AActor*>&, const TArray<UActorComponent*>&)> OnSubPrefabFinishDeserializeFunction = nullptr;
 
 		/**
-		 * Writer and Reader for serialize or deserialize
-		 * @param	UObject*	Object to serialize/deserialize
+		 * Writer for serialize (or collector that only collect objects)
+		 * @param	UObject*	Object to serialize
 		 * @param	TArray<uint8>&	Data buffer
 		 * @param	bool	is SceneComponent
 		 */
 		TFunction<void(UObject*, TArray<uint8>&, bool)> WriterOrReaderFunction = nullptr;
+		/**
+		 * Reader for deserialize, data is not changed so it can be shared (eg. duplicate template)
+		 * @param	UObject*	Object to deserialize
+		 * @param	const TArray<uint8>&	Data buffer
+		 * @param	bool	is SceneComponent
+		 */
+		TFunction<void(UObject*, const TArray<uint8>&, bool)> ReaderFunction = nullptr;
 		/**
 		 * Writer and Reader for serialize or deserialize
 		 * @param	UObject*	Object to serialize/deserialize
@@ -332,9 +535,44 @@ namespace LPrefabSystem8
 		TFunction<void(UObject*, TArray<uint8>&, const TArray<FName>&)> WriterOrReaderFunctionForSubPrefabOverride = nullptr;
 	};
 
-	struct FDuplicateActorDataContainer
+	/**
+	 * Immutable data for duplicate, created by ActorSerializer::PrepareDuplicateTemplate.
+	 * Referenced assets and classes are kept alive by this template. Objects outside of the duplicated hierarchy are stored as weak reference, if destroyed then the property is set to null when duplicate.
+	 * Template can only duplicate in the world it is prepared from.
+	 */
+	struct LPREFAB_API FDuplicateActorTemplate : public FGCObject
 	{
 		FLPrefabSaveData ActorData;
-		ActorSerializer Serializer;
+		TArray<TObjectPtr<UObject>> ReferenceAssetList;
+		TArray<TObjectPtr<UClass>> ReferenceClassList;
+		TArray<FName> ReferenceNameList;
+		/** Objects outside of the duplicated hierarchy, see ActorSerializerBase::ExternalObjectList. */
+		TArray<TWeakObjectPtr<UObject>> ExternalObjectList;
+		/** World that template is prepared from, use it if no parent when duplicate. */
+		TWeakObjectPtr<UWorld> SourceWorld;
+		/** See ActorSerializer::SequenceRuntimeDataForDuplicate */
+		TMap<FGuid, FLPrefabSequenceRuntimeData> SequenceRuntimeDatas;
+
+		virtual void AddReferencedObjects(FReferenceCollector& Collector)override
+		{
+			Collector.AddReferencedObjects(ReferenceAssetList);
+			Collector.AddReferencedObjects(ReferenceClassList);
+			for (auto& KeyValue : SequenceRuntimeDatas)
+			{
+				Collector.AddReferencedObject(KeyValue.Value.SharedMovieScene);
+			}
+		}
+		virtual FString GetReferencerName()const override
+		{
+			return TEXT("FDuplicateActorTemplate");
+		}
+	};
+
+	struct FDuplicateActorDataContainer
+	{
+		/** Shared, copy this container will not copy data. */
+		TSharedPtr<const FDuplicateActorTemplate, ESPMode::ThreadSafe> Template;
+		/** Only valid for PrepareDataForRestore */
+		TMap<FGuid, TWeakObjectPtr<UObject>> MapGuidToObjectForRestore;
 	};
 }
\ No newline at end of file
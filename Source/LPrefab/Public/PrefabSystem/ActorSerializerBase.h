@@ -11,6 +11,7 @@
 #include "UObject/ObjectVersion.h"
 
 class ULPrefabWorldSubsystem;
+class ULPrefabSharedReferenceTable;
 
 namespace LPrefabSystem
 {
@@ -43,6 +44,8 @@ namespace LPrefabSystem
 		bool ObjectBelongsToThisPrefab(UObject* InObject);
 
 		const TSet<FName>& GetSceneComponentExcludeProperties();
+		/** Same as GetSceneComponentExcludeProperties if InIsSceneComponent, otherwise empty set. Return reference so no copy for every object. */
+		const TSet<FName>& GetExcludeProperties(bool InIsSceneComponent);
 		bool CollectObjectToSerailize(UObject* Object, FGuid& OutGuid);
 		//Check object and it's up outer to tell if it is trash
 		bool ObjectIsTrash(UObject* InObject);
@@ -57,6 +60,30 @@ namespace LPrefabSystem
 		TArray<UObject*> ReferenceAssetList;
 		TArray<UClass*> ReferenceClassList;
 		TArray<FName> ReferenceNameList;
+		/** For duplicate template, store objects outside of the hierarchy by index of ExternalObjectList instead of raw pointer, because template can outlive these objects. */
+		bool bStoreExternalObjectByIndex = false;
+		TArray<TWeakObjectPtr<UObject>> ExternalObjectList;
+		TMap<UObject*, int32> MapExternalObjectToIndex;
+		int32 FindOrAddExternalObject(UObject* InObject);
+		/** Return null if object is not valid anymore. */
+		UObject* FindExternalObjectByIndex(int32 Id)const;
+		/**
+		 * Project-wide shared table for cooked prefab, could be null.
+		 * Index of entry in shared table is stored as negative value: -2 means shared index 0, -3 means shared index 1... because -1 is already used as invalid.
+		 */
+		ULPrefabSharedReferenceTable* SharedReferenceTable = nullptr;
+		/** Copy of SharedReferenceTable's lists with replaced entries, used instead of SharedReferenceTable's lists if not empty. See ApplyReferenceReplacement. */
+		TArray<UObject*> SharedAssetListOverride;
+		TArray<UClass*> SharedClassListOverride;
+		/**
+		 * Replace referenced assets and classes for this serializer only. ReferenceAssetList and ReferenceClassList are already copied from prefab, so replace them directly;
+		 * SharedReferenceTable is used by all prefabs, so its lists are copied to SharedAssetListOverride/SharedClassListOverride only if any entry need to replace.
+		 * Prefab and shared table are never changed, so other loads of the same prefab are not affected.
+		 * @return true if any entry is replaced.
+		 */
+		bool ApplyReferenceReplacement(const TMap<UObject*, UObject*>& InReplaceAssetMap, const TMap<UClass*, UClass*>& InReplaceClassMap);
+		static int32 SharedIndexToId(int32 InSharedIndex) { return -InSharedIndex - 2; }
+		static int32 IdToSharedIndex(int32 InId) { return -InId - 2; }
 		ULPrefabWorldSubsystem* LPrefabManager = nullptr;
 
 		bool bOverrideVersions = false;
@@ -69,9 +96,24 @@ namespace LPrefabSystem
 		TMap<FGuid, TObjectPtr<UObject>> MapGuidToObject;
 		TMap<UObject*, FGuid> MapObjectToGuid;
 
+		/**
+		 * Duplicate don't need stable id, so object's guid can be sequential index (stored in FGuid::D, other components are zero), which is much cheaper than FGuid::NewGuid.
+		 * When deserialize, created object is only stored in SequentialIndexToObject (not MapGuidToObject), and object reference is resolved by index.
+		 */
+		bool bUseSequentialGuid = false;
+		/** Create guid for new collected object. */
+		FGuid MakeObjectGuid();
+		static bool IsSequentialGuid(const FGuid& InGuid) { return InGuid.A == 0 && InGuid.B == 0 && InGuid.C == 0 && InGuid.D != 0; }
+		/** Add to SequentialIndexToObject if bUseSequentialGuid and guid is sequential, otherwise add to MapGuidToObject. */
+		void AddGuidToObject(const FGuid& InGuid, UObject* InObject);
+		UObject* FindObjectByGuid(const FGuid& InGuid)const;
+		TArray<UObject*> SequentialIndexToObject;
+
 	protected:
 		UWorld* TargetWorld = nullptr;//world that need to spawn actor
 		bool bIsEditorOrRuntime = true;
 		static bool CanUseUnversionedPropertySerialization();
+	private:
+		uint32 SequentialGuidCounter = 0;
 	};
 }
\ No newline at end of file
@@ -34,4 +34,15 @@ public:
 	 */
 	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = LPrefab)
 		void EditorAwake();
+	/**
+	 * Called when the prefab instance is acquired from ULPrefabPoolSubsystem. Not called when the instance is loaded for the first time, Awake is called for that.
+	 * Properties are already restored to the state right after the prefab is loaded.
+	 */
+	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = LPrefab)
+		void OnAcquireFromPool();
+	/**
+	 * Called when the prefab instance is released to ULPrefabPoolSubsystem, before it is hidden and deactivated.
+	 */
+	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = LPrefab)
+		void OnReleaseToPool();
 };
\ No newline at end of file
@@ -4,6 +4,9 @@
 #include "CoreMinimal.h"
 #include "Misc/NetworkVersion.h"
 #include "Engine/EngineBaseTypes.h"
+#include "Serialization/BulkData.h"
+#include "PrefabSystem/LPrefabInstanceHandle.h"
+#include "PrefabAnimation/LPrefabBakedSequence.h"
 #include "LPrefab.generated.h"
 
 #define LPREFAB_SERIALIZER_NEWEST_INCLUDE "PrefabSystem/ActorSerializer8.h"
@@ -55,6 +58,8 @@ enum class ELPrefabVersion : uint16
 
 class ULPrefab;
 class ULPrefabHelperObject;
+class ULPrefabSharedReferenceTable;
+class UMovieScene;
 
 USTRUCT(NotBlueprintType)
 struct LPREFAB_API FLPrefabOverrideParameterData
@@ -227,11 +232,52 @@ public:
 	/** build version for ReferenceNameList */
 	UPROPERTY()
 		TArray<FName> ReferenceNameListForBuild;
+	/** Project-wide shared reference table when cook this prefab, reference that found in this table is stored as index to it. Could be null. */
+	UPROPERTY()
+		TObjectPtr<ULPrefabSharedReferenceTable> SharedReferenceTableForBuild;
 	/**
 	 * serialized data for publish, not contain property name and editor only property. much more faster than BinaryData when deserialize
 	 */
 	UPROPERTY()
 		TArray<uint8> BinaryDataForBuild;
+	/** If runtime data is written to prefab bundle file when cook, this is the offset in bundle file, and BinaryDataForBuild will be empty. -1 means not in bundle. */
+	UPROPERTY()
+		int64 BundleOffsetForBuild = -1;
+	UPROPERTY()
+		int64 BundleSizeForBuild = 0;
+	/** Crc of runtime data in bundle file, to check if bundle entry is still valid. */
+	UPROPERTY()
+		uint32 BundleCrcForBuild = 0;
+	/** If BundleFallbackDataForBuild is serialized after properties. */
+	UPROPERTY()
+		bool bHasBundleFallbackDataForBuild = false;
+	/** Copy of runtime data that is in bundle, not loaded with package, only loaded if bundle entry is not valid (eg. bundle file is from another cook). */
+	mutable FByteBulkData BundleFallbackDataForBuild;
+	mutable TArray<uint8> BundleFallbackLoadedData;
+	mutable bool bBundleDataVerified = false;
+#if WITH_EDITORONLY_DATA
+	struct FCookedBundleEntry
+	{
+		int64 Offset = -1;
+		int64 Size = 0;
+		uint32 Crc = 0;
+	};
+	/** Bundle entry for each cooking platform, key is platform name. Written to properties when serialize for that platform. */
+	TMap<FString, FCookedBundleEntry> CookedBundleEntries;
+#endif
+	/**
+	 * Runtime only. Movie scene of LPrefabSequence that is shared by all loaded instances of this prefab, key is sequence's guid in this prefab combined with hash of parent prefab's override parameters.
+	 * Cleared when the world that create them is teardown. See ULPrefabSettings::bShareSequenceAcrossInstances.
+	 */
+	UPROPERTY(Transient)
+		TMap<FGuid, TObjectPtr<UMovieScene>> SharedSequenceMovieScenes;
+	/** Keyframes of LPrefabSequence baked when cook, key is sequence's guid in this prefab. Stored once here instead of in every instance. See ULPrefabSettings::bBakeSimpleSequenceWhenCook. */
+	UPROPERTY()
+		TMap<FGuid, FLPrefabBakedSequence> BakedSequencesForBuild;
+	/** Created from BakedSequencesForBuild when first used, then referenced by all instances. */
+	mutable TMap<FGuid, TSharedPtr<const FLPrefabBakedSequence>> SharedBakedSequences;
+	/** Baked data of sequence in this prefab, null if not baked. */
+	TSharedPtr<const FLPrefabBakedSequence> FindBakedSequence(const FGuid& InSequenceGuid)const;
 #if WITH_EDITORONLY_DATA
 	UPROPERTY(Instanced, Transient)
 		TObjectPtr<class UThumbnailInfo> ThumbnailInfo;
@@ -264,12 +310,54 @@ public:
 	UFUNCTION(BlueprintCallable, meta = (AdvancedDisplay = "InCallbackBeforeAwake", UnsafeDuringActorConstruction = "true", WorldContext = "WorldContextObject", AutoCreateRefTerm = "InCallbackBeforeAwake"), Category = "LPrefab")
 		AActor* LoadPrefabWithTransform(UObject* WorldContextObject, USceneComponent* InParent, FVector Location, FRotator Rotation, FVector Scale, const FLPrefab_LoadPrefabCallback& InCallbackBeforeAwake);
 	AActor* LoadPrefabWithTransform(UObject* WorldContextObject, USceneComponent* InParent, FVector Location, FQuat Rotation, FVector Scale, const TFunction<void(AActor*)>& InCallbackBeforeAwake);
+	/**
+	 * LoadPrefab to create actor, and output a handle that can find created actors/components by guid or name directly.
+	 * @param InParent Parent scene component that the created root actor will be attached to. Can be null so the created root actor will not attach to anyone.
+	 * @param OutHandle Created objects of this load.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (AdvancedDisplay = "Scale", UnsafeDuringActorConstruction = "true", WorldContext = "WorldContextObject"), Category = "LPrefab")
+		AActor* LoadPrefabWithHandle(UObject* WorldContextObject, USceneComponent* InParent, FVector Location, FRotator Rotation, FVector Scale, FLPrefabInstanceHandle& OutHandle);
+	/**
+	 * Apply this prefab's data to an instance that is loaded by LoadPrefabWithHandle, eg. after the prefab asset is updated by hot-patch.
+	 * Objects are matched by guid: only changed objects are deserialized again, removed objects are destroyed, new objects are created (and Awake is called on them). Runtime state on unchanged objects is kept.
+	 * @param InOutHandle Handle of the instance, will be updated with new objects.
+	 * @return Root actor of the instance, null if fail.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (UnsafeDuringActorConstruction = "true"), Category = "LPrefab")
+		AActor* ApplyToInstance(UPARAM(ref) FLPrefabInstanceHandle& InOutHandle);
+	/**
+	 * Save difference between an instance (loaded by LoadPrefabWithHandle) and this prefab: changed properties, components created or destroyed after load. Useful for save game.
+	 * Actors created after load are not included. Root actor's transform is not included, it is given when restore.
+	 * @param InHandle Handle of the instance.
+	 * @param OutDelta Result data, use it in RestoreInstanceDelta.
+	 * @return false if fail.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab")
+		bool SaveInstanceDelta(const FLPrefabInstanceHandle& InHandle, TArray<uint8>& OutDelta);
+	/**
+	 * LoadPrefab and apply delta that saved by SaveInstanceDelta, delta is applied before components are registered and Awake.
+	 * @param InParent Parent scene component that the created root actor will be attached to. Can be null so the created root actor will not attach to anyone.
+	 * @param InDelta Data from SaveInstanceDelta.
+	 * @param OutHandle Objects created by prefab. Objects created by delta are not included.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (AdvancedDisplay = "Scale", UnsafeDuringActorConstruction = "true", WorldContext = "WorldContextObject"), Category = "LPrefab")
+		AActor* RestoreInstanceDelta(UObject* WorldContextObject, USceneComponent* InParent, FVector Location, FRotator Rotation, FVector Scale, const TArray<uint8>& InDelta, FLPrefabInstanceHandle& OutHandle);
+	/**
+	 * Capture actor hierarchy into a new transient prefab, works in packaged game. The created prefab can be used like a prefab asset (LoadPrefab, prefab pool...), useful when a hierarchy is built procedurally and need many copies.
+	 * Nested prefab in the hierarchy is captured as normal actors. Transient actors and objects are not included.
+	 * Sequences in the hierarchy that use shared movie scene will own a copy of it, see ULPrefabSettings::bShareSequenceAcrossInstances.
+	 * @param RootActor Root actor of the hierarchy.
+	 * @return Created prefab, null if fail. Keep a reference to it, or it will be garbage collected.
+	 */
+	UFUNCTION(BlueprintCallable, meta = (UnsafeDuringActorConstruction = "true"), Category = "LPrefab")
+		static ULPrefab* CreateTransientFromActor(AActor* RootActor);
 	/**
 	 * LoadPrefab to create actor.
 	 * Awake function in LGUILifeCycleBehaviour and LPrefabInterface will be called right after LoadPrefab is done.
 	 * @param InParent Parent scene component that the created root actor will be attached to. Can be null so the created root actor will not attach to anyone.
 	 * @param InReplaceAssetMap Replace source asset to dest before load the prefab.
 	 * @param InReplaceClassMap Replace source class to dest before load the prefab.
+	 * Replacement only affect this load, this prefab and the shared reference table are not changed (except old prefab versions in editor, which restore after load).
 	 */
 	UFUNCTION(BlueprintCallable, meta = (AdvancedDisplay = "InCallbackBeforeAwake", UnsafeDuringActorConstruction = "true", WorldContext = "WorldContextObject", AutoCreateRefTerm = "InCallbackBeforeAwake"), Category = "LPrefab")
 		AActor* LoadPrefabWithReplacement(UObject* WorldContextObject, USceneComponent* InParent, const TMap<UObject*, UObject*>& InReplaceAssetMap, const TMap<UClass*, UClass*>& InReplaceClassMap, const FLPrefab_LoadPrefabCallback& InCallbackBeforeAwake);
@@ -288,6 +376,9 @@ public:
 		, TMap<FGuid, TObjectPtr<UObject>>& InOutMapGuidToObject, TMap<TObjectPtr<AActor>, FLSubPrefabData>& OutSubPrefabMap
 	);
 	bool IsPrefabBelongsToThisSubPrefab(ULPrefab* InPrefab, bool InRecursive);
+	/** Runtime data, from BinaryDataForBuild or prefab bundle file. */
+	TArrayView64<const uint8> GetBinaryDataForBuild()const;
+	virtual void Serialize(FArchive& Ar)override;
 #if WITH_EDITOR
 	void CopyDataTo(ULPrefab* TargetPrefab);
 	bool GetIsPrefabVariant()const { return bIsPrefabVariant; }
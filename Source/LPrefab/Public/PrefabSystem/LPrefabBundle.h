@@ -0,0 +1,58 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class IMappedFileHandle;
+class IMappedFileRegion;
+class ITargetPlatform;
+
+/**
+ * One ".lprefabbundle" file contains runtime data of all cooked prefabs, each prefab only store offset, size and crc of its entry in this file.
+ * At runtime the file is memory-mapped, so prefab's runtime data is not resident in every prefab asset, and deserialize can read directly from the mapped memory.
+ * If the file can not be mapped (eg. compressed in pak), it will be loaded into memory once.
+ * File is append-only during cook and entries with same data are reused, so offsets stored by prefabs that are not recooked (iterative cook) are still valid.
+ * Each entry has a header with crc and size, prefab check it before use and fallback to the data in its package if not match.
+ */
+class LPREFAB_API FLPrefabBundle
+{
+public:
+	~FLPrefabBundle();
+	static FLPrefabBundle& Get();
+
+	/**
+	 * Get data of a prefab, return empty view if entry not match size and crc.
+	 * @param	bVerifyData		Also calculate crc of data, only need once for a prefab.
+	 */
+	TArrayView64<const uint8> GetData(int64 InOffset, int64 InSize, uint32 InCrc, bool bVerifyData);
+
+	/** Full path of bundle file at runtime, see ULPrefabSettings::PrefabBundleFile. */
+	static FString GetBundleFilePath();
+	static constexpr uint32 BundleFileMagic = 0x4442504C;//'LPBD'
+	static constexpr uint32 BundleFileVersion = 2;
+	static constexpr uint32 BundleEntryMagic = 0x4542504C;//'LPBE'
+	static constexpr int64 BundleDataAlignment = 16;
+	static constexpr int64 BundleHeaderSize = 16;
+	/** Entry header: magic (uint32), crc (uint32), size (int64). Data follows the header. */
+	static constexpr int64 BundleEntryHeaderSize = 16;
+#if WITH_EDITOR
+	/** Bundle file in cook output folder of the platform, so it is staged with cooked content. */
+	static FString GetCookedBundleFilePath(const ITargetPlatform* InTargetPlatform);
+	/**
+	 * Append prefab's runtime data to bundle file of the platform when cook, or reuse existing entry with same data. Safe to call from multiple cook processes.
+	 * @param	OutCrc		Crc of data, prefab should store it with the offset.
+	 * @return	Offset of data in bundle file, -1 if fail.
+	 */
+	static int64 AppendForCook(const ITargetPlatform* InTargetPlatform, const TArray<uint8>& InData, uint32& OutCrc);
+#endif
+private:
+	FLPrefabBundle() {}
+	void OpenBundle();
+	bool bOpened = false;
+	IMappedFileHandle* MappedFileHandle = nullptr;
+	IMappedFileRegion* MappedFileRegion = nullptr;
+	/** Fallback if file can not be mapped. */
+	TArray<uint8> LoadedFileData;
+	TArrayView64<const uint8> BundleData;
+};
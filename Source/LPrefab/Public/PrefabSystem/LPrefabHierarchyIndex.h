@@ -0,0 +1,76 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtr.h"
+#include "UObject/ObjectKey.h"
+
+class AActor;
+class UActorComponent;
+
+/**
+ * Optional cached index of an actor hierarchy (eg. a prefab instance), so GetComponentsInChildren/GetComponentInChildren/GetComponentInParent can be answered without traversing hierarchy.
+ * Actors are stored in depth-first order with parent link and subtree range, components are stored in the same order. Components of a class are collected once when first queried.
+ * Engine have no runtime event for attach/detach or component create, so call MarkDirty after change the hierarchy, then index will rebuild at next query.
+ * Index is NOT validated when query: attach/detach actor, or create component, in user code without MarkDirty will give stale result (missing or extra components) until next rebuild.
+ * Prefab system already call it for it's own changes: load/duplicate under an indexed parent, ApplyPrefabToInstance, pool acquire/release, deferred destroy.
+ * Destroyed actor will mark index dirty automatically, destroyed component is skipped in query result.
+ */
+class LPREFAB_API FLPrefabHierarchyIndex
+{
+public:
+	/** Create index for actor and all it's children actors. */
+	static void Enable(AActor* InRootActor);
+	static void Disable(AActor* InRootActor);
+	/** Mark all index that contains the actor dirty (include outer index of nested), it will rebuild at next query. For attach, pass the new parent actor; for detach, call it before detach. */
+	static void MarkDirty(AActor* InActor);
+	/** Find index that contains the actor (rebuild if dirty), return null if not indexed. Index is only as up to date as MarkDirty calls, see class description. */
+	static FLPrefabHierarchyIndex* Find(AActor* InActor);
+
+	explicit FLPrefabHierarchyIndex(AActor* InRootActor);
+	AActor* GetRootActor()const { return RootActor.Get(); }
+	bool IsDirty()const { return bDirty; }
+	void SetDirty() { bDirty = true; }
+	void Rebuild();
+	const TMap<const AActor*, int32>& GetMapActorToNode()const { return MapActorToNode; }
+
+	/** Same as ULPrefabBPLibrary::GetComponentsInChildren. Return false if InActor is not in this index. */
+	bool GetComponentsInChildren(AActor* InActor, UClass* InClass, bool bIncludeSelf, const TSet<AActor*>& InExcludeNode, TArray<UActorComponent*>& OutComponents);
+	/** Same as ULPrefabBPLibrary::GetComponentInChildren. Return false if InActor is not in this index. */
+	bool GetComponentInChildren(AActor* InActor, UClass* InClass, bool bIncludeSelf, const TSet<AActor*>& InExcludeNode, UActorComponent*& OutComponent);
+	/**
+	 * Search InActor and it's parents up to root actor of this index. Return false if InActor is not in this index.
+	 * @param	bOutReachRoot	True if not found and InStopNode is not reached, caller should continue search from parent of root actor.
+	 */
+	bool GetComponentInParent(AActor* InActor, UClass* InClass, bool bIncludeSelf, AActor* InStopNode, UActorComponent*& OutComponent, bool& bOutReachRoot);
+private:
+	struct FNode
+	{
+		TWeakObjectPtr<AActor> Actor;
+		int32 ParentIndex = INDEX_NONE;
+		/** Exclusive end of this node's subtree in Nodes. */
+		int32 SubtreeEnd = 0;
+		/** Range of this actor's components in Components. */
+		int32 ComponentStart = 0;
+		int32 ComponentEnd = 0;
+	};
+	struct FComponentEntry
+	{
+		TWeakObjectPtr<UActorComponent> Component;
+		int32 NodeIndex = INDEX_NONE;
+	};
+	TWeakObjectPtr<AActor> RootActor;
+	TArray<FNode> Nodes;
+	TArray<FComponentEntry> Components;
+	TMap<const AActor*, int32> MapActorToNode;
+	/** Index in Components of each class, ascending. */
+	TMap<FObjectKey, TArray<int32>> MapClassToComponents;
+	bool bDirty = true;
+
+	void AddNodeRecursive(AActor* InActor, int32 InParentIndex);
+	const TArray<int32>& GetComponentsOfClass(UClass* InClass);
+	/** Range [Start, End) in Components of node's subtree. */
+	int32 GetSubtreeComponentEnd(int32 InNodeIndex)const;
+	UActorComponent* FindFirstValid(const TArray<int32>& InClassComponents, int32 InComponentStart, int32 InComponentEnd)const;
+};
@@ -0,0 +1,49 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "LPrefabInstanceCluster.generated.h"
+
+class AActor;
+class USceneComponent;
+
+/**
+ * GC cluster root for objects of a loaded prefab instance, see ULPrefabSettings::bCreateGCClusterForPrefabInstance.
+ * All objects in a cluster are treated as one object by GC, so reachability analysis is faster when there are thousands of instances.
+ * Only actors with bCanBeInCluster are put into the cluster, because objects in cluster are not scanned by GC, a new reference to an object outside the cluster is not tracked.
+ * Cluster is dissolved before GC if any actor is destroyed, or actor's hierarchy or components are changed.
+ */
+UCLASS(NotBlueprintable, NotBlueprintType, Transient)
+class LPREFAB_API ULPrefabInstanceCluster : public UObject
+{
+	GENERATED_BODY()
+public:
+	virtual bool CanBeClusterRoot() const override { return true; }
+
+	/** Put actors into a new cluster. Return false if nothing can be clustered. */
+	bool CreateInstanceCluster(const TArray<AActor*>& InActors);
+	/** Check if the instance is not changed since cluster created. */
+	bool IsInstanceUnchanged()const;
+	void DissolveInstanceCluster();
+	bool ContainsActor(const AActor* InActor)const;
+private:
+	UPROPERTY()
+		TArray<TObjectPtr<UObject>> ClusterObjects;
+
+	struct FActorState
+	{
+		TWeakObjectPtr<AActor> Actor;
+		int32 ComponentCount = 0;
+	};
+	struct FSceneComponentState
+	{
+		TWeakObjectPtr<USceneComponent> Component;
+		TWeakObjectPtr<USceneComponent> AttachParent;
+		int32 AttachChildrenCount = 0;
+	};
+	TArray<FActorState> ActorStates;
+	TArray<FSceneComponentState> SceneComponentStates;
+	bool bClusterCreated = false;
+};
@@ -0,0 +1,83 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/WeakObjectPtr.h"
+#include "UObject/ObjectKey.h"
+#include "LPrefabInstanceHandle.generated.h"
+
+class AActor;
+class UActorComponent;
+
+/**
+ * Objects created by one LoadPrefab, filled by prefab loader so child actors/components can be found without traversing hierarchy.
+ * Guid is the object's id in prefab (same as ULPrefabHelperObject's MapObjectToGuid in editor), it is stable across loads.
+ * Objects created in Awake or later are not included.
+ */
+USTRUCT(BlueprintType)
+struct LPREFAB_API FLPrefabInstanceHandle
+{
+	GENERATED_BODY()
+public:
+	AActor* GetRootActor()const { return RootActor.Get(); }
+	/** Root actor is still valid. */
+	bool IsValid()const { return RootActor.IsValid(); }
+	/** All actors of this instance, include sub prefab. Root actor is the first one. */
+	const TArray<TWeakObjectPtr<AActor>>& GetActors()const { return Actors; }
+	/** All components of this instance, include sub prefab. */
+	const TArray<TWeakObjectPtr<UActorComponent>>& GetComponents()const { return Components; }
+
+	/** Find actor/component/object by guid in prefab. */
+	UObject* FindObjectByGuid(const FGuid& InGuid)const;
+	template<class T>
+	T* FindObjectByGuid(const FGuid& InGuid)const
+	{
+		return Cast<T>(FindObjectByGuid(InGuid));
+	}
+	/**
+	 * Find component or subobject by object name. Component names are only unique inside one actor, so return null if multiple actors have object with this name, use the version with actor instead.
+	 * Actor's name is generated when spawn, so use guid to find actor.
+	 */
+	UObject* FindObjectByName(FName InName)const;
+	template<class T>
+	T* FindObjectByName(FName InName)const
+	{
+		return Cast<T>(FindObjectByName(InName));
+	}
+	/** Find component or subobject by object name inside the actor. */
+	UObject* FindObjectByName(const AActor* InActor, FName InName)const;
+	template<class T>
+	T* FindObjectByName(const AActor* InActor, FName InName)const
+	{
+		return Cast<T>(FindObjectByName(InActor, InName));
+	}
+
+	void Reset();
+	/** Fill with deserialize result. */
+	void Init(AActor* InRootActor, const TArray<AActor*>& InActors, const TArray<UActorComponent*>& InComponents, const TMap<FGuid, TObjectPtr<UObject>>& InMapGuidToObject);
+	/** Fill from actor hierarchy, for old prefab version that have no guid table. */
+	void InitFromHierarchy(AActor* InRootActor);
+	/** Data CRC when loaded, so ApplyPrefabToInstance can tell which object is changed. */
+	void SetDataCRC(TMap<FGuid, uint32>&& InObjectDataCRC, uint32 InReferenceTableCRC);
+	const TMap<FGuid, uint32>& GetObjectDataCRC()const { return ObjectDataCRC; }
+	uint32 GetReferenceTableCRC()const { return ReferenceTableCRC; }
+	/** Get all valid objects that have guid. */
+	void GetMapGuidToObject(TMap<FGuid, TObjectPtr<UObject>>& OutMapGuidToObject)const;
+	/** Iterate all guids, object is null if it is destroyed. */
+	void ForEachGuidObject(TFunctionRef<void(const FGuid&, UObject*)> InFunction)const;
+private:
+	TWeakObjectPtr<AActor> RootActor;
+	TArray<TWeakObjectPtr<AActor>> Actors;
+	TArray<TWeakObjectPtr<UActorComponent>> Components;
+	/** Objects that can be found by guid or name, maps store index to this array. */
+	TArray<TWeakObjectPtr<UObject>> Objects;
+	TMap<FGuid, int32> MapGuidToObjectIndex;
+	/** INDEX_NONE if multiple objects have same name. */
+	TMap<FName, int32> MapNameToObjectIndex;
+	/** Key is owner actor and object name. */
+	TMap<TPair<FObjectKey, FName>, int32> MapActorAndNameToObjectIndex;
+	void AddObjectName(UObject* InObject, int32 InIndex);
+	TMap<FGuid, uint32> ObjectDataCRC;
+	uint32 ReferenceTableCRC = 0;
+};
@@ -4,6 +4,7 @@
 #include "CoreMinimal.h"
 #include "Tickable.h"
 #include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
 #include "LPrefabManager.generated.h"
 
 
@@ -12,6 +13,10 @@ DECLARE_MULTICAST_DELEGATE_ThreeParams(FLPrefabEditorManagerOnComponentCreateDel
 
 class ULPrefab;
 class ULPrefabHelperObject;
+class ULPrefabInstanceCluster;
+class FLPrefabHierarchyIndex;
+class ULPrefabSequencePlayer;
+class UPrimitiveComponent;
 
 UCLASS(NotBlueprintable, NotBlueprintType, Transient, NotPlaceable)
 class LPREFAB_API ULPrefabManagerObject :public UObject, public FTickableGameObject
@@ -97,13 +102,16 @@ public:
 };
 
 UCLASS(NotBlueprintable, NotBlueprintType, Transient, NotPlaceable)
-class LPREFAB_API ULPrefabWorldSubsystem : public UWorldSubsystem
+class LPREFAB_API ULPrefabWorldSubsystem : public UTickableWorldSubsystem
 {
 	GENERATED_BODY()
 public:
 	virtual bool ShouldCreateSubsystem(UObject* Outer) const override { return true; }
-	virtual void Initialize(FSubsystemCollectionBase& Collection)override {};
-	virtual void Deinitialize()override {};
+	virtual void Initialize(FSubsystemCollectionBase& Collection)override;
+	virtual void Deinitialize()override;
+	virtual void Tick(float DeltaTime)override;
+	virtual bool IsTickableWhenPaused() const override { return true; }
+	virtual TStatId GetStatId() const override;
 
 	static ULPrefabWorldSubsystem* GetInstance(UWorld* World);
 	DECLARE_EVENT_OneParam(ULPrefabWorldSubsystem, FDeserializeSession, const FGuid&);
@@ -132,4 +140,121 @@ public:
 	 * PrefabSystem is deserializing actor during LoadPrefab or DuplicateActor.
 	 */
 	bool IsPrefabSystemProcessingActor(AActor* InActor);
+
+private:
+	UPROPERTY()
+		TArray<TObjectPtr<ULPrefabInstanceCluster>> InstanceClusters;
+	FDelegateHandle PreGarbageCollectDelegateHandle;
+	void OnPreGarbageCollect();
+	FDelegateHandle PostGarbageCollectDelegateHandle;
+	void OnPostGarbageCollect();
+public:
+	/** Put objects of a loaded prefab instance into a GC cluster. See ULPrefabSettings::bCreateGCClusterForPrefabInstance */
+	void CreateInstanceCluster(const TArray<AActor*>& InActors);
+	/** Dissolve cluster that contains the actor, eg. before properties of the instance are changed by prefab system. */
+	void DissolveInstanceClusterOfActor(AActor* InActor);
+
+private:
+	/** Prefabs that have shared movie scene created by instances in this world. */
+	TArray<TWeakObjectPtr<ULPrefab>> PrefabsWithSharedSequence;
+public:
+	/** Shared movie scene of the prefab will be cleared when this world is teardown. See ULPrefabSettings::bShareSequenceAcrossInstances */
+	void AddPrefabWithSharedSequence(ULPrefab* InPrefab);
+
+private:
+	struct FDeferredDestroyItem
+	{
+		TWeakObjectPtr<AActor> Actor;
+		bool bComponentsUnregistered = false;
+	};
+	/** Children are in front of parent, so destroy parent will not need to detach children. */
+	TArray<FDeferredDestroyItem> DeferredDestroyQueue;
+	void ProcessDeferredDestroy(double InTimeBudget);
+public:
+	/** Hide actors and disable collision now, then unregister components and destroy actors in later frames. See LPrefabUtils::DestroyActorWithHierarchyDeferred */
+	void DestroyActorsDeferred(const TArray<AActor*>& InActors);
+	/** Destroy all actors in deferred destroy queue now. */
+	void FlushDeferredDestroy();
+	int32 GetDeferredDestroyCount()const { return DeferredDestroyQueue.Num(); }
+
+private:
+	TArray<TSharedPtr<FLPrefabHierarchyIndex>> HierarchyIndices;
+	TMap<const AActor*, FLPrefabHierarchyIndex*> MapActorToHierarchyIndex;
+	FDelegateHandle ActorDestroyedDelegateHandle;
+	void OnActorDestroyed(AActor* InActor);
+	void RebuildHierarchyIndex(FLPrefabHierarchyIndex* InIndex);
+	void RemoveHierarchyIndex(FLPrefabHierarchyIndex* InIndex);
+public:
+	/** Count of hierarchy index in all worlds, so query can skip lookup if no index is used. */
+	static int32 HierarchyIndexCount;
+	/** See FLPrefabHierarchyIndex */
+	void EnableHierarchyIndex(AActor* InRootActor);
+	void DisableHierarchyIndex(AActor* InRootActor);
+	void MarkHierarchyIndexDirty(AActor* InActor);
+	FLPrefabHierarchyIndex* FindHierarchyIndex(AActor* InActor);
+
+private:
+	struct FPrefabInstanceList
+	{
+		TWeakObjectPtr<ULPrefab> Prefab;
+		/** Destroyed actor's slot is cleared, and removed in next tick, so index of other actor is not changed by destroy. */
+		TArray<TWeakObjectPtr<AActor>> RootActors;
+		int32 LiveCount = 0;
+	};
+	/** Key is prefab asset */
+	TMap<FObjectKey, FPrefabInstanceList> MapPrefabToInstances;
+	/** Root actor to prefab and index in FPrefabInstanceList::RootActors */
+	TMap<const AActor*, TPair<FObjectKey, int32>> MapRootActorToPrefabInstance;
+	bool bPrefabInstanceNeedCleanup = false;
+	void CleanupPrefabInstances();
+public:
+	/** Called by prefab loader, include sub prefab. Same actor will only register once. */
+	void RegisterPrefabInstance(ULPrefab* InPrefab, AActor* InRootActor);
+	void UnregisterPrefabInstance(AActor* InRootActor);
+	/** Number of live instances of the prefab in this world, created by LoadPrefab. */
+	int32 GetPrefabInstanceCount(ULPrefab* InPrefab)const;
+	/** Iterate root actor of live instances of the prefab in this world, created by LoadPrefab. */
+	void ForEachPrefabInstance(ULPrefab* InPrefab, TFunctionRef<void(AActor*)> InFunction)const;
+	/** Return prefab that the actor is loaded from, null if the actor is not a prefab instance's root actor. */
+	ULPrefab* GetPrefabOfInstance(AActor* InRootActor)const;
+
+private:
+	struct FScheduledSequencePlayer
+	{
+		TWeakObjectPtr<ULPrefabSequencePlayer> Player;
+		/** Primitives of playback context actor and its attached actors, to check if player is rendered recently. */
+		TArray<TWeakObjectPtr<UPrimitiveComponent>> Primitives;
+		/** Hierarchy of playback context actor is changed, collect Primitives again. See MarkSequencePlayerPrimitivesDirty */
+		bool bPrimitivesDirty = false;
+		/** Time skipped since last update, will add to next update. */
+		float PendingDeltaSeconds = 0;
+		double LastUpdateTime = 0;
+		uint64 LastTickFrame = 0;
+		bool bUpdateThisFrame = false;
+	};
+	TMap<FObjectKey, FScheduledSequencePlayer> ScheduledSequencePlayers;
+	uint64 SequencePlayerScheduleFrame = 0;
+	/** Actors whose hierarchy is changed since last schedule, players that use them as playback context will collect primitives again. */
+	TSet<FObjectKey> SequencePlayerHierarchyChangedActors;
+	/** Called when hierarchy under the actor is changed (same time as MarkHierarchyIndexDirty). */
+	void MarkSequencePlayerPrimitivesDirty(AActor* InActor);
+	/** Decide which players to update in this frame, by visibility and waiting time, limited by ULPrefabSettings::SequencePlayerUpdateBudget. */
+	void ScheduleSequencePlayers();
+	bool IsSequencePlayerRecentlyRendered(FScheduledSequencePlayer& InItem)const;
+	void CollectSequencePlayerPrimitives(FScheduledSequencePlayer& InOutItem)const;
+public:
+	/**
+	 * Called by sequence player when tick, see ULPrefabSettings::bScheduleSequencePlayerUpdate.
+	 * @param	OutDeltaSeconds		Delta time to update player, include time skipped by previous frames.
+	 * @return	false if player should skip update in this frame.
+	 */
+	bool ShouldUpdateSequencePlayer(ULPrefabSequencePlayer* InPlayer, float InDeltaSeconds, float& OutDeltaSeconds);
+	int32 GetScheduledSequencePlayerCount()const { return ScheduledSequencePlayers.Num(); }
+
+	/** Get root actor of all live instances of the prefab, that created by LoadPrefab. */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab", meta = (WorldContext = "WorldContextObject"))
+		static TArray<AActor*> GetPrefabInstances(UObject* WorldContextObject, ULPrefab* InPrefab);
+	/** Number of live instances of the prefab, that created by LoadPrefab. */
+	UFUNCTION(BlueprintPure, Category = "LPrefab", meta = (WorldContext = "WorldContextObject"))
+		static int32 GetPrefabInstanceNum(UObject* WorldContextObject, ULPrefab* InPrefab);
 };
@@ -27,6 +27,8 @@ namespace LPrefabSystem
 		K2Node,
 		/** Only for duplicate, use native ObjectWriter/ObjectReader serialization method */
 		NativeSerailizeForDuplicate,
+		/** Only for duplicate template, object outside of the hierarchy, stored as index of ActorSerializerBase::ExternalObjectList */
+		ExternalObjectForDuplicate,
 	};
 
 	/** 
@@ -44,11 +46,47 @@ namespace LPrefabSystem
 		return false;
 	}
 	bool LPrefab_ShouldSkipProperty(const FProperty* InProperty);
+	/**
+	 * Property skip rule for duplicate, shared by duplicate archives and direct clone (ActorSerializer::DuplicateActorDirect) so both copy the same set of properties.
+	 * Deprecated and SkipSerialization properties are already skipped by tagged serialization when saving, they are listed here so direct clone (which copy value without archive) skip them too.
+	 */
+	bool LPrefab_ShouldSkipPropertyForDuplicate(const FProperty* InProperty);
+
+	/**
+	 * Global cache of skipped member properties for each class and each skip-name set.
+	 * Without it every property of every object need a name lookup and a property-chain check, with it the check is just a pointer lookup.
+	 * Only use it in game thread. Cache is flushed when blueprint compile, because blueprint class's properties are recreated.
+	 */
+	class LPREFAB_API FLPrefabSkipPropertyCache
+	{
+	public:
+		/**
+		 * Return a persistent id for the skip-name set, 0 for empty set. Equal sets always get the same id, ids are never reused (Flush keeps them).
+		 * Called by every reader/writer constructor, so sets are found by hash of the names instead of comparing with every known set.
+		 */
+		static int32 GetSkipNameSetId(const TSet<FName>& InSkipPropertyNames);
+		/** Return member properties of InStruct whose name is in the skip-name set, nullptr if nothing to skip. */
+		static const TSet<const FProperty*>* GetSkipMemberProperties(const UStruct* InStruct, int32 InSkipNameSetId);
+		static void Flush();
+	};
+
+	/**
+	 * Global cache for UFunction and K2Node reference, currently for PrefabAnimation's event track.
+	 * Without it, every load of prefab need to find function by name, and iterate all objects inside the blueprint to find the K2Node.
+	 * Only use it in game thread. Cache is flushed when blueprint compile.
+	 */
+	class LPREFAB_API FLPrefabFunctionReferenceCache
+	{
+	public:
+		static UFunction* FindFunction(UClass* InClass, const FName& InFunctionName);
+		static UObject* FindK2Node(UObject* InBlueprint, const FName& InNodeName);
+		static void Flush();
+	};
 
 	class LPREFAB_API FLPrefabObjectWriter : public FObjectWriter
 	{
 	public:
-		FLPrefabObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames);
+		FLPrefabObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames);
 		virtual void DoSerialize(UObject* Object);
 
 		virtual bool ShouldSkipProperty(const FProperty* InProperty) const override;
@@ -63,12 +101,15 @@ namespace LPrefabSystem
 		virtual bool SerializeObject(UObject* Object);
 	protected:
 		ActorSerializerBase& Serializer;
-		TSet<FName> SkipPropertyNames;
+		int32 SkipNameSetId = 0;
+		/** Skipped member properties of the object in DoSerialize. */
+		const TSet<const FProperty*>* SkipMemberProperties = nullptr;
+		bool IsSkipMemberProperty(const FProperty* InProperty)const { return SkipMemberProperties != nullptr && SkipMemberProperties->Contains(InProperty); }
 	};
 	class LPREFAB_API FLPrefabObjectReader : public FObjectReader
 	{
 	public:
-		FLPrefabObjectReader(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames);
+		FLPrefabObjectReader(const TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames);
 		virtual void DoSerialize(UObject* Object);
 
 		virtual bool ShouldSkipProperty(const FProperty* InProperty) const override;
@@ -83,13 +124,16 @@ namespace LPrefabSystem
 		virtual bool SerializeObject(UObject*& Object, bool CanSerializeClass);
 	protected:
 		ActorSerializerBase& Serializer;
-		TSet<FName> SkipPropertyNames;
+		int32 SkipNameSetId = 0;
+		/** Skipped member properties of the object in DoSerialize. */
+		const TSet<const FProperty*>* SkipMemberProperties = nullptr;
+		bool IsSkipMemberProperty(const FProperty* InProperty)const { return SkipMemberProperties != nullptr && SkipMemberProperties->Contains(InProperty); }
 	};
 
 	class LPREFAB_API FLPrefabDuplicateObjectWriter : public FLPrefabObjectWriter
 	{
 	public:
-		FLPrefabDuplicateObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames);
+		FLPrefabDuplicateObjectWriter(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames);
 
 		virtual bool ShouldSkipProperty(const FProperty* InProperty) const override;
 		virtual FString GetArchiveName() const override;
@@ -98,12 +142,30 @@ namespace LPrefabSystem
 	class LPREFAB_API FLPrefabDuplicateObjectReader : public FLPrefabObjectReader
 	{
 	public:
-		FLPrefabDuplicateObjectReader(TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, TSet<FName> InSkipPropertyNames);
+		FLPrefabDuplicateObjectReader(const TArray< uint8 >& Bytes, ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames);
 
 		virtual bool ShouldSkipProperty(const FProperty* InProperty) const override;
 		virtual FString GetArchiveName() const override;
 		virtual bool SerializeObject(UObject*& Object, bool CanSerializeClass)override;
 	};
+	/**
+	 * For direct clone, no data is written, only collect objects that referenced by properties, so objects belong to the hierarchy (eg. instanced component) are collected same as FLPrefabDuplicateObjectWriter.
+	 */
+	class LPREFAB_API FLPrefabDuplicateReferenceCollector : public FArchiveUObject
+	{
+	public:
+		FLPrefabDuplicateReferenceCollector(ActorSerializerBase& InSerializer, const TSet<FName>& InSkipPropertyNames);
+		void DoSerialize(UObject* Object);
+
+		virtual bool ShouldSkipProperty(const FProperty* InProperty) const override;
+		virtual FArchive& operator<<(UObject*& Res) override;
+		virtual FString GetArchiveName() const override;
+	private:
+		ActorSerializerBase& Serializer;
+		int32 SkipNameSetId = 0;
+		const TSet<const FProperty*>* SkipMemberProperties = nullptr;
+		bool IsSkipMemberProperty(const FProperty* InProperty)const { return SkipMemberProperties != nullptr && SkipMemberProperties->Contains(InProperty); }
+	};
 
 
 
@@ -0,0 +1,138 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "LPrefabPoolSubsystem.generated.h"
+
+class ULPrefab;
+class USceneComponent;
+struct FStreamableHandle;
+namespace LPrefabSystem8
+{
+	struct FDuplicateActorDataContainer;
+	struct FDuplicateActorTemplate;
+}
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FLPrefabPoolPrewarmProgressDelegate, float, Progress);
+
+/**
+ * Pool of loaded prefab instances for a game world.
+ * Instead of destroy and load again, released instance is deactivated and kept in pool, when acquire again its properties are restored to the state right after the prefab is loaded.
+ * Property snapshot is taken once for each prefab and shared by all its instances, so memory cost does not grow with pool size. Components that are added after loaded are destroyed when acquire.
+ * Implement ILPrefabInterface's OnAcquireFromPool/OnReleaseToPool to reset runtime state that is not serialized in prefab.
+ * Prefabs in ULPrefabSettings::PrefabPoolPrewarmList are loaded asynchronously and instantiated into pool over frames when world begin play.
+ */
+UCLASS()
+class LPREFAB_API ULPrefabPoolSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+public:
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection)override;
+	virtual void Deinitialize()override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld)override;
+	virtual void Tick(float DeltaTime)override;
+	virtual TStatId GetStatId() const override;
+
+	static ULPrefabPoolSubsystem* GetInstance(UWorld* World);
+
+	/**
+	 * Get an instance of the prefab from pool, or load a new one if pool is empty.
+	 * @param	InParent		Attach root actor to this component.
+	 * @return	Root actor of the instance.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab", meta = (AdvancedDisplay = "Scale"))
+		AActor* AcquireInstance(ULPrefab* InPrefab, USceneComponent* InParent, FVector Location, FRotator Rotation, FVector Scale = FVector(1, 1, 1));
+	AActor* AcquireInstance(ULPrefab* InPrefab, USceneComponent* InParent, const FVector& Location, const FQuat& Rotation, const FVector& Scale);
+	/**
+	 * Put the instance back to pool. If the instance is not acquired from pool, or pool is full, then it will be destroyed.
+	 * @param	InRootActor		Root actor returned by AcquireInstance.
+	 */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab")
+		void ReleaseInstance(AActor* InRootActor);
+	/** Set max count of pooled instances for the prefab, default is ULPrefabSettings::PrefabPoolDefaultMaxSize. */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab")
+		void SetMaxPoolSize(ULPrefab* InPrefab, int32 InMaxSize);
+	/** Count of instances that are waiting in pool for the prefab. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LPrefab")
+		int32 GetPooledCount(ULPrefab* InPrefab)const;
+	/** Destroy pooled instances (include prewarmed) of the prefab, or all prefabs if InPrefab is null. */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab")
+		void ClearPool(ULPrefab* InPrefab);
+
+	/** Create instances of the prefab over frames and keep them in pool, pool will not be trimmed by idle time below the max count requested for the prefab. */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab")
+		void PrewarmPrefab(ULPrefab* InPrefab, int32 InCount);
+	/** Create all pending prewarm instances now, eg. when loading screen is showing. Wait for prefab assets loading if not finished. */
+	UFUNCTION(BlueprintCallable, Category = "LPrefab")
+		void FlushPrewarm();
+	/** Progress of prewarm, from 0 to 1. Return 1 if there is nothing to prewarm. */
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LPrefab")
+		float GetPrewarmProgress()const;
+	UFUNCTION(BlueprintCallable, BlueprintPure, Category = "LPrefab")
+		bool IsPrewarmFinished()const { return PrewarmTasks.Num() == 0; }
+	/** Called when some prewarm instances are created, parameter is progress from 0 to 1. */
+	UPROPERTY(BlueprintAssignable, Category = "LPrefab")
+		FLPrefabPoolPrewarmProgressDelegate OnPrewarmProgress;
+private:
+	struct FPooledInstance
+	{
+		TWeakObjectPtr<ULPrefab> Prefab;
+		TWeakObjectPtr<AActor> RootActor;
+		/** All actors in the instance, collected right after loaded. */
+		TArray<TWeakObjectPtr<AActor>> Actors;
+		/** Objects of this instance for restore, property snapshot inside is shared with other instances of the prefab, see PrefabSnapshots. */
+		TSharedPtr<LPrefabSystem8::FDuplicateActorDataContainer> Snapshot;
+		/** States when snapshot is taken, applied when activate. */
+		TArray<bool> ActorCollisionEnabled;
+		TArray<bool> ActorHiddenInGame;
+		/** Tick states after loaded. */
+		TArray<bool> ActorTickEnabled;
+		/** All components after loaded and their tick states. Components that not in this map are destroyed when activate. */
+		TMap<TWeakObjectPtr<UActorComponent>, bool> ComponentTickEnabled;
+		double ReleaseTime = 0;
+		bool IsValid()const;
+	};
+	TMap<TObjectKey<ULPrefab>, TArray<FPooledInstance>> Pools;
+	/** Property snapshot (after loaded and before Awake) for each prefab, taken from the first pooled instance. */
+	TMap<TObjectKey<ULPrefab>, TSharedPtr<const LPrefabSystem8::FDuplicateActorTemplate, ESPMode::ThreadSafe>> PrefabSnapshots;
+	TMap<TObjectKey<AActor>, FPooledInstance> ActiveInstances;
+	/** Active instance could be destroyed without release (eg. projectile destroyed on hit), remove its entry. */
+	FDelegateHandle ActorDestroyedDelegateHandle;
+	void OnActorDestroyed(AActor* InActor);
+	/** Actor could be collected without destroy (eg. level unload), remove invalid entries in next tick. */
+	FDelegateHandle PostGarbageCollectDelegateHandle;
+	bool bActiveInstancesNeedCleanup = false;
+	void OnPostGarbageCollect();
+	TMap<TObjectKey<ULPrefab>, int32> MaxPoolSizeMap;
+	/** Max requested prewarm count, pool will not be trimmed below this. */
+	TMap<TObjectKey<ULPrefab>, int32> MinPoolSizeMap;
+
+	struct FPrewarmTask
+	{
+		TSoftObjectPtr<ULPrefab> Prefab;
+		int32 RequestedCount = 0;
+		int32 RemainCount = 0;
+	};
+	TArray<FPrewarmTask> PrewarmTasks;
+	/** Keep prefabs that passed to PrewarmPrefab alive until prewarm finish. */
+	UPROPERTY(Transient)
+		TArray<TObjectPtr<ULPrefab>> PrewarmPrefabs;
+	int32 PrewarmTotalCount = 0;
+	int32 PrewarmCreatedCount = 0;
+	/** Keep prewarm prefab assets loaded. */
+	TSharedPtr<FStreamableHandle> PrewarmLoadHandle;
+	void ProcessPrewarm(double InTimeBudget);
+	void PrewarmInstance(ULPrefab* InPrefab);
+
+	AActor* LoadNewInstance(ULPrefab* InPrefab, USceneComponent* InParent, const FVector& Location, const FQuat& Rotation, const FVector& Scale, FPooledInstance& OutInstance);
+	int32 GetMaxPoolSize(ULPrefab* InPrefab)const;
+	int32 GetMinPoolSize(ULPrefab* InPrefab)const;
+	void DestroyInstance(FPooledInstance& InInstance);
+	void DeactivateInstance(FPooledInstance& InInstance);
+	/** Destroy components that are added after loaded, and apply the states after loaded. */
+	void ActivateInstance(FPooledInstance& InInstance);
+	void BroadcastPoolEvent(FPooledInstance& InInstance, bool bAcquire);
+};
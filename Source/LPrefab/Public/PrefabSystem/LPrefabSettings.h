@@ -5,6 +5,26 @@
 #include "CoreMinimal.h"
 #include "LPrefabSettings.generated.h"
 
+class ULPrefabSharedReferenceTable;
+class ULPrefab;
+class UWorld;
+
+/** Prefab instances that ULPrefabPoolSubsystem create at world start. */
+USTRUCT(NotBlueprintType)
+struct LPREFAB_API FLPrefabPoolPrewarmItem
+{
+	GENERATED_BODY()
+public:
+	/** Only prewarm in this map. Leave it empty to prewarm in all maps. */
+	UPROPERTY(EditAnywhere, Category = "LPrefab")
+		TSoftObjectPtr<UWorld> Map;
+	UPROPERTY(EditAnywhere, Category = "LPrefab")
+		TSoftObjectPtr<ULPrefab> Prefab;
+	/** How many instances to create and keep in pool. */
+	UPROPERTY(EditAnywhere, Category = "LPrefab", meta = (ClampMin = "1"))
+		int32 Count = 1;
+};
+
 /** for LPrefab config */
 UCLASS(config=Engine, defaultconfig)
 class LPREFAB_API ULPrefabSettings :public UObject
@@ -16,15 +36,107 @@ public:
 	 */
 	UPROPERTY(EditAnywhere, config, Category = "LPrefab")
 		bool bLogPrefabLoadTime = false;
+	/**
+	 * When load prefab, components are re-registered after properties are set. Normally they are re-registered one by one.
+	 * Enable this to unregister all components of the prefab first, then register them together with one register-context, so render primitives are added to scene in one batch.
+	 * Physics state creation is deferred when register (engine's "p.EnableDeferredPhysicsCreation"), and bodies are created together after all components are registered. Each distinct collision profile is searched only once.
+	 * Useful for prefabs that have many primitive components, eg. hundreds of colliding meshes.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab")
+		bool bBatchComponentRegistration = false;
+	/**
+	 * Put objects of each loaded prefab instance into a GC cluster, so GC reachability analysis treats the instance as one object. Only work in cooked game.
+	 * Only actors with "bCanBeInCluster" (and their components and subobjects) are clustered, because GC will not track references that are changed after the cluster is created.
+	 * Cluster is dissolved automatically if any actor of the instance is destroyed, or the hierarchy or components are changed.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab")
+		bool bCreateGCClusterForPrefabInstance = false;
+	/**
+	 * Movie scene (tracks, sections and keys) of LPrefabSequence is shared by all loaded instances of the same prefab, instead of created for every instance. Only work in game world.
+	 * Bindings are still stored in every instance's sequence, so every instance animates its own actors. Don't modify the movie scene at runtime if this is enabled, because it will affect all instances.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab")
+		bool bShareSequenceAcrossInstances = false;
+	/**
+	 * When cook, bake LPrefabSequence in prefab that only have transform, float, double and color tracks (single absolute section, no easing, no event, no constant key) into uniformly sampled keyframes.
+	 * Baked data is stored in prefab asset and shared by all instances. Baked sequence is played by a lightweight player in LPrefabSequenceComponent, without MovieScene runtime. Other sequences still use LPrefabSequencePlayer.
+	 * Keyframes are sampled at display rate of the sequence (or higher if needed for accuracy), values between samples are linear interpolated.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab")
+		bool bBakeSimpleSequenceWhenCook = false;
+	/** Max time (in milliseconds) per frame to destroy actors that are queued by DestroyActorWithHierarchyDeferred. At least one step is processed every frame. */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab", meta = (ClampMin = "0"))
+		float DeferredDestroyTimeBudget = 2.0f;
+	/** Default max count of pooled instances for each prefab in ULPrefabPoolSubsystem, can be changed for specific prefab with ULPrefabPoolSubsystem::SetMaxPoolSize. Released instance will be destroyed if pool is full. */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab Pool", meta = (ClampMin = "0"))
+		int32 PrefabPoolDefaultMaxSize = 16;
+	/** Pooled instance that is not used for this time (in seconds) will be destroyed, one instance per prefab per frame. 0 means never. */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab Pool", meta = (ClampMin = "0"))
+		float PrefabPoolIdleTimeToTrim = 30.0f;
+	/**
+	 * Prefabs to load and put into ULPrefabPoolSubsystem when a game world begin play, so AcquireInstance can get them from pool instead of loading during gameplay.
+	 * Prewarmed instances are not trimmed by PrefabPoolIdleTimeToTrim.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab Pool")
+		TArray<FLPrefabPoolPrewarmItem> PrefabPoolPrewarmList;
+	/** Max time (in milliseconds) per frame to create prewarm instances. At least one instance is created every frame. */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab Pool", meta = (ClampMin = "0"))
+		float PrefabPoolPrewarmTimeBudget = 3.0f;
+	/**
+	 * Update LPrefabSequencePlayers in game world by priority under a per-frame budget, instead of update all of them every frame.
+	 * Players whose actors are not rendered recently are updated at lower frequency. Skipped time is added to next update, so a player catch up when it is visible again.
+	 * Actors without primitive component (eg. rendered by other system) are treated as visible.
+	 * Primitives of a player's actor and attached actors are cached, and collected again when prefab system change the hierarchy. After attach/detach actors yourself, call ULPrefabBPLibrary::MarkHierarchyIndexDirty.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab Sequence")
+		bool bScheduleSequencePlayerUpdate = false;
+	/** Max number of scheduled LPrefabSequencePlayers to update per frame, 0 means no limit. Recently rendered players are updated first, then the ones that wait longest. */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab Sequence", meta = (ClampMin = "0", EditCondition = "bScheduleSequencePlayerUpdate"))
+		int32 SequencePlayerUpdateBudget = 64;
+	/** Update interval (in seconds) of scheduled LPrefabSequencePlayer whose actors are not rendered recently. */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab Sequence", meta = (ClampMin = "0", EditCondition = "bScheduleSequencePlayerUpdate"))
+		float OffscreenSequencePlayerUpdateInterval = 0.5f;
 	/**
 	 * Prefabs in these folders will appear in "LGUI Tools" menu, so we can easily create our own UI control.
 	 */
 	UPROPERTY(EditAnywhere, config, Category = "LPrefab Editor", meta = (LongPackageName))
 		TArray<FDirectoryPath> ExtraPrefabFolders;
+	/**
+	 * When cook prefab, names/classes/assets that exist in this table will be stored as index to this table instead of stored in every prefab.
+	 * Use "RebuildFromAllPrefabs" on the table asset to fill it before cook.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab Cook")
+		TSoftObjectPtr<ULPrefabSharedReferenceTable> SharedReferenceTable;
+	/**
+	 * When cook prefab, write runtime data of all prefabs into one bundle file, and prefab only store offset to the file. At runtime the bundle file is memory-mapped.
+	 * The file is written to cook output folder (Saved/Cooked/[Platform]/[Project]/Content), so it is staged with cooked content. Better to add its folder to "Additional Non-Asset Directories To Package Uncompressed" so it can be mapped directly from pak.
+	 * Prefab also keep a copy of its data in package's bulk data, which is loaded only if bundle entry is not valid.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab Cook")
+		bool bWritePrefabBundleWhenCook = false;
+	/** Bundle file path relative to project's Content folder. */
+	UPROPERTY(EditAnywhere, config, Category = "LPrefab Cook", meta = (EditCondition = "bWritePrefabBundleWhenCook"))
+		FString PrefabBundleFile = TEXT("LPrefabBundle/Prefabs.lprefabbundle");
 
 #if WITH_EDITOR
 	virtual void PostEditChangeProperty(struct FPropertyChangedEvent& PropertyChangedEvent)override;
 #endif
 public:
 	static bool GetLogPrefabLoadTime();
+	static bool GetBatchComponentRegistration();
+	static bool GetCreateGCClusterForPrefabInstance();
+	static bool GetShareSequenceAcrossInstances();
+	static bool GetBakeSimpleSequenceWhenCook();
+	static float GetDeferredDestroyTimeBudget();
+	static int32 GetPrefabPoolDefaultMaxSize();
+	static float GetPrefabPoolIdleTimeToTrim();
+	static const TArray<FLPrefabPoolPrewarmItem>& GetPrefabPoolPrewarmList();
+	static float GetPrefabPoolPrewarmTimeBudget();
+	static bool GetScheduleSequencePlayerUpdate();
+	static int32 GetSequencePlayerUpdateBudget();
+	static float GetOffscreenSequencePlayerUpdateInterval();
+#if WITH_EDITOR
+	/** Shared reference table for cook, could be null. */
+	static ULPrefabSharedReferenceTable* GetSharedReferenceTableForCook();
+#endif
 };
@@ -0,0 +1,64 @@
+﻿// Copyright 2019-Present LexLiu. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "LPrefabSharedReferenceTable.generated.h"
+
+class ULPrefab;
+
+/**
+ * Project-wide reference table for cooked prefabs.
+ * Names, classes and assets that appear in many prefabs are stored here once, and cooked prefab only store index to this table, so these references are not duplicated in every prefab asset and are resolved only once when this table is loaded.
+ * Assign this asset in ProjectSettings/LPrefab, then click "RebuildFromAllPrefabs" before cook.
+ * Table is append-only: rebuild will never remove or reorder existing entries, so prefabs that already cooked with this table are still valid.
+ */
+UCLASS(ClassGroup = (LPrefab), BlueprintType)
+class LPREFAB_API ULPrefabSharedReferenceTable : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(VisibleAnywhere, Category = "LPrefab")
+		TArray<TObjectPtr<UObject>> AssetList;
+	UPROPERTY(VisibleAnywhere, Category = "LPrefab")
+		TArray<TObjectPtr<UClass>> ClassList;
+	UPROPERTY(VisibleAnywhere, Category = "LPrefab")
+		TArray<FName> NameList;
+
+#if WITH_EDITORONLY_DATA
+	/** Only put entry to this table if it is referenced by at least this number of prefabs. */
+	UPROPERTY(EditAnywhere, Category = "LPrefab", meta = (ClampMin = "1"))
+		int32 MinReferencedPrefabCount = 2;
+	/** Blueprint class in this table will be loaded when the table is loaded, so it is disabled by default. */
+	UPROPERTY(EditAnywhere, Category = "LPrefab")
+		bool bIncludeBlueprintClass = false;
+	/** Asset in this table will be loaded when the table is loaded (which means when any prefab is loaded), so it is disabled by default. Only enable it for small and commonly used assets. */
+	UPROPERTY(EditAnywhere, Category = "LPrefab")
+		bool bIncludeAsset = false;
+#endif
+
+	UObject* GetAssetByIndex(int32 Index)const { return AssetList.IsValidIndex(Index) ? AssetList.GetData()[Index].Get() : nullptr; }
+	UClass* GetClassByIndex(int32 Index)const { return ClassList.IsValidIndex(Index) ? ClassList.GetData()[Index].Get() : nullptr; }
+	FName GetNameByIndex(int32 Index)const { return NameList.IsValidIndex(Index) ? NameList.GetData()[Index] : NAME_None; }
+
+#if WITH_EDITOR
+	/** Find index in table, return INDEX_NONE if not found. */
+	int32 FindAsset(UObject* InAsset)const;
+	int32 FindClass(UClass* InClass)const;
+	int32 FindName(const FName& InName)const;
+
+	/** Collect references from all prefabs in project and append frequently used entries to this table. */
+	UFUNCTION(CallInEditor, Category = "LPrefab")
+		void RebuildFromAllPrefabs();
+
+	virtual void PostLoad()override;
+private:
+	void RebuildLookupMap()const;
+	mutable TMap<UObject*, int32> MapAssetToIndex;
+	mutable TMap<UClass*, int32> MapClassToIndex;
+	mutable TMap<FName, int32> MapNameToIndex;
+	mutable bool bLookupMapDirty = true;
+#endif
+};